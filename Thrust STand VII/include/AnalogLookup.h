@@ -0,0 +1,34 @@
+#pragma once
+//Count to engineering unit conversions for the analog sensors, worked out once when a setting or offset
+//changes so a sample costs a table read and a multiply instead of a chain of float divides and a sqrt.
+//Counts are averaged ADC readings, 0-1023. They can have a fraction (the sensor node sends 1/16 counts),
+//the airspeed table is interpolated between codes, apart from the first few where sqrt is too curved for that.
+//tools/analog_check.cpp holds the table up against the float formula.
+//
+//Voltage and current are straight lines, so they only keep a gain and offset: a 1024 entry table each
+//would take 4KB of the Mega's 8KB of RAM to save one multiply.
+
+#include <Arduino.h>
+
+#define ANALOG_CODES 1024
+
+struct LinearScale {
+    float gain; //units per count
+    float offset; //subtracted after the gain
+
+    void begin(float unitsPerCount, float unitOffset) { gain = unitsPerCount; offset = unitOffset; }
+    float convert(float counts) const { return counts * gain - offset; }
+};
+
+//Bernoulli: v = sqrt(2 * P / density), with P proportional to counts above the zero-airflow reading.
+//That's a constant times sqrt(counts - zero), and sqrt of every count lives in a table in flash, so moving
+//the zero only moves where the table is read
+class AirspeedLookup {
+public:
+    void begin(float voltsPerCount, float zeroVolts, float voltsPerKpa, float airDensity); //call again when any of these change
+    float convert(float counts) const; //m/s, 0 at or below the zero
+
+private:
+    float zeroCounts = 0;
+    float speedPerRootCount = 0; //m/s per sqrt(count)
+};
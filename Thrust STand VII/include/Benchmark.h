@@ -0,0 +1,25 @@
+#pragma once
+//Times a piece of firmware over a number of runs and prints one report line for it:
+//
+//    BENCH <name> <runs> <mean_us> <min_us> <max_us>
+//
+//Every line starts with BENCH so the report can be picked out of the rest of the Serial output and diffed
+//against a stored run (benchmark/ has the baselines). Times come from micros(), which steps in 4us on a 16MHz
+//Mega, so min and max are only that fine. The mean is taken over the whole batch and resolves a bit better.
+
+#include <Arduino.h>
+
+class Benchmark {
+public:
+    explicit Benchmark(Print& out) : out(out) {}
+
+    void header(); //column names, also marks the start of a report
+
+    //prepare (optional) runs untimed before every run, for waiting on a sensor or resetting state
+    void run(const char* name, void (*kernel)(), uint16_t runs, void (*prepare)() = nullptr);
+
+    void skip(const char* name); //for a kernel the hardware isn't there for, keeps the report lines lined up with the baseline
+
+private:
+    Print& out;
+};
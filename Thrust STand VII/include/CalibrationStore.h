@@ -0,0 +1,41 @@
+#pragma once
+//Versioned, CRC checked records in EEPROM, rotated over a ring of slots for wear leveling.
+//Every save goes to the slot after the newest one with the sequence number bumped, so a power cut
+//mid-write only ever loses the record being written and the previous one still loads.
+
+#include <Arduino.h>
+
+class CalibrationStore {
+public:
+    CalibrationStore(int baseAddress, uint8_t slotCount, uint16_t slotSize);
+
+    //copies the newest valid record into payload (up to maxSize bytes, the rest is left alone so
+    //fields added in a newer version keep their defaults). Returns the record version, 0 if none is valid.
+    uint8_t load(void* payload, uint16_t maxSize);
+
+    bool save(uint8_t version, const void* payload, uint16_t size); //false if the payload doesn't fit a slot
+
+    uint32_t sequence() const { return newestSequence; } //how many times the record has been saved
+    int8_t activeSlot() const { return newestSlot; } //-1 if nothing valid has been found
+
+private:
+    struct SlotHeader { //ordered so it packs the same on the Mega and the native build
+        uint32_t sequence;
+        uint16_t magic;
+        uint16_t length;
+        uint8_t version;
+        uint8_t reserved;
+        uint16_t crc;
+    };
+
+    int slotAddress(uint8_t slot) const { return base + slot * (int)slotSize; }
+    bool readHeader(uint8_t slot, SlotHeader& header) const; //false if the slot doesn't hold a valid record
+    void scan();
+
+    int base;
+    uint8_t slotCount;
+    uint16_t slotSize;
+    bool scanned = false;
+    int8_t newestSlot = -1;
+    uint32_t newestSequence = 0;
+};
@@ -0,0 +1,29 @@
+#pragma once
+//Campaign files, an ordered list of tests run back to back. One test per line:
+//
+//    <profile> [<menu id>=<value> ...]        e.g. "2 2221=6 2222=3 2223=80"
+//
+//profile is the same number Select Profile uses, the settings are menu value ids from the flow chart in
+//main.cpp. A setting carries on to the lines after it, so a line only needs what changes. Blank lines and
+//anything from a # on are skipped. No Arduino includes, plain C++ like CommandLine.
+
+#include <stdint.h>
+
+#define CAMPAIGN_MAX_LINE 64
+#define CAMPAIGN_MAX_SETTINGS 6
+
+struct CampaignSetting {
+    long id;
+    long value;
+};
+
+struct CampaignStep {
+    long profile;
+    uint8_t settingCount;
+    CampaignSetting settings[CAMPAIGN_MAX_SETTINGS];
+};
+
+enum CampaignLine : uint8_t {CAMPAIGN_BLANK, CAMPAIGN_STEP, CAMPAIGN_BAD};
+
+//splits line in place. Only checks the syntax, whether the profile and ids exist is up to the caller
+CampaignLine parseCampaignLine(char* line, CampaignStep* step);
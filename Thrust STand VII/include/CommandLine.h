@@ -0,0 +1,26 @@
+#pragma once
+//Collects a text command one character at a time, so whatever polls Serial never waits for the rest of a
+//line. A line ends at \n or \r and is split into words on spaces. Lines longer than MAX_LINE are thrown
+//away whole instead of being run cut short. No Arduino includes, plain C++ like SensorLink.
+
+#include <stdint.h>
+
+class CommandLine {
+public:
+    static const uint8_t MAX_LINE = 48;
+    static const uint8_t MAX_WORDS = 4;
+
+    bool feed(char c); //true when a complete line is waiting in words()
+
+    uint8_t count() const { return wordCount; }
+    const char* word(uint8_t index) const { return index < wordCount ? words[index] : ""; }
+
+private:
+    char buffer[MAX_LINE + 1];
+    const char* words[MAX_WORDS];
+    uint8_t length = 0;
+    uint8_t wordCount = 0;
+    bool overflowed = false;
+};
+
+bool parseNumber(const char* text, long* value); //whole decimal number with an optional sign, false for anything else
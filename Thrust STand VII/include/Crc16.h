@@ -0,0 +1,23 @@
+#pragma once
+//CRC-16/CCITT (poly 0x1021), same as _crc_ccitt_update style checks but portable so the native build can use it
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CRC16_INIT 0xFFFF
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t data) {
+    crc ^= (uint16_t)data << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+inline uint16_t crc16(const void* data, size_t length, uint16_t crc = CRC16_INIT) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc16Update(crc, bytes[i]);
+    }
+    return crc;
+}
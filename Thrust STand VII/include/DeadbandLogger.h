@@ -0,0 +1,37 @@
+#pragma once
+//Decides which rows of an adaptive log are worth writing. A row is kept when any channel has moved more
+//than its deadband away from the last kept row, or when the heartbeat interval has run out. Everything
+//that was skipped stayed within its deadband of the row before it, so holding each kept row until the
+//next one rebuilds the full rate log to within the deadbands.
+
+#include <stdint.h>
+
+enum LogDecision : uint8_t {
+    LOG_SKIP,
+    LOG_CHANGE, //a channel left its deadband
+    LOG_HEARTBEAT, //nothing moved but the heartbeat ran out
+};
+
+class DeadbandLogger {
+public:
+    static const uint8_t MAX_CHANNELS = 8;
+
+    //deadbands are in the channel's own units, 0 keeps a row on any change at all
+    void begin(const float* deadbands, uint8_t channelCount, unsigned long heartbeatMillis);
+
+    //anything but LOG_SKIP means write the row, it becomes the new reference
+    LogDecision decide(const float* values, unsigned long nowMillis);
+
+    unsigned long keptRows() const { return kept; }
+    unsigned long skippedRows() const { return skipped; }
+
+private:
+    float bands[MAX_CHANNELS];
+    float reference[MAX_CHANNELS]; //values in the last kept row
+    uint8_t count = 0;
+    unsigned long heartbeat = 0;
+    unsigned long keptAt = 0; //millis() of the last kept row
+    bool started = false;
+    unsigned long kept = 0;
+    unsigned long skipped = 0;
+};
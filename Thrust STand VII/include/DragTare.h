@@ -0,0 +1,47 @@
+#pragma once
+//Drag tare: what the stand's own structure reads on the thrust cell at each airspeed with the motor off,
+//taken back off the thrust in tunnel runs. The measured points are resampled onto an even airspeed grid,
+//so a lookup is one multiply to find the entry and one interpolation, no searching.
+
+#include <stdint.h>
+
+#define DRAG_TARE_POINTS 16
+
+struct DragTable { //what gets saved with the calibration. Fixed width types so the layout matches the native build
+    float step; //m/s between entries, the first is at 0 m/s
+    float drag[DRAG_TARE_POINTS]; //thrust units read at each airspeed
+    uint8_t count; //entries in use, 0 means no drag tare
+    uint8_t reserved[3];
+};
+
+class DragTare {
+public:
+    //measured airspeed/drag pairs in any order, the 0 m/s tare point included. false if there aren't two
+    //points at different airspeeds
+    static bool build(const float* airspeeds, const float* drags, uint8_t n, float step, DragTable& out);
+
+    void begin(const DragTable& table); //an empty table turns it off
+    void clear();
+
+    bool active() const { return enabled; }
+    const DragTable& table() const { return params; }
+
+    float at(float airspeed) const { //drag to take off the thrust, this is the per sample path
+        if (!enabled || !(airspeed > 0)) {
+            return 0;
+        }
+        float x = airspeed * inverseStep;
+        if (x >= last) { //past the sweep drag keeps going up with airspeed squared
+            return tailScale * x * x;
+        }
+        uint8_t i = (uint8_t)x;
+        return params.drag[i] + (params.drag[i + 1] - params.drag[i]) * (x - i);
+    }
+
+private:
+    DragTable params = {};
+    bool enabled = false;
+    float inverseStep = 0;
+    uint8_t last = 0; //index of the last entry
+    float tailScale = 0; //drag at the last entry over its grid index squared
+};
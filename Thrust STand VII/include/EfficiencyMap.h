@@ -0,0 +1,33 @@
+#pragma once
+//Efficiency binned by throttle and a second axis (airspeed for tunnel runs, or RPM) while the test runs.
+//Each cell keeps running sums and a count, so adding a sample is two divisions and four adds no matter how
+//long the test is, and the end of test output is one line per visited cell instead of every row.
+
+#include <Arduino.h>
+
+enum MapAxis : uint8_t {MAP_AIRSPEED, MAP_RPM};
+
+class EfficiencyMap {
+public:
+    static const uint8_t THROTTLE_BINS = 10; //10% each
+    static const uint8_t AXIS_BINS = 6; //the last bin takes everything past the top. 60 cells is 840 bytes of RAM
+
+    void begin(MapAxis axis, float binWidth); //clears the map, binWidth is m/s or RPM per bin
+    void add(float throttle, float axisValue, float motorEfficiency, float propellerEfficiency, float systemEfficiency);
+
+    uint16_t samples() const { return total; }
+    void write(Print& out) const; //CSV, one row per cell that got any samples
+
+private:
+    struct Cell {
+        float motor; //sums
+        float propeller;
+        float system;
+        uint16_t count;
+    };
+
+    Cell cells[THROTTLE_BINS][AXIS_BINS];
+    MapAxis mapAxis = MAP_AIRSPEED;
+    float width = 1;
+    uint16_t total = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+//ESC output on timer 3 (pin 3 is OC3C on the Mega) instead of the Servo library's 50 Hz software pulses.
+//Standard PWM runs at 50-490 Hz, OneShot125 sends 125-250us pulses once per system tick (1 kHz).
+//Commands are staged and picked up by tick() from the system tick ISR, and OCR3C is double buffered by
+//the timer, so a new pulse width always starts on a fresh period and never cuts one short.
+
+#include <Arduino.h>
+
+enum EscProtocol : uint8_t {ESC_PWM, ESC_ONESHOT125};
+
+class EscOutput {
+public:
+    static const uint8_t PIN = 3; //OC3C, the only pin this driver can use
+    static const uint16_t MIN_RATE = 50; //Hz, standard PWM
+    static const uint16_t MAX_RATE = 490;
+    static const uint16_t ONESHOT_RATE = 1000; //one pulse per system tick
+
+    //(re)starts the timer. rateHz is clamped to MIN_RATE-MAX_RATE and ignored for OneShot125.
+    //The output starts at pulseMicros so the ESC never sees a gap or a random pulse
+    void begin(EscProtocol protocol, uint16_t rateHz, uint16_t pulseMicros);
+
+    //1000-2000us in standard PWM terms for either protocol, OneShot125 scales it down by 8.
+    //Goes out on the next tick
+    void writeMicroseconds(uint16_t pulseMicros);
+    void cut(uint16_t pulseMicros); //straight to the timer, for the safety trip. Call with interrupts off (ISR)
+    void tick(); //call from the system tick ISR
+
+    uint16_t readMicroseconds() const { return commandTicks / 2; }
+    EscProtocol protocol() const { return activeProtocol; }
+    uint16_t rate() const { return activeRate; } //Hz
+
+private:
+    static uint16_t toTicks(uint16_t pulseMicros) { return pulseMicros * 2; } //see begin() for why both protocols are x2
+
+    EscProtocol activeProtocol = ESC_PWM;
+    uint16_t activeRate = 0;
+    volatile uint16_t commandTicks = 0; //timer counts, staged for tick()
+    volatile bool commandPending = false;
+};
@@ -0,0 +1,53 @@
+#pragma once
+//Channels on top of the built in six, through the sensor registry (SensorRegistry.h). Adding one is a type
+//here and a place in the list at the bottom: the readings, the CSV columns, the status line and the debug
+//page all come from the list, nothing in main.cpp changes. Extra channels are CSV only, compressed and raw
+//logs keep their fixed layouts and say which channels they left out.
+//
+//The list is empty unless a sensor's flag is in build_flags, a column for something that isn't wired up
+//would only log a floating pin.
+
+#include <Arduino.h>
+#include "SensorRegistry.h"
+
+//motor temperature: 10k NTC thermistor epoxied to the stator, from the pin to ground, 10k pullup to 5V.
+//Build with -D MOTOR_TEMPERATURE to log it
+#define MOTOR_TEMP_PIN A5
+#define MOTOR_TEMP_READS 4 //readings summed per sample
+#define MOTOR_TEMP_PULLUP 10000.0f //ohms
+#define MOTOR_TEMP_NOMINAL 10000.0f //thermistor ohms at 25C
+#define MOTOR_TEMP_BETA 3950.0f
+
+struct MotorTemperature {
+    typedef uint16_t Raw; //sum of MOTOR_TEMP_READS readings
+
+    static const char* label() { return "Motor Temp (C)"; }
+    static const char* key() { return "motor_temp"; }
+    static const char* screenLabel() { return "MTMP"; }
+    static constexpr uint8_t DECIMALS = 1;
+    static constexpr unsigned long PERIOD_MICROS = 100000UL; //a stator takes seconds to warm up, 10 a second is plenty
+    static constexpr bool HOLDS_ROWS = false;
+
+    static void begin() { pinMode(MOTOR_TEMP_PIN, INPUT); }
+    static bool ready() { return true; }
+
+    static Raw read() {
+        Raw sum = 0;
+        for (uint8_t i = 0; i < MOTOR_TEMP_READS; i++) {
+            sum += analogRead(MOTOR_TEMP_PIN);
+        }
+        return sum;
+    }
+
+    static float convert(Raw raw) { //beta equation, an open or shorted thermistor pins at the end of the range
+        float counts = constrain(raw / (float)MOTOR_TEMP_READS, 1.0f, 1022.0f);
+        float ohms = MOTOR_TEMP_PULLUP * counts / (1023.0f - counts);
+        return 1.0f / (1.0f / 298.15f + logf(ohms / MOTOR_TEMP_NOMINAL) / MOTOR_TEMP_BETA) - 273.15f;
+    }
+};
+
+#ifdef MOTOR_TEMPERATURE
+typedef SensorRegistry<MotorTemperature> ExtraSensors;
+#else
+typedef SensorRegistry<> ExtraSensors;
+#endif
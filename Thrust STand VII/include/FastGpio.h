@@ -0,0 +1,61 @@
+#pragma once
+//Pin access with the pin number as a template parameter. The port and bit are looked up at compile time,
+//so FastPin<47>::high() is a single access to PORTL instead of digitalWrite's walk through the pin
+//tables in flash (a few us each on a 16MHz Mega).
+//
+//Only for pins that are driven one way for good, none of the timer/PWM handling digitalWrite does.
+//Ports above the I/O space (H, J, K, L on the Mega) are changed with a read-modify-write, so an ISR
+//that touches the same port can lose a bit. Nothing in our ISRs touches L where the HX711s are.
+
+#include <stdint.h>
+#include <avr/io.h>
+
+//port letter and bit for every pin, same order as the board's pins_arduino.h
+#if defined(__AVR_ATmega328P__)
+#define FAST_PIN_COUNT 20
+#define FAST_PIN_PORTS "DDDDDDDDBBBBBBCCCCCC"
+#define FAST_PIN_BITS  "01234567012345012345"
+#else //Mega 2560, also what the native bench models
+#define FAST_PIN_COUNT 70
+#define FAST_PIN_PORTS "EEEEGEHHHHBBBBJJHHDDDD" "AAAAAAAA" "CCCCCCCC" "D" "GGG" "LLLLLLLL" "BBBB" "FFFFFFFF" "KKKKKKKK"
+#define FAST_PIN_BITS  "0145533456456710103210" "01234567" "76543210" "7" "210" "76543210" "3210" "01234567" "01234567"
+#endif
+
+constexpr char fastPinPort(uint8_t pin) { return FAST_PIN_PORTS[pin]; }
+constexpr uint8_t fastPinMask(uint8_t pin) { return 1 << (FAST_PIN_BITS[pin] - '0'); }
+
+#ifdef NATIVE_SIM
+typedef SimPort FastRegister; //the bench watches the port registers, see sim/include/avr/io.h
+#else
+typedef volatile uint8_t FastRegister;
+#endif
+
+#define FAST_INLINE inline __attribute__((always_inline))
+
+//with a constant port the switch folds away and leaves the register address
+#if defined(__AVR_ATmega328P__)
+#define FAST_PORT_CASES(PREFIX) \
+    case 'B': return PREFIX##B; case 'C': return PREFIX##C; default: return PREFIX##D;
+#else
+#define FAST_PORT_CASES(PREFIX) \
+    case 'A': return PREFIX##A; case 'B': return PREFIX##B; case 'C': return PREFIX##C; \
+    case 'D': return PREFIX##D; case 'E': return PREFIX##E; case 'F': return PREFIX##F; \
+    case 'G': return PREFIX##G; case 'H': return PREFIX##H; case 'J': return PREFIX##J; \
+    case 'K': return PREFIX##K; default: return PREFIX##L;
+#endif
+
+FAST_INLINE FastRegister& fastPortOut(char port) { switch (port) { FAST_PORT_CASES(PORT) } }
+FAST_INLINE FastRegister& fastPortIn(char port) { switch (port) { FAST_PORT_CASES(PIN) } }
+FAST_INLINE FastRegister& fastPortDir(char port) { switch (port) { FAST_PORT_CASES(DDR) } }
+
+template<uint8_t PIN>
+struct FastPin {
+    static_assert(PIN < FAST_PIN_COUNT, "no such pin on this board");
+    static constexpr uint8_t MASK = fastPinMask(PIN);
+
+    static FAST_INLINE void output() { fastPortDir(fastPinPort(PIN)) |= MASK; }
+    static FAST_INLINE void input() { fastPortDir(fastPinPort(PIN)) &= (uint8_t)~MASK; }
+    static FAST_INLINE void high() { fastPortOut(fastPinPort(PIN)) |= MASK; }
+    static FAST_INLINE void low() { fastPortOut(fastPinPort(PIN)) &= (uint8_t)~MASK; }
+    static FAST_INLINE uint8_t read() { return (fastPortIn(fastPinPort(PIN)) & MASK) ? 1 : 0; }
+};
@@ -0,0 +1,48 @@
+#pragma once
+//HX711 reader on FastPin. Same 24 bit conversion as HX711::read(), shifted out with direct port access
+//instead of digitalWrite/digitalRead, so a read holds the CPU for tens of us instead of a couple hundred.
+//The HX711 library object still owns the offset and scale, this only replaces the bit banging.
+
+#include <Arduino.h>
+#include "FastGpio.h"
+
+#ifdef NATIVE_SIM
+#define HX711_SETTLE()
+#else
+#define HX711_SETTLE() __builtin_avr_delay_cycles(2) //DOUT is valid 0.1us after the rising edge
+#endif
+
+template<uint8_t DOUT, uint8_t SCK>
+class FastHX711 {
+public:
+    static void begin() {
+        FastPin<SCK>::output();
+        FastPin<SCK>::low(); //clock held high for 60us powers the chip down
+        FastPin<DOUT>::input();
+    }
+
+    static bool isReady() { return !FastPin<DOUT>::read(); } //DOUT goes low when a conversion is waiting
+
+    //only call once isReady(). gainPulses picks the channel and gain for the next conversion: 1 = A/128, 2 = B/32, 3 = A/64
+    static long read(uint8_t gainPulses = 1) {
+        uint32_t value = 0;
+        noInterrupts(); //an ISR in the middle of a pulse could hold the clock high long enough to power it down
+        for (uint8_t i = 0; i < 24; i++) {
+            FastPin<SCK>::high();
+            HX711_SETTLE();
+            value = (value << 1) | FastPin<DOUT>::read();
+            FastPin<SCK>::low();
+        }
+        for (uint8_t i = 0; i < gainPulses; i++) {
+            FastPin<SCK>::high();
+            HX711_SETTLE();
+            FastPin<SCK>::low();
+        }
+        interrupts();
+
+        if (value & 0x800000UL) {
+            value |= 0xFF000000UL; //24 bit two's complement
+        }
+        return (int32_t)value;
+    }
+};
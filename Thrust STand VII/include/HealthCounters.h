@@ -0,0 +1,64 @@
+#pragma once
+//Counters for how well the sensors and the card are keeping up, always on. Everything is a running total
+//that only ever goes up, so counting is an add and rates come from the difference between two snapshots:
+//the debug page takes one a second, a test log takes one at the start and compares at the end.
+
+#include <stdint.h>
+
+#define HEALTH_CHANNELS 6 //same order as ChannelId in main.cpp
+#define HEALTH_CELLS 2 //thrust, torque
+
+struct HealthTotals {
+    uint32_t samples[HEALTH_CHANNELS]; //readings that went into each channel
+    uint32_t missedConversions[HEALTH_CELLS]; //HX711 conversions that were replaced by the next before we read them
+    uint32_t rpmEdges; //marker edges counted
+    uint32_t rpmGlitches; //edges thrown out as bounce
+    uint32_t adcOverruns; //analog averages lost before they were read
+    uint32_t sdBytes;
+    uint32_t loops; //test loop passes with the motor running
+    uint32_t loopOverruns; //passes longer than a load cell conversion, one could have gone missing
+};
+
+struct HealthRates { //per second between two snapshots
+    float samples[HEALTH_CHANNELS];
+    float rpmEdges;
+    float sdBytes;
+};
+
+class HealthCounters {
+public:
+    HealthTotals totals = {};
+    uint32_t maxSdWriteMicros = 0; //since clearMaxima()
+    uint32_t maxLoopMicros = 0;
+
+    void sample(uint8_t channel) { totals.samples[channel]++; }
+
+    //cell 0 thrust, 1 torque. Only call while something should be reading every conversion, a long enough
+    //gap between reads counts the ones that must have been skipped
+    void loadCellRead(uint8_t cell, unsigned long atMicros, unsigned long periodMicros);
+
+    void sdWrite(uint32_t bytes, unsigned long micros);
+
+    void loopPass(unsigned long nowMicros, unsigned long budgetMicros); //once per test loop pass
+
+    //after anything that holds the test loop up on purpose (prompts, a burst), the gap before the next
+    //read or pass isn't counted
+    void resume() { cellRead[0] = cellRead[1] = false; looping = false; }
+
+    void clearMaxima() { maxSdWriteMicros = 0; maxLoopMicros = 0; }
+
+    //true about once a second, when rates() has been brought up to date
+    bool update(unsigned long nowMillis);
+    const HealthRates& rates() const { return latest; }
+
+    static void ratesBetween(const HealthTotals& from, const HealthTotals& to, unsigned long millis, HealthRates* out);
+
+private:
+    unsigned long lastCellRead[HEALTH_CELLS] = {0, 0};
+    bool cellRead[HEALTH_CELLS] = {false, false};
+    unsigned long lastLoop = 0;
+    bool looping = false;
+    HealthTotals snapshot = {};
+    unsigned long snapshotAt = 0; //millis()
+    HealthRates latest = {};
+};
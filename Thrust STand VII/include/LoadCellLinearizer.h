@@ -0,0 +1,54 @@
+#pragma once
+//Multi-point load cell calibration. The known loads are fitted with a polynomial through zero (up to
+//cubic) in tared counts, which is then compiled into a small fixed point table over the calibrated
+//range, so converting a sample is one shift, one table step and one 32 bit multiply.
+
+#include <Arduino.h>
+
+struct LinearizationFit { //what gets saved with the calibration, the table is rebuilt from this at boot
+    float coef[3]; //load = c0*x + c1*x^2 + c2*x^3 with x = counts/countScale
+    float countScale; //0 means no multi-point calibration
+    int32_t lowCounts; //calibrated range, outside it the fit is carried on as a straight line
+    int32_t highCounts;
+};
+
+class LoadCellLinearizer {
+public:
+    static const uint8_t MAX_POINTS = 8;
+    static const uint8_t SEGMENTS = 32;
+    static const uint8_t FRACTION_BITS = 8; //table holds load units * 256
+
+    //least squares fit through the origin, degree goes up with the point count (max cubic). counts are tared.
+    static bool fit(const int32_t* counts, const float* loads, uint8_t n, LinearizationFit& out);
+    static float evaluateFit(const LinearizationFit& fit, float counts); //straight from the polynomial, for checking the table
+
+    void build(const LinearizationFit& fit); //compiles the table, an empty fit turns the linearizer off
+    void clear();
+
+    bool active() const { return enabled; }
+    const LinearizationFit& fitParams() const { return params; }
+
+    int32_t evaluate(int32_t counts) const { //tared counts to fixed point load, this is the per sample path
+        int32_t x = counts - low;
+        if (x < 0) {
+            return table[0] + (int32_t)(x * lowSlope);
+        }
+        uint32_t idx = (uint32_t)x >> shift;
+        if (idx >= SEGMENTS) {
+            return table[SEGMENTS] + (int32_t)((x - ((int32_t)SEGMENTS << shift)) * highSlope);
+        }
+        uint8_t frac = shift >= FRACTION_BITS ? (uint8_t)(x >> (shift - FRACTION_BITS)) : (uint8_t)(x << (FRACTION_BITS - shift));
+        return table[idx] + (((table[idx + 1] - table[idx]) * (int32_t)frac) >> FRACTION_BITS);
+    }
+
+    float toUnits(int32_t counts) const { return evaluate(counts) * (1.0f / (1 << FRACTION_BITS)); }
+
+private:
+    LinearizationFit params = {{0, 0, 0}, 0, 0, 0};
+    bool enabled = false;
+    int32_t low = 0;
+    uint8_t shift = 0; //each segment is 2^shift counts wide
+    float lowSlope = 0; //fixed point load per count off the ends of the table
+    float highSlope = 0;
+    int32_t table[SEGMENTS + 1];
+};
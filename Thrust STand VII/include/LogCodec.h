@@ -0,0 +1,60 @@
+#pragma once
+//Compressed test log (.dlg). Each row is scaled to integers and stored as the change from the previous row,
+//zigzag varint coded, so a steady channel costs a bit in a mask and a slowly moving one a byte or two.
+//
+//    header   "TSLG" version channelCount keyframeInterval resolution[channelCount] (float, counts per unit)
+//    block    0xA5 0x5A keyframe(channelCount absolute varints) record* 0xE5 crc_lo crc_hi
+//    record   mask(bit 7 clear, bit i-1 set if channel i changed) varint(time delta) varint(delta)*
+//    note     0xEE length text[length] crc_lo crc_hi      (between records, e.g. a safety trip)
+//
+//Blocks restart from a keyframe every keyframeInterval rows and carry their own CRC (Crc16.h) over
+//everything after the sync bytes except notes, so a damaged block costs at most that many rows and the
+//reader picks up again at the next sync. Encoding a row is a fixed amount of work and never needs more
+//than LOG_MAX_RECORD bytes of buffer. No Arduino includes, the decoder in tools/ builds it as plain C++.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LOG_MAGIC "TSLG"
+#define LOG_FORMAT_VERSION 1
+#define LOG_CHANNELS 8 //time first, it changes every row so it isn't in the mask
+#define LOG_KEYFRAME_INTERVAL 32
+#define LOG_HEADER_SIZE (4 + 3 + 4 * LOG_CHANNELS)
+#define LOG_SYNC1 0xA5
+#define LOG_SYNC2 0x5A
+#define LOG_TAG_END 0xE5
+#define LOG_TAG_NOTE 0xEE
+#define LOG_MAX_VARINT 5
+#define LOG_MAX_RECORD (3 + 2 + LOG_CHANNELS * LOG_MAX_VARINT) //worst case: end of the last block plus a keyframe
+#define LOG_MAX_NOTE 160 //fits the adaptive logging line
+
+enum LogChannel : uint8_t {LOG_TIME, LOG_CURRENT, LOG_VOLTAGE, LOG_TORQUE, LOG_THRUST, LOG_RPM, LOG_AIRSPEED, LOG_THROTTLE};
+
+extern const float logChannelResolution[LOG_CHANNELS]; //counts per unit: ms, mA, mV, 0.01 N.mm, 0.1 mN, 0.1 RPM, cm/s, 0.1%
+
+inline uint32_t zigzagEncode(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+inline int32_t zigzagDecode(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+uint8_t writeVarint(uint32_t value, uint8_t* out); //returns bytes written, at most LOG_MAX_VARINT
+uint8_t readVarint(const uint8_t* in, size_t available, uint32_t* value); //returns bytes used, 0 if cut off or too long
+
+class LogEncoder {
+public:
+    uint8_t header(uint8_t* out); //LOG_HEADER_SIZE bytes, also resets the encoder
+
+    //one row in engineering units (seconds for time), returns the bytes to write. out needs LOG_MAX_RECORD
+    uint8_t encode(const float* values, uint8_t* out);
+
+    //text line between rows, out needs LOG_MAX_NOTE + 4. Longer text is cut off
+    uint8_t note(const char* text, uint8_t* out);
+
+    uint8_t finish(uint8_t* out); //closes the open block, call before closing the file. At most 3 bytes
+
+private:
+    uint8_t startBlock(const int32_t* values, uint8_t* out);
+    uint8_t put(uint8_t* out, uint8_t length); //adds bytes already in out to the block CRC
+
+    int32_t previous[LOG_CHANNELS];
+    uint8_t rowsInBlock = 0; //0 means no block open
+    uint16_t crc = 0;
+};
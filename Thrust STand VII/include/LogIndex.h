@@ -0,0 +1,52 @@
+#pragma once
+//Segment index for test logs, so the host can seek straight to one segment or step of a long run instead of
+//reading the whole file. Entries (segment, step, test time, byte offset) go out in checkpoints while the test
+//runs, each pointing back at the one before, and a fixed length trailer at the very end points at the last:
+//
+//    #INDEX,<previous checkpoint offset, 0 for the first>,<segment>:<step>:<ms>:<offset>,...
+//    #INDEXEND,<last checkpoint offset, 10 digits>
+//
+//Both are # lines in a CSV log and notes in a compressed one, where every offset is the start of a block so
+//it decodes on its own. A reader takes the trailer from the end and follows the chain back. A file cut short by
+//a reset has no trailer, but its last checkpoint is never far from the end, so only the tail needs searching.
+//No Arduino includes, the decoder in tools/ builds it as plain C++.
+
+#include <stdint.h>
+
+#define LOG_INDEX_PENDING 4 //entries held between checkpoints, so a checkpoint always fits in one note
+#define LOG_INDEX_MAX_TEXT 150
+#define LOG_INDEX_TRAILER_TEXT 20 //"#INDEXEND," and 10 digits
+#define LOG_INDEX_TAG "#INDEX,"
+#define LOG_INDEX_END_TAG "#INDEXEND,"
+
+struct LogIndexEntry {
+    uint8_t segment; //run within the file, the piecewise test has one per prop
+    uint8_t step; //interval of the stepped test, 0 where there are none
+    uint32_t millis; //test time
+    uint32_t offset; //byte in the file where its rows start
+};
+
+class LogIndexer {
+public:
+    void begin() { count = 0; lastCheckpoint = 0; }
+
+    bool add(const LogIndexEntry& entry); //true once it's holding as many as a checkpoint takes
+
+    bool pending() const { return count > 0; }
+
+    //text of a checkpoint that will sit at offset, and empties the held entries. out needs LOG_INDEX_MAX_TEXT + 1
+    void checkpoint(uint32_t offset, char* out);
+
+    //out needs LOG_INDEX_TRAILER_TEXT + 1. False if there's nothing for it to point at
+    bool trailer(char* out) const;
+
+private:
+    LogIndexEntry entries[LOG_INDEX_PENDING];
+    uint8_t count = 0;
+    uint32_t lastCheckpoint = 0;
+};
+
+bool parseIndexTrailer(const char* text, uint32_t* lastCheckpoint);
+
+//entries needs room for LOG_INDEX_PENDING. False if text isn't a checkpoint
+bool parseIndexCheckpoint(const char* text, uint32_t* previous, LogIndexEntry* entries, uint8_t* count);
@@ -0,0 +1,42 @@
+#pragma once
+//Fixed size queue for passing data out of an ISR. One side pushes and the other pops, and neither needs
+//interrupts turned off because each index only ever gets written by one side and is a single byte.
+//SIZE has to be a power of two, one slot is kept empty to tell full from empty.
+
+#include <stdint.h>
+
+template <typename T, uint8_t SIZE>
+class RingBuffer {
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "RingBuffer SIZE must be a power of two");
+
+public:
+    bool push(const T& item) { //false (and the item is dropped) if the queue is full
+        uint8_t next = (head + 1) & (SIZE - 1);
+        if (next == tail) {
+            return false;
+        }
+        buffer[head] = item;
+        __asm__ __volatile__("" ::: "memory"); //item has to be in place before the other side can see it
+        head = next;
+        return true;
+    }
+
+    bool pop(T& item) { //false if there's nothing queued
+        if (head == tail) {
+            return false;
+        }
+        item = buffer[tail];
+        __asm__ __volatile__("" ::: "memory");
+        tail = (tail + 1) & (SIZE - 1);
+        return true;
+    }
+
+    bool empty() const { return head == tail; }
+    uint8_t count() const { return (head - tail) & (SIZE - 1); }
+    void clear() { tail = head; } //consumer side only
+
+private:
+    T buffer[SIZE];
+    volatile uint8_t head = 0; //written by the producer
+    volatile uint8_t tail = 0; //written by the consumer
+};
@@ -0,0 +1,27 @@
+#pragma once
+//Sensorless RPM from the commutation ripple on the battery current, to check the optical counter against.
+//A six step ESC moves the current on to the next pair of phases six times per electrical turn and the bus
+//current dips at every switch, so the ripple comes in at 6 x pole pairs = 3 x poles per turn of the shaft.
+//A burst of fast current readings goes through the vibration FFT, the biggest peak in the band the RPM
+//could be in is taken as the ripple, and where it sits between bins comes from the shape of the peak.
+
+#include <Arduino.h>
+#include "VibrationFft.h"
+
+#define RIPPLE_PER_POLE 3 //ripple cycles per turn for every magnet pole
+
+struct RippleEstimate {
+    float rpm; //0 if nothing stood out of the noise
+    float prominence; //peak over the average bin around it in the band
+};
+
+class RippleRpm {
+public:
+    //the burst has to be in spectrum.samples() (VIB_FFT_SIZE current readings at sampleHz), it gets
+    //analysed in place. Only ripple for minRpm up to maxRpm is looked for
+    static RippleEstimate estimate(VibrationSpectrum& spectrum, float sampleHz, uint8_t poles, float minRpm, float maxRpm);
+
+    static float rippleHz(float rpm, uint8_t poles) { return rpm * poles * RIPPLE_PER_POLE / 60.0f; }
+
+    static float disagreement(float rippleRpm, float opticalRpm); //percent of the optical reading
+};
@@ -0,0 +1,68 @@
+#pragma once
+//Limit checks that run from the 1 kHz system tick instead of the main loop. The main loop publishes each
+//round of readings and the tick compares the latest ones against the limits, so a trip only waits on the
+//next tick and not on a slow screen update or SD write. Readings the tick gets hold of itself (a sensor node
+//packet, the current ADC) go in between rounds, so a stalled main loop doesn't leave it checking an old
+//sample. The supervisor just decides, the caller cuts the ESC.
+
+#include <Arduino.h>
+
+enum TripCause : uint8_t {TRIP_NONE, TRIP_THRUST, TRIP_TORQUE, TRIP_CURRENT, TRIP_RPM, TRIP_STALE_DATA};
+
+struct SafetyLimits { //a limit of 0 turns that check off
+    float maxThrust; //mN
+    float maxTorque; //N.mm
+    float maxCurrent; //amps
+    float maxRpm;
+    uint16_t staleMillis; //trip if no readings come in for this long while armed
+};
+
+enum SafetyField : uint8_t {SAFETY_THRUST = 1, SAFETY_TORQUE = 2, SAFETY_CURRENT = 4, SAFETY_RPM = 8};
+
+struct SafetySample {
+    float thrust; //mN
+    float torque; //N.mm
+    float current; //amps
+    float rpm;
+};
+
+struct SafetyTrip {
+    TripCause cause;
+    float value; //reading that tripped it (ms since the last sample for TRIP_STALE_DATA)
+    float limit;
+    unsigned long at; //millis() when it tripped
+};
+
+class SafetySupervisor {
+public:
+    void setLimits(const SafetyLimits& newLimits);
+    void arm(unsigned long nowMillis); //start checking, clears any old trip
+    void disarm();
+
+    void publish(const SafetySample& sample, unsigned long nowMillis); //main loop side, after each round of readings
+
+    //tick side, only the readings in fields (SafetyField bits) are taken. These don't count for the stale data
+    //check, that one is about the main loop's rounds still coming in
+    void update(const SafetySample& sample, uint8_t fields);
+
+    //tick side, call with interrupts off (i.e. from the ISR). Returns true only on the tick it trips
+    bool check(unsigned long nowMillis);
+
+    bool armed() const { return isArmed; }
+    bool tripped() const { return tripCause != TRIP_NONE; }
+    SafetyTrip lastTrip() const; //safe to call from the main loop
+
+    static const char* causeLabel(TripCause cause);
+
+private:
+    bool trip(TripCause cause, float value, float limit, unsigned long nowMillis);
+
+    SafetyLimits limits = {0, 0, 0, 0, 0};
+    SafetySample latest = {0, 0, 0, 0};
+    volatile unsigned long lastSampleAt = 0;
+    volatile bool isArmed = false;
+    volatile TripCause tripCause = TRIP_NONE;
+    float tripValue = 0;
+    float tripLimit = 0;
+    unsigned long tripAt = 0;
+};
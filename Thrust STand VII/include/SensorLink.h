@@ -0,0 +1,66 @@
+#pragma once
+//Binary link from the sensor node (Nano, src/sensor_arduino) to the UI board (Mega). Each frame is
+//    0xA5 0x5A type length payload[length] crc_lo crc_hi
+//with the CRC (Crc16.h) taken over type, length and payload. Fields are little endian, which is what both
+//AVRs and x86 use, so payloads are copied straight in and out of the packed structs below.
+//No Arduino includes in here, the pty stand-ins in sim/link build it as plain C++.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SENSOR_LINK_BAUD 250000 //exact on a 16 MHz AVR, 115200 would be 2% off
+#define SENSOR_LINK_SYNC1 0xA5
+#define SENSOR_LINK_SYNC2 0x5A
+#define SENSOR_LINK_OVERHEAD 6 //two sync bytes, type, length and the CRC
+#define SENSOR_LINK_MAX_PAYLOAD 48
+#define SENSOR_LINK_SAMPLE_PERIOD 10000 //us between sample packets from the node
+
+enum SensorLinkType : uint8_t {LINK_SAMPLE = 1};
+
+enum SampleFlags : uint8_t { //which load cells converted since the previous packet
+    SAMPLE_THRUST = 0x01,
+    SAMPLE_TORQUE = 0x02,
+};
+
+struct __attribute__((packed)) SamplePacket { //all times are node micros()
+    uint16_t sequence; //goes up by one every packet, a gap means frames got lost
+    uint32_t sentAt; //when the frame was handed to the UART
+    uint8_t flags;
+    int32_t thrustCounts; //raw HX711 counts, the UI board holds the calibration
+    uint32_t thrustAt; //when DOUT went low
+    int32_t torqueCounts;
+    uint32_t torqueAt;
+    uint16_t voltageCounts; //ADC average over the packet window x16 (0-16368)
+    uint16_t currentCounts;
+    uint16_t airspeedCounts;
+    uint32_t analogAt; //middle of the averaging window
+    uint16_t rpmEdges; //marker edges (rising and falling) in the window
+    uint32_t rpmWindow; //us the edges were counted over, the window ends at sentAt
+};
+
+//writes a whole frame into out (needs length + SENSOR_LINK_OVERHEAD bytes) and returns its size
+uint8_t encodeSensorFrame(uint8_t type, const void* payload, uint8_t length, uint8_t* out);
+
+class SensorLinkParser { //feed it bytes as they come in, it finds the frames and checks them
+public:
+    bool feed(uint8_t byte); //true when the byte completed a frame that passed its CRC
+
+    uint8_t type() const { return frameType; }
+    uint8_t length() const { return frameLength; }
+    const uint8_t* payload() const { return buffer; }
+
+    uint32_t goodFrames = 0;
+    uint32_t crcErrors = 0;
+    uint32_t lengthErrors = 0; //length byte bigger than any payload, i.e. a false sync
+
+private:
+    enum State : uint8_t {WAIT_SYNC1, WAIT_SYNC2, READ_TYPE, READ_LENGTH, READ_PAYLOAD, READ_CRC_LO, READ_CRC_HI};
+
+    State state = WAIT_SYNC1;
+    uint8_t frameType = 0;
+    uint8_t frameLength = 0;
+    uint8_t received = 0;
+    uint16_t crc = 0;
+    uint16_t frameCrc = 0;
+    uint8_t buffer[SENSOR_LINK_MAX_PAYLOAD];
+};
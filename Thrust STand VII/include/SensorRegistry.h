@@ -0,0 +1,127 @@
+#pragma once
+//Compile time list of sensor channels. Each sensor is a type with static members (no objects, no virtuals):
+//
+//    typedef ... Raw;                         what read() hands back, counts or whatever the part gives
+//    static const char* label();             CSV column heading, units included
+//    static const char* key();               name in the Serial status line, no spaces
+//    static const char* screenLabel();       a few letters for the debug page
+//    static constexpr uint8_t DECIMALS;      places in the log and on the screen
+//    static constexpr unsigned long PERIOD_MICROS;  shortest gap between reads, 0 reads whenever ready() says so
+//    static constexpr bool HOLDS_ROWS;       true if rows wait for this channel like they do for the load cells
+//    static void begin();                    pin setup, once at boot
+//    static bool ready();                    a reading can be taken now
+//    static Raw read();
+//    static float convert(Raw raw);          into the units in the label
+//
+//SensorRegistry<A, B, C> runs through the list by recursion on the template arguments, so every loop below is
+//unrolled into straight calls to A::read(), B::read()... and an empty list compiles to nothing at all.
+//Values come out in list order, values[0] is A.
+
+#include <Arduino.h>
+#include "TimedChannel.h"
+
+template<typename S>
+struct SensorSlot { //newest readings of one sensor, one of these exists per type in the list
+    static TimedChannel channel;
+    static unsigned long lastRead; //micros()
+};
+template<typename S> TimedChannel SensorSlot<S>::channel;
+template<typename S> unsigned long SensorSlot<S>::lastRead = 0;
+
+template<typename... Sensors>
+struct SensorRegistry;
+
+template<>
+struct SensorRegistry<> { //end of the list
+    static constexpr uint8_t COUNT = 0;
+    static constexpr uint8_t SLOTS = 1; //array size that's still legal with nothing registered
+
+    static void begin() {}
+    static void clear() {}
+    static void sample(unsigned long) {}
+    static unsigned long oldestAge(unsigned long, unsigned long oldest, unsigned long) { return oldest; }
+    static void align(unsigned long, float*) {}
+    static void printHeader(Print&) {}
+    static void printValues(Print&, const float*) {}
+    static void printStatus(Print&, const float*) {}
+    static void labels(String&) {}
+    template<typename Display>
+    static void draw(Display&, int16_t, int16_t, int16_t, const float*) {}
+};
+
+template<typename S, typename... Rest>
+struct SensorRegistry<S, Rest...> {
+    typedef SensorRegistry<Rest...> Next;
+    typedef SensorSlot<S> Slot;
+    static constexpr uint8_t COUNT = 1 + Next::COUNT;
+    static constexpr uint8_t SLOTS = COUNT;
+
+    static void begin() {
+        S::begin();
+        Next::begin();
+    }
+
+    static void clear() {
+        Slot::channel.clear();
+        Slot::lastRead = 0;
+        Next::clear();
+    }
+
+    static void sample(unsigned long now) { //reads whatever is due, stamped with the middle of the read like sampleChannel()
+        if ((!Slot::channel.count || now - Slot::lastRead >= S::PERIOD_MICROS) && S::ready()) {
+            unsigned long start = micros();
+            typename S::Raw raw = S::read();
+            Slot::channel.add(S::convert(raw), start + (micros() - start)/2);
+            Slot::lastRead = now;
+        }
+        Next::sample(now);
+    }
+
+    //folds into alignmentTime(), a sensor past staleLimit is left out the same way a quiet load cell is
+    static unsigned long oldestAge(unsigned long now, unsigned long oldest, unsigned long staleLimit) {
+        if (S::HOLDS_ROWS && !Slot::channel.empty() && Slot::channel.ageAt(now) <= staleLimit && Slot::channel.ageAt(now) > oldest) {
+            oldest = Slot::channel.ageAt(now);
+        }
+        return Next::oldestAge(now, oldest, staleLimit);
+    }
+
+    static void align(unsigned long at, float* values) {
+        values[0] = Slot::channel.valueAt(at);
+        Next::align(at, values + 1);
+    }
+
+    static void printHeader(Print& out) { //each column starts with its comma, they go after the last built in one
+        out.print(',');
+        out.print(S::label());
+        Next::printHeader(out);
+    }
+
+    static void printValues(Print& out, const float* values) {
+        out.print(',');
+        out.print(values[0], S::DECIMALS);
+        Next::printValues(out, values + 1);
+    }
+
+    static void printStatus(Print& out, const float* values) {
+        out.print(' ');
+        out.print(S::key());
+        out.print('=');
+        out.print(values[0], S::DECIMALS);
+        Next::printStatus(out, values + 1);
+    }
+
+    static void labels(String& out) { //each key with a space in front, for notes
+        out += ' ';
+        out += S::key();
+        Next::labels(out);
+    }
+
+    template<typename Display>
+    static void draw(Display& screen, int16_t x, int16_t y, int16_t lineHeight, const float* values) { //one row each
+        screen.setCursor(x, y);
+        screen.print(S::screenLabel());
+        screen.print(": ");
+        screen.print(values[0], S::DECIMALS);
+        Next::draw(screen, x, y + lineHeight, lineHeight, values + 1);
+    }
+};
@@ -0,0 +1,46 @@
+#pragma once
+//The last two readings of one sensor channel, each stamped with micros() at the moment it was taken.
+//Lets readings that were taken at different times be lined up on one instant by interpolating between them.
+
+#include <stdint.h>
+
+struct TimedChannel {
+    float value = 0; //newest reading
+    float previousValue = 0;
+    unsigned long at = 0; //micros() when value was taken
+    unsigned long previousAt = 0;
+    uint8_t count = 0; //readings so far, stops at 2
+
+    void add(float newValue, unsigned long takenAt) {
+        if (count == 0) { //the first reading stands in for both until there's a second
+            previousValue = newValue;
+            previousAt = takenAt;
+        } else {
+            previousValue = value;
+            previousAt = at;
+        }
+        value = newValue;
+        at = takenAt;
+        if (count < 2) count++;
+    }
+
+    void clear() { *this = TimedChannel(); }
+    bool empty() const { return count == 0; }
+
+    //value at time t, interpolated between the two readings. Outside them it holds the nearest one,
+    //extrapolating a noisy sensor would only make things worse. Differences keep it safe across micros() wrapping
+    float valueAt(unsigned long t) const {
+        long sinceNewest = (long)(t - at);
+        if (sinceNewest >= 0) {
+            return value;
+        }
+        long sincePrevious = (long)(t - previousAt);
+        if (sincePrevious <= 0) {
+            return previousValue;
+        }
+        float fraction = (float)sincePrevious / (float)(at - previousAt);
+        return previousValue + (value - previousValue) * fraction;
+    }
+
+    unsigned long ageAt(unsigned long now) const { return now - at; } //us since the newest reading
+};
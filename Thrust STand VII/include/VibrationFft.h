@@ -0,0 +1,46 @@
+#pragma once
+//Vibration spectra from a burst of samples: Hann window, in place fixed point radix-2 FFT, magnitudes.
+//Everything is int16 (Q15) so a 256 point transform fits in 1KB of the Mega's RAM and takes tens of ms
+//instead of the better part of a second in float. Each stage halves its outputs so nothing can overflow,
+//which leaves X[k]/N at the end. The samples are shifted up or down by a power of two first so the
+//largest one lands just under a half of full scale, that keeps the low bits from being lost to the halving.
+
+#include <Arduino.h>
+
+#define VIB_FFT_BITS 8
+#define VIB_FFT_SIZE (1 << VIB_FFT_BITS)
+#define VIB_BINS (VIB_FFT_SIZE / 2 + 1) //DC to Nyquist
+
+void fftFixed(int16_t* re, int16_t* im, uint8_t bits); //in place, bits up to VIB_FFT_BITS. Outputs are X[k]/N
+
+class VibrationSpectrum {
+public:
+    int32_t* samples() { return buffer.raw; } //capture VIB_FFT_SIZE readings in here, then analyse()
+
+    void analyse(); //the samples are gone afterwards, the buffer holds the magnitudes instead
+
+    uint16_t magnitude(uint16_t bin) const { return bin < VIB_BINS ? buffer.spectrum.magnitude[bin] : 0; }
+
+    //biggest bin within halfWidth of centre, for a peak whose frequency is only roughly known
+    uint16_t peakBin(float centre, uint8_t halfWidth) const;
+
+    //amplitude of a sine in that bin, in sample units. Adds up the bins either side as well, so a tone
+    //that falls between two bins still reads within a percent or so
+    float amplitude(uint16_t bin) const;
+
+    float binAmplitude(uint16_t bin) const; //the bin on its own, reads up to 15% low for a tone between two bins
+
+private:
+    union { //the readings are read out in order as they're turned into int16, so they can share the space
+        int32_t raw[VIB_FFT_SIZE];
+        struct {
+            int16_t re[VIB_FFT_SIZE];
+            int16_t im[VIB_FFT_SIZE];
+        } complex;
+        struct {
+            uint16_t magnitude[VIB_BINS];
+        } spectrum;
+    } buffer;
+    float sampleScale() const; //undoes the shift
+    int8_t shift = 0; //the samples were scaled by 2^shift before the transform
+};
@@ -0,0 +1,107 @@
+#pragma once
+//Stand-in for the Arduino core when the firmware is built natively. Only covers what the stand uses,
+//timing is handed to the virtual clock in SimBench.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+//the bench and the host side tools use these, pull them in before abs() becomes a macro below
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <avr/pgmspace.h> //the real core pulls this in too
+#include "WString.h"
+#include "Print.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+//the avr core uses macros for these, keep the same semantics (abs works on floats)
+#define abs(x) ((x)>0?(x):-(x))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define sq(x) ((x)*(x))
+
+template <typename A, typename B> typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <typename A, typename B> typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+//Mega analog pins
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+#define A8 62
+#define A9 63
+#define A10 64
+#define A11 65
+#define A12 66
+#define A13 67
+#define A14 68
+#define A15 69
+
+#define NOT_AN_INTERRUPT -1
+int digitalPinToInterrupt(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void noInterrupts();
+void interrupts();
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud);
+    void end() {}
+    int available();
+    int read();
+    int peek();
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t c) override;
+    using Print::write;
+    operator bool() { return true; }
+
+private:
+    unsigned long byteMicros = 1042; //9600 baud until begin() is called
+    uint64_t txDoneAt = 0; //virtual time the TX buffer empties
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1; //nothing is ever received, so the firmware reads its sensors itself
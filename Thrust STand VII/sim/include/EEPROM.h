@@ -0,0 +1,25 @@
+#pragma once
+//EEPROM stand-in, 4 KB like the Mega and blank (0xFF) at the start of every bench run
+
+#include <Arduino.h>
+#include "SimBench.h"
+
+class EEPROMClass {
+public:
+    uint8_t read(int idx) { return sim::eeprom()[idx]; }
+    void write(int idx, uint8_t val) { sim::eeprom()[idx] = val; }
+    void update(int idx, uint8_t val) { sim::eeprom()[idx] = val; }
+    uint8_t& operator[](int idx) { return sim::eeprom()[idx]; }
+    uint16_t length() { return sim::eeprom().size(); }
+
+    template <typename T> T& get(int idx, T& t) {
+        memcpy(&t, &sim::eeprom()[idx], sizeof(T));
+        return t;
+    }
+    template <typename T> const T& put(int idx, const T& t) {
+        memcpy(&sim::eeprom()[idx], &t, sizeof(T));
+        return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,31 @@
+#pragma once
+//HX711 stand-in with the same interface as bogde/HX711. Conversions come from the bench load cell
+//wired to the DOUT pin, at the rate the real board converts.
+
+#include <Arduino.h>
+
+class HX711 {
+public:
+    void begin(byte dout, byte pd_sck, byte gain = 128) { DOUT = dout; PD_SCK = pd_sck; set_gain(gain); }
+    bool is_ready();
+    void set_gain(byte gain = 128) { GAIN = gain; }
+    long read();
+    void wait_ready(unsigned long delay_ms = 0);
+    long read_average(byte times = 10);
+    double get_value(byte times = 1) { return read_average(times) - OFFSET; }
+    float get_units(byte times = 1) { return get_value(times) / SCALE; }
+    void tare(byte times = 10) { set_offset(read_average(times)); }
+    void set_scale(float scale = 1.f) { SCALE = scale; }
+    float get_scale() { return SCALE; }
+    void set_offset(long offset = 0) { OFFSET = offset; }
+    long get_offset() { return OFFSET; }
+    void power_down() {}
+    void power_up() {}
+
+private:
+    byte PD_SCK = 0;
+    byte DOUT = 0;
+    byte GAIN = 128;
+    long OFFSET = 0;
+    float SCALE = 1;
+};
@@ -0,0 +1,13 @@
+#pragma once
+//Keypad stand-in, keys come from the bench key script
+
+#include <Arduino.h>
+
+#define NO_KEY '\0'
+#define makeKeymap(x) ((char*)x)
+
+class Keypad {
+public:
+    Keypad(char* userKeymap, byte* row, byte* col, byte numRows, byte numCols) {}
+    char getKey();
+};
@@ -0,0 +1,48 @@
+#pragma once
+//SD stand-in, files live in memory for the length of a bench run and can be dumped to the host after
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+#define FILE_READ 0x01
+#define FILE_WRITE 0x13
+
+class File : public Print {
+public:
+    File() {}
+    File(const std::string& name, uint8_t mode);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    using Print::write;
+    int read();
+    int peek();
+    int available();
+    void flush();
+    bool seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void close();
+    const char* name() { return state ? state->name.c_str() : ""; }
+    operator bool() { return state != nullptr; }
+
+private:
+    struct State {
+        std::string name;
+        uint32_t position;
+        uint32_t unflushed; //bytes sitting in the library's block buffer
+    };
+    std::shared_ptr<State> state;
+};
+
+class SDClass {
+public:
+    bool begin(uint8_t csPin = 10);
+    File open(const char* filename, uint8_t mode = FILE_READ);
+    bool exists(const char* filename);
+    bool remove(const char* filename);
+    bool mkdir(const char* filepath) { return true; }
+};
+
+extern SDClass SD;
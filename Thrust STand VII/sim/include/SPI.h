@@ -0,0 +1,4 @@
+#pragma once
+//SPI is only pulled in for the SD card, which the bench fakes at the file level
+
+#include <Arduino.h>
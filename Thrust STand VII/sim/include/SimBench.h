@@ -0,0 +1,204 @@
+#pragma once
+//Native test bench for the thrust stand firmware. The fake Arduino headers in this folder route every
+//hardware call (servo, HX711, analogRead, RPM interrupt, keypad, screen, SD) into this bench, which
+//runs the motor/prop plant on a virtual clock. Time only moves when the firmware does something that
+//takes time on the real board, so a full test runs in a few milliseconds of wall time.
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+
+namespace sim {
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//PLANT MODEL
+
+struct PlantConfig {
+    //ESC (maps pulse width to output duty)
+    float escMinPulse = 1100; //us where the ESC starts driving the motor
+    float escMaxPulse = 1940; //us at full duty
+    float escIdleCurrent = 0.05; //amps the ESC draws on its own
+
+    //motor
+    float kv = 920; //rpm per volt
+    int motorPoles = 14; //magnets in the bell, the bus current ripples 3 times per pole per turn
+    float rippleDepth = 0.08; //commutation ripple on the bus current, as a fraction of it
+    float windingResistance = 0.12; //ohms
+    float noLoadCurrent = 0.6; //amps, stands in for bearing and iron losses
+    float rotorInertia = 3.5e-5; //kg.m^2, motor bell plus propeller
+    float ambientTemp = 22; //C
+    float statorHeatCapacity = 40; //J/K
+    float statorCooling = 0.5; //W/K to the air around it
+
+    //propeller, Ct and Cq are quadratics in advance ratio J = V/(n*D)
+    float diameter = 0.254; //m (10 inch)
+    float ct[3] = {0.105f, -0.02f, -0.14f};
+    float cq[3] = {0.0064f, 0.0f, -0.008f};
+    float airDensity = 1.2; //kg/m^3
+    float standDragArea = 0.002; //m^2, drag coefficient times frontal area of the stand in the tunnel flow
+
+    //battery
+    int cells = 4;
+    float capacityAh = 5.0;
+    float internalResistance = 0.02; //ohms for the whole pack
+    float cellFullVoltage = 4.2;
+    float cellEmptyVoltage = 3.3;
+};
+
+struct PlantState {
+    float escPulse = 0; //us
+    float duty = 0; //0-1
+    float omega = 0; //rad/s
+    double angle = 0; //rad, total turned since the start of the run
+    float rpm = 0;
+    float thrust = 0; //N
+    float torque = 0; //N.m, reaction torque on the stand
+    float motorCurrent = 0; //amps in the windings
+    float busCurrent = 0; //amps out of the battery
+    float busVoltage = 0; //volts at the ESC
+    float chargeUsed = 0; //Ah
+    float airspeed = 0; //m/s
+    float motorTemp = 0; //C, stator, warmed by the copper losses
+};
+
+class Plant {
+public:
+    explicit Plant(const PlantConfig& config = PlantConfig());
+
+    void setEscPulse(float pulseMicros);
+    void setAirspeed(float airspeed);
+    void step(float dt); //advance the dynamics by dt seconds
+
+    const PlantState& state() const { return s; }
+    const PlantConfig& config() const { return cfg; }
+
+private:
+    PlantConfig cfg;
+    PlantState s;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//BENCH WIRING
+
+struct LoadCellConfig {
+    uint8_t doutPin;
+    float countsPerUnit; //raw counts per mN or per N.mm, what the stand would calibrate to
+    long zeroCounts; //raw reading with no load on the cell
+    float noiseCounts; //peak noise
+    float samplesPerSecond; //10 or 80 depending on the RATE pin of the board
+    uint8_t clkPin; //PD_SCK, for readers that bit bang the chip themselves
+};
+
+struct BenchConfig {
+    PlantConfig plant;
+
+    //these match the pin definitions in main.cpp
+    uint8_t rpmPin = 2;
+    uint8_t escPin = 3;
+    uint8_t currentPin = 56; //A2
+    uint8_t voltagePin = 57; //A3
+    uint8_t airspeedPin = 61; //A7
+    uint8_t vibrationPin = 58; //A4
+    uint8_t motorTempPin = 59; //A5, only read in builds with -D MOTOR_TEMPERATURE
+    LoadCellConfig thrustCell = {46, 42.0f, 81234, 30.0f, 10.0f, 47}; //mN
+    LoadCellConfig torqueCell = {48, 210.0f, -41877, 30.0f, 10.0f, 49}; //N.mm
+
+    int rpmMarkers = 4; //reflective markers on the prop, every edge fires the interrupt
+    float currentSensitivity = 0.020; //V per amp
+    float currentZeroVoltage = 0.0; //sensor output at zero current
+    float voltageDivider = 21; //bus volts per pin volt
+    float airspeedZeroVoltage = 2.7; //pressure sensor output with no airflow
+    float airspeedSensitivity = 1.0; //V per kPa
+    float accelZeroVoltage = 1.65; //accelerometer output at rest
+    float accelSensitivity = 0.3; //V per g
+    float imbalanceG = 0.4; //1x (prop imbalance) at 6000 RPM, goes up with the square of the speed
+    float bladePassG = 0.15; //2x (blade pass on a two blade prop), same scaling
+    float thermistorNominal = 10000; //ohms at 25C, same part as ExtraSensors.h
+    float thermistorBeta = 3950;
+    float thermistorPullup = 10000; //ohms to 5V
+    float analogNoiseCounts = 1.0;
+
+    float airspeed = 0; //m/s of tunnel flow
+    bool sdCardInserted = true;
+
+    //cost of each primitive on a 16MHz Mega, in microseconds
+    uint32_t plantStepMicros = 100;
+    uint32_t digitalReadMicros = 4; //so polling loops (HX711 is_ready) still move time forward
+    uint32_t analogReadMicros = 112; //at the core's ADC prescaler of 128, the sim scales it with ADCSRA
+    uint32_t hx711ReadMicros = 180; //HX711 library read(), 25 clock pulses through digitalWrite/digitalRead
+    uint32_t portAccessNanos = 250; //one PORTx/PINx load or store from FastPin, PORTL is outside the I/O space so lds/sts
+    uint32_t keypadScanMicros = 20;
+    uint32_t displaySendMicros = 26000; //1 KB frame over 400kHz I2C
+    uint32_t sdBlockWriteMicros = 2000;
+    uint32_t sdFlushMicros = 4000;
+    uint32_t sdInitMicros = 30000;
+    uint32_t sdInitFailMicros = 2000000; //the SD library waits out its init timeout when there's no card
+
+    uint32_t timeLimitMillis = 600000; //stop the run if the firmware gets stuck waiting
+    bool echoSerial = false;
+    bool echoReplies = false; //print the firmware's @ reply lines to the Serial command interface
+};
+
+//thrown out of the firmware when the run has to stop (watchdog, time limit)
+struct Halt {
+    std::string reason;
+};
+
+struct BenchStats {
+    uint64_t serialBytes = 0;
+    uint64_t framesSent = 0;
+    uint64_t sdBytes = 0;
+    uint64_t sdFlushes = 0;
+    uint64_t rpmEdges = 0;
+    uint64_t hx711Reads = 0;
+    uint64_t analogReads = 0;
+    float peakRpm = 0;
+    float peakThrust = 0; //N
+    float peakBusCurrent = 0;
+    float minBusVoltage = 1e9;
+};
+
+void begin(const BenchConfig& config); //resets the clock, plant, SD card, EEPROM and key script
+BenchConfig& config();
+Plant& plant();
+BenchStats& stats();
+
+uint64_t nowMicros();
+void advance(uint64_t micros); //moves the virtual clock, stepping the plant and firing interrupts on the way
+void advanceToNextStep(); //to the next plant step, for a busy wait that can't see anything change before then
+
+//keypad script, keys come out of getKey() in order once their time has come
+void pressKey(char key, uint32_t atMillis = 0);
+char nextKey();
+
+//host on the other end of Serial. Each line goes out once the firmware has answered the one before it
+//(an @ok or @err line), a "wait <ms>" line holds the next one back that long instead of being sent
+void sendSerialLine(const std::string& line);
+bool serialScriptDone(); //everything sent and answered
+
+//hooks used by the fake peripherals
+void attachInterruptHandler(uint8_t interruptNum, void (*handler)());
+void detachInterruptHandler(uint8_t interruptNum);
+void setInterruptsEnabled(bool enabled);
+int analogCounts(uint8_t pin);
+int digitalLevel(uint8_t pin);
+int pinLevel(uint8_t pin); //same without the digitalRead cost, for port reads
+void pinOutput(uint8_t pin, uint8_t level); //a pin driven by digitalWrite or a PORTx write, clocks the HX711s
+void spendNanos(uint32_t nanos); //for costs under a microsecond, they add up until they're worth one
+int serialAvailable(); //Serial RX, from the script above
+int serialRead();
+void serialOutput(uint8_t c); //Serial TX, watched for replies
+bool loadCellReady(uint8_t doutPin);
+void quietLoadCell(int cell, uint64_t fromMicros, uint64_t untilMicros); //0 thrust, 1 torque stops converting in that bench time, like an unplugged board
+long loadCellRead(uint8_t doutPin); //blocks until a conversion is ready, like the real chip
+void watchdogEnable(uint32_t timeoutMillis);
+void watchdogReset();
+void watchdogDisable();
+
+//in-memory SD card and EEPROM so every run starts from a known state
+std::map<std::string, std::vector<uint8_t>>& sdFiles();
+std::vector<uint8_t>& eeprom();
+bool dumpSdFiles(const std::string& directory); //copy the card contents to the host
+
+} // namespace sim
@@ -0,0 +1,56 @@
+#pragma once
+//U8g2 stand-in. Drawing is free, sendBuffer() costs the I2C time of a full frame.
+
+#include <Arduino.h>
+
+typedef uint8_t u8g2_uint_t;
+
+struct u8g2_cb_t {};
+static const u8g2_cb_t u8g2_cb_r0 = {};
+#define U8G2_R0 (&u8g2_cb_r0)
+#define U8X8_PIN_NONE 255
+
+//fonts are only handles here
+#define SIM_U8G2_FONT(name) static const uint8_t name[1] = {0};
+SIM_U8G2_FONT(u8g2_font_4x6_tr)
+SIM_U8G2_FONT(u8g2_font_5x7_tr)
+SIM_U8G2_FONT(u8g2_font_5x8_tr)
+SIM_U8G2_FONT(u8g2_font_6x10_tr)
+SIM_U8G2_FONT(u8g2_font_6x12_tr)
+SIM_U8G2_FONT(u8g2_font_squeezed_r6_tr)
+SIM_U8G2_FONT(u8g2_font_t0_12b_tr)
+SIM_U8G2_FONT(u8g2_font_t0_13b_tr)
+SIM_U8G2_FONT(u8g2_font_t0_14b_tr)
+SIM_U8G2_FONT(u8g2_font_t0_16b_tr)
+SIM_U8G2_FONT(u8g2_font_t0_22b_tr)
+
+class U8G2 : public Print {
+public:
+    bool begin() { return true; }
+    void clearBuffer() {}
+    void sendBuffer();
+    void setFont(const uint8_t* font) {}
+    void setFontMode(uint8_t mode) {}
+    void setBitmapMode(uint8_t mode) {}
+    void setDrawColor(uint8_t color) {}
+    void setCursor(u8g2_uint_t x, u8g2_uint_t y) {}
+    u8g2_uint_t drawStr(u8g2_uint_t x, u8g2_uint_t y, const char* s) { return strlen(s) * 6; }
+    u8g2_uint_t getStrWidth(const char* s) { return strlen(s) * 6; }
+    void drawPixel(u8g2_uint_t x, u8g2_uint_t y) {}
+    void drawLine(u8g2_uint_t x1, u8g2_uint_t y1, u8g2_uint_t x2, u8g2_uint_t y2) {}
+    void drawHLine(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w) {}
+    void drawVLine(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t h) {}
+    void drawBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h) {}
+    void drawFrame(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h) {}
+    void drawRBox(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h, u8g2_uint_t r) {}
+    void drawRFrame(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h, u8g2_uint_t r) {}
+    void drawXBM(u8g2_uint_t x, u8g2_uint_t y, u8g2_uint_t w, u8g2_uint_t h, const uint8_t* bitmap) {}
+    size_t write(uint8_t c) override { return 1; }
+    using Print::write;
+};
+
+class U8G2_SSD1309_128X64_NONAME0_F_HW_I2C : public U8G2 {
+public:
+    U8G2_SSD1309_128X64_NONAME0_F_HW_I2C(const u8g2_cb_t* rotation, uint8_t reset = U8X8_PIN_NONE,
+                                         uint8_t clock = U8X8_PIN_NONE, uint8_t data = U8X8_PIN_NONE) {}
+};
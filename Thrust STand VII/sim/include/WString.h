@@ -0,0 +1,55 @@
+#pragma once
+//Minimal Arduino String, backed by std::string
+
+#include <stdlib.h>
+#include <string>
+
+class String {
+public:
+    String(const char* str = "") : s(str ? str : "") {}
+    String(const std::string& str) : s(str) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    unsigned int length() const { return s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    char charAt(unsigned int index) const { return index < s.size() ? s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    String& operator+=(const String& rhs) { s += rhs.s; return *this; }
+    String& operator+=(const char* rhs) { s += rhs; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    String& operator+=(int value) { return *this += String(value); }
+    String& operator+=(long value) { return *this += String(value); }
+    String& operator+=(unsigned int value) { return *this += String(value); }
+    String& operator+=(unsigned long value) { return *this += String(value); }
+
+    bool operator==(const String& rhs) const { return s == rhs.s; }
+    bool operator==(const char* rhs) const { return s == rhs; }
+    bool operator!=(const String& rhs) const { return s != rhs.s; }
+    bool operator!=(const char* rhs) const { return s != rhs; }
+
+    void remove(unsigned int index) { if (index < s.size()) s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < s.size()) s.erase(index, count); }
+    void trim();
+    void toUpperCase();
+    int indexOf(char c, unsigned int from = 0) const;
+    String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const;
+    bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s.c_str(), nullptr); }
+
+    friend String operator+(const String& lhs, const String& rhs) { return String(lhs.s + rhs.s); }
+    friend String operator+(const String& lhs, const char* rhs) { return String(lhs.s + rhs); }
+    friend String operator+(const char* lhs, const String& rhs) { return String(lhs + rhs.s); }
+    friend String operator+(const String& lhs, char c) { return String(lhs.s + c); }
+
+private:
+    std::string s;
+};
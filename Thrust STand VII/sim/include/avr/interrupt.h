@@ -0,0 +1,11 @@
+#pragma once
+//ISR() declares a plain function the bench calls when the matching timer fires
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void)
+
+#define TIMER2_COMPA_vect sim_isr_timer2_compa
+
+void sei();
+void cli();
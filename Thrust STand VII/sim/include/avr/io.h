@@ -0,0 +1,84 @@
+#pragma once
+//AVR registers as plain variables. The bench reads the timer registers to run timer interrupts at
+//whatever rate the firmware configured.
+
+#include <stdint.h>
+
+//timer 3 (16 bit)
+extern volatile uint8_t TCCR3A;
+extern volatile uint8_t TCCR3B;
+extern volatile uint16_t TCNT3;
+extern volatile uint16_t ICR3;
+extern volatile uint16_t OCR3A;
+extern volatile uint16_t OCR3B;
+extern volatile uint16_t OCR3C;
+
+#define WGM30 0
+#define WGM31 1
+#define COM3C0 2
+#define COM3C1 3
+#define COM3B0 4
+#define COM3B1 5
+#define COM3A0 6
+#define COM3A1 7
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define WGM32 3
+#define WGM33 4
+
+//timer 2 (8 bit)
+extern volatile uint8_t TCCR2A;
+extern volatile uint8_t TCCR2B;
+extern volatile uint8_t TCNT2;
+extern volatile uint8_t OCR2A;
+extern volatile uint8_t OCR2B;
+extern volatile uint8_t TIMSK2;
+extern volatile uint8_t TIFR2;
+
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+
+//ADC, only the clock prescaler does anything. An analogRead takes longer or shorter with it
+extern volatile uint8_t ADCSRA;
+
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADEN 7
+
+//GPIO ports. These are objects rather than plain bytes so the bench sees every access: clock edges
+//written to PORTx reach the bit banged HX711s, and PINx reads come back with their DOUT levels.
+//Each access costs BenchConfig::portAccessNanos.
+class SimPort {
+public:
+    enum Kind : uint8_t {OUT, IN, DIR};
+    constexpr SimPort(char port, Kind kind) : port(port), kind(kind) {}
+
+    operator uint8_t();
+    SimPort& operator=(uint8_t value);
+    SimPort& operator|=(uint8_t bits) { return *this = (uint8_t)(*this | bits); }
+    SimPort& operator&=(uint8_t bits) { return *this = (uint8_t)(*this & bits); }
+    SimPort& operator^=(uint8_t bits) { return *this = (uint8_t)(*this ^ bits); }
+
+private:
+    char port;
+    Kind kind;
+    uint8_t value = 0;
+};
+
+#define SIM_PORT(X) extern SimPort PORT##X; extern SimPort PIN##X; extern SimPort DDR##X;
+SIM_PORT(A) SIM_PORT(B) SIM_PORT(C) SIM_PORT(D) SIM_PORT(E) SIM_PORT(F)
+SIM_PORT(G) SIM_PORT(H) SIM_PORT(J) SIM_PORT(K) SIM_PORT(L)
+#undef SIM_PORT
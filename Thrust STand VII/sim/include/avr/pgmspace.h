@@ -0,0 +1,10 @@
+#pragma once
+//Flash and RAM are the same thing on the host, PROGMEM data is read like any other
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define pgm_read_float(address) (*(const float*)(address))
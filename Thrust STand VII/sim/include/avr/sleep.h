@@ -0,0 +1,11 @@
+#pragma once
+//Sleeping hands the time to the bench until the next plant step, interrupts keep running
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_DOWN 2
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable();
+void sleep_disable();
+void sleep_cpu();
+void sleep_mode();
@@ -0,0 +1,238 @@
+//Stand-ins for the two ends of the sensor link, talking over a pseudo terminal so the framing, CRC and
+//resync can be exercised without a Nano or a Mega.
+//
+//    link_standin node [--corrupt N]   streams synthetic samples at 100 Hz, prints the pty to open
+//    link_standin ui PATH              decodes frames from PATH and prints them with the link stats
+//    link_standin selftest             both ends over one pty with corruption and garbage thrown in
+
+#include "SensorLink.h"
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint32_t nowMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+static bool makeRaw(int fd) {
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static int openNodePty(char* path, size_t size) { //master end, path gets the slave the ui end opens
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        return -1;
+    }
+    snprintf(path, size, "%s", ptsname(fd));
+    makeRaw(fd);
+    return fd;
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t length) {
+    while (length) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//NODE END
+
+static SamplePacket syntheticSample(uint16_t sequence, uint32_t now) { //a motor slowly spinning up and down
+    float phase = sequence * 0.01f;
+    float load = 0.5f - 0.5f * cosf(phase);
+    SamplePacket packet;
+    packet.sequence = sequence;
+    packet.sentAt = now;
+    packet.flags = SAMPLE_THRUST | ((sequence & 1) ? SAMPLE_TORQUE : 0); //torque cell at half the rate
+    packet.thrustCounts = 8400 + (int32_t)(load * 2000000);
+    packet.thrustAt = now - 3000;
+    packet.torqueCounts = -12000 + (int32_t)(load * 400000);
+    packet.torqueAt = now - 7000;
+    packet.voltageCounts = (uint16_t)((760 - load * 40) * 16);
+    packet.currentCounts = (uint16_t)((512 + load * 300) * 16);
+    packet.airspeedCounts = (uint16_t)(205 * 16);
+    packet.analogAt = now - SENSOR_LINK_SAMPLE_PERIOD / 2;
+    packet.rpmEdges = (uint16_t)(load * 60);
+    packet.rpmWindow = SENSOR_LINK_SAMPLE_PERIOD;
+    return packet;
+}
+
+static int runNode(int corruptEvery) {
+    char path[128];
+    int fd = openNodePty(path, sizeof(path));
+    if (fd < 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    printf("%s\n", path);
+    fflush(stdout);
+
+    uint16_t sequence = 0;
+    uint8_t frame[sizeof(SamplePacket) + SENSOR_LINK_OVERHEAD];
+    for (;;) {
+        SamplePacket packet = syntheticSample(sequence, nowMicros());
+        uint8_t length = encodeSensorFrame(LINK_SAMPLE, &packet, sizeof(packet), frame);
+        if (corruptEvery > 0 && sequence % corruptEvery == 0) {
+            frame[4 + sequence % sizeof(SamplePacket)] ^= 0x10; //one flipped bit, the CRC has to catch it
+        }
+        write(fd, frame, length); //nobody listening yet is fine, the pty just fills up
+        sequence++;
+        usleep(SENSOR_LINK_SAMPLE_PERIOD);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//UI END
+
+static int runUi(const char* path) {
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0 || !makeRaw(fd)) {
+        perror(path);
+        return 1;
+    }
+
+    SensorLinkParser parser;
+    bool sequenceValid = false;
+    uint16_t lastSequence = 0;
+    unsigned long dropped = 0;
+    uint8_t bytes[256];
+    for (;;) {
+        ssize_t n = read(fd, bytes, sizeof(bytes));
+        if (n <= 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (!parser.feed(bytes[i]) || parser.type() != LINK_SAMPLE || parser.length() != sizeof(SamplePacket)) {
+                continue;
+            }
+            SamplePacket packet;
+            memcpy(&packet, parser.payload(), sizeof(packet));
+            if (sequenceValid) {
+                dropped += (uint16_t)(packet.sequence - lastSequence - 1);
+            }
+            lastSequence = packet.sequence;
+            sequenceValid = true;
+            printf("seq %5u thrust %8ld torque %8ld V %5u I %5u air %5u edges %3u | good %lu crc %lu len %lu dropped %lu\n",
+                packet.sequence, (long)packet.thrustCounts, (long)packet.torqueCounts, packet.voltageCounts,
+                packet.currentCounts, packet.airspeedCounts, packet.rpmEdges, (unsigned long)parser.goodFrames,
+                (unsigned long)parser.crcErrors, (unsigned long)parser.lengthErrors, dropped);
+        }
+    }
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SELF TEST
+
+struct SelfTestReceiver {
+    static const int CORRUPT_EVERY = 7; //every 7th frame gets a flipped bit and never arrives
+
+    SensorLinkParser parser;
+    int received = 0;
+    int mismatches = 0;
+    uint16_t nextExpected = 0;
+
+    void drain(int fd, int timeoutMillis) { //reads whatever has come through so the pty never fills
+        uint8_t bytes[256];
+        pollfd pfd = {fd, POLLIN, 0};
+        while (poll(&pfd, 1, timeoutMillis) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t n = read(fd, bytes, sizeof(bytes));
+            if (n <= 0) break;
+            for (ssize_t i = 0; i < n; i++) {
+                if (parser.feed(bytes[i])) check();
+            }
+        }
+    }
+
+    void check() {
+        while (nextExpected % CORRUPT_EVERY == 3) nextExpected++;
+        SamplePacket got;
+        SamplePacket want = selfTestSample(nextExpected);
+        memcpy(&got, parser.payload(), sizeof(got));
+        if (parser.type() != LINK_SAMPLE || parser.length() != sizeof(got) || memcmp(&got, &want, sizeof(got)) != 0) {
+            mismatches++;
+        }
+        nextExpected++;
+        received++;
+    }
+
+    static SamplePacket selfTestSample(uint16_t sequence) {
+        return syntheticSample(sequence, 1000000 + sequence * SENSOR_LINK_SAMPLE_PERIOD);
+    }
+};
+
+static int runSelfTest() {
+    const int FRAMES = 500;
+    const int GARBAGE_EVERY = 11; //noise with fake sync bytes between frames
+
+    char path[128];
+    int master = openNodePty(path, sizeof(path));
+    int slave = master < 0 ? -1 : open(path, O_RDWR | O_NOCTTY);
+    if (slave < 0 || !makeRaw(slave)) {
+        perror("pty");
+        return 1;
+    }
+
+    SelfTestReceiver ui;
+    int expectedGood = 0;
+    uint8_t frame[sizeof(SamplePacket) + SENSOR_LINK_OVERHEAD];
+    for (int sequence = 0; sequence < FRAMES; sequence++) {
+        SamplePacket sent = SelfTestReceiver::selfTestSample(sequence);
+        uint8_t length = encodeSensorFrame(LINK_SAMPLE, &sent, sizeof(sent), frame);
+        if (sequence % SelfTestReceiver::CORRUPT_EVERY == 3) {
+            frame[4 + sequence % sizeof(SamplePacket)] ^= 0x01;
+        } else {
+            expectedGood++;
+        }
+        if (sequence % GARBAGE_EVERY == 5) {
+            const uint8_t garbage[] = {0x00, SENSOR_LINK_SYNC1, SENSOR_LINK_SYNC1, 0x13, SENSOR_LINK_SYNC1, SENSOR_LINK_SYNC2, LINK_SAMPLE, 0xFF};
+            writeAll(master, garbage, sizeof(garbage));
+        }
+        writeAll(master, frame, length);
+        ui.drain(slave, 0);
+    }
+    ui.drain(slave, 100); //last few bytes
+
+    int corrupted = FRAMES - expectedGood;
+    printf("frames %d, good %d/%d, crc errors %lu (%d corrupted), length errors %lu, mismatches %d\n", FRAMES, ui.received,
+        expectedGood, (unsigned long)ui.parser.crcErrors, corrupted, (unsigned long)ui.parser.lengthErrors, ui.mismatches);
+    close(slave);
+    close(master);
+    bool pass = ui.received == expectedGood && ui.mismatches == 0 && ui.parser.crcErrors >= (unsigned long)corrupted;
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "node") == 0) {
+        int corruptEvery = (argc >= 4 && strcmp(argv[2], "--corrupt") == 0) ? atoi(argv[3]) : 0;
+        return runNode(corruptEvery);
+    }
+    if (argc >= 3 && strcmp(argv[1], "ui") == 0) {
+        return runUi(argv[2]);
+    }
+    if (argc >= 2 && strcmp(argv[1], "selftest") == 0) {
+        return runSelfTest();
+    }
+    fprintf(stderr, "usage: %s node [--corrupt N] | ui PATH | selftest\n", argv[0]);
+    return 2;
+}
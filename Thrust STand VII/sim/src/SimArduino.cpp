@@ -0,0 +1,404 @@
+//Arduino core functions for the native bench
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "SimBench.h"
+#include "FastGpio.h"
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+unsigned long millis() {
+    return (unsigned long)(sim::nowMicros() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)sim::nowMicros();
+}
+
+void delay(unsigned long ms) {
+    sim::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    sim::advance(us);
+}
+
+static uint8_t pinModes[70];
+static uint8_t pinOutputs[70];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < sizeof(pinModes)) pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < sizeof(pinOutputs)) pinOutputs[pin] = val;
+    sim::pinOutput(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+    return sim::digitalLevel(pin);
+}
+
+int analogRead(uint8_t pin) {
+    if (pin < A0) pin += A0; //channel numbers work the same as pin numbers
+    return sim::analogCounts(pin);
+}
+
+int digitalPinToInterrupt(uint8_t pin) {
+    switch (pin) {
+        case 2: return 0;
+        case 3: return 1;
+        case 21: return 2;
+        case 20: return 3;
+        case 19: return 4;
+        case 18: return 5;
+        default: return NOT_AN_INTERRUPT;
+    }
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(), int mode) {
+    sim::attachInterruptHandler(interruptNum, userFunc);
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+    sim::detachInterruptHandler(interruptNum);
+}
+
+void noInterrupts() {
+    sim::setInterruptsEnabled(false);
+}
+
+void interrupts() {
+    sim::setInterruptsEnabled(true);
+}
+
+void sei() {
+    sim::setInterruptsEnabled(true);
+}
+
+void cli() {
+    sim::setInterruptsEnabled(false);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//REGISTERS AND SLEEP
+
+volatile uint8_t TCCR3A;
+volatile uint8_t TCCR3B;
+volatile uint16_t TCNT3;
+volatile uint16_t ICR3;
+volatile uint16_t OCR3A;
+volatile uint16_t OCR3B;
+volatile uint16_t OCR3C;
+
+volatile uint8_t TCCR2A;
+volatile uint8_t TCCR2B;
+volatile uint8_t TCNT2;
+volatile uint8_t OCR2A;
+volatile uint8_t OCR2B;
+volatile uint8_t TIMSK2;
+volatile uint8_t TIFR2;
+
+volatile uint8_t ADCSRA;
+
+#define SIM_PORT(X) SimPort PORT##X(#X[0], SimPort::OUT); SimPort PIN##X(#X[0], SimPort::IN); SimPort DDR##X(#X[0], SimPort::DIR);
+SIM_PORT(A) SIM_PORT(B) SIM_PORT(C) SIM_PORT(D) SIM_PORT(E) SIM_PORT(F)
+SIM_PORT(G) SIM_PORT(H) SIM_PORT(J) SIM_PORT(K) SIM_PORT(L)
+#undef SIM_PORT
+
+struct PortPins {
+    uint8_t count;
+    uint8_t pins[8];
+};
+
+static const PortPins& portPins(char port) { //the pins on each port, worked out once instead of walking all of them every access
+    static PortPins table['L' - 'A' + 1];
+    static bool built = false;
+    if (!built) {
+        for (uint8_t pin = 0; pin < FAST_PIN_COUNT; pin++) {
+            PortPins& entry = table[fastPinPort(pin) - 'A'];
+            entry.pins[entry.count++] = pin;
+        }
+        built = true;
+    }
+    return table[port - 'A'];
+}
+
+//a while(!isReady()) spin reads the same port over and over with nothing else going on. Levels only change when the
+//plant steps, so once a spin has gone on for a few reads the clock goes straight to the next step instead of
+//getting there 250ns at a time. Any port write (an HX711 read clocking bits out) starts the count again
+#define BUSY_POLL_READS 16
+static char pollPort = 0;
+static uint8_t pollLevels = 0;
+static uint64_t pollAt = 0;
+static uint8_t pollRepeats = 0;
+
+SimPort::operator uint8_t() {
+    sim::spendNanos(sim::config().portAccessNanos);
+    if (kind != IN) {
+        return value;
+    }
+    const PortPins& entry = portPins(port);
+    uint8_t levels = 0;
+    for (uint8_t i = 0; i < entry.count; i++) {
+        if (sim::pinLevel(entry.pins[i])) levels |= fastPinMask(entry.pins[i]);
+    }
+
+    uint64_t now = sim::nowMicros();
+    if (port == pollPort && levels == pollLevels && now - pollAt <= 1) {
+        if (++pollRepeats >= BUSY_POLL_READS) {
+            sim::advanceToNextStep();
+            pollRepeats = 0;
+        }
+    } else {
+        pollRepeats = 0;
+    }
+    pollPort = port;
+    pollLevels = levels;
+    pollAt = sim::nowMicros();
+    return levels;
+}
+
+SimPort& SimPort::operator=(uint8_t newValue) {
+    sim::spendNanos(sim::config().portAccessNanos);
+    pollRepeats = 0;
+    if (kind == IN) {
+        //writing a 1 to PINx toggles that bit of PORTx
+        SimPort& out = fastPortOut(port);
+        out = out.value ^ newValue;
+        return *this;
+    }
+    uint8_t changed = value ^ newValue;
+    value = newValue;
+    if (kind == OUT) {
+        const PortPins& entry = portPins(port);
+        for (uint8_t i = 0; i < entry.count; i++) {
+            uint8_t mask = fastPinMask(entry.pins[i]);
+            if (changed & mask) sim::pinOutput(entry.pins[i], (newValue & mask) ? HIGH : LOW);
+        }
+    }
+    return *this;
+}
+
+void set_sleep_mode(uint8_t mode) {}
+void sleep_enable() {}
+void sleep_disable() {}
+
+void sleep_cpu() { //idle until something interrupts, the bench only checks between plant steps
+    sim::advance(sim::config().plantStepMicros);
+}
+
+void sleep_mode() {
+    sleep_cpu();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SERIAL
+
+void HardwareSerial::begin(unsigned long baud) {
+    byteMicros = 10000000UL / baud; //start + 8 data + stop bits
+}
+
+int HardwareSerial::available() { return this == &Serial ? sim::serialAvailable() : 0; }
+int HardwareSerial::read() { return this == &Serial ? sim::serialRead() : -1; }
+int HardwareSerial::peek() { return -1; }
+
+int HardwareSerial::availableForWrite() {
+    const uint64_t bufferSize = 64;
+    uint64_t now = sim::nowMicros();
+    uint64_t queued = txDoneAt > now ? (txDoneAt - now + byteMicros - 1) / byteMicros : 0;
+    return queued >= bufferSize ? 0 : (int)(bufferSize - 1 - queued);
+}
+
+void HardwareSerial::flush() {
+    uint64_t now = sim::nowMicros();
+    if (txDoneAt > now) {
+        sim::advance(txDoneAt - now);
+    }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    //the core has a 64 byte TX buffer, once it's full print() blocks until the UART drains a byte
+    const uint64_t bufferSize = 64;
+    uint64_t now = sim::nowMicros();
+    if (txDoneAt < now) {
+        txDoneAt = now;
+    }
+    if (txDoneAt - now >= bufferSize * byteMicros) {
+        sim::advance(txDoneAt - now - (bufferSize - 1) * byteMicros);
+    }
+    txDoneAt += byteMicros;
+
+    sim::stats().serialBytes++;
+    if (this == &Serial) {
+        sim::serialOutput(c);
+    }
+    if (sim::config().echoSerial) {
+        putchar(c);
+    }
+    return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//PRINT
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::write(const char* str) {
+    return str ? write((const uint8_t*)str, strlen(str)) : 0;
+}
+
+size_t Print::print(const String& s) { return write(s.c_str()); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char n, int base) { return print((unsigned long)n, base); }
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) { return print((unsigned long)n, base); }
+size_t Print::print(long n, int base) { return print((long long)n, base); }
+size_t Print::print(unsigned long n, int base) { return print((unsigned long long)n, base); }
+
+size_t Print::print(long long n, int base) {
+    if (base == 0) {
+        return write((uint8_t)n);
+    } else if (base == 10 && n < 0) {
+        return print('-') + printNumber(-(unsigned long long)n, 10);
+    }
+    return printNumber((unsigned long long)n, base);
+}
+
+size_t Print::print(unsigned long long n, int base) {
+    if (base == 0) return write((uint8_t)n);
+    return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) { return printFloat(n, digits); }
+
+size_t Print::println() { return write("\r\n"); }
+size_t Print::println(const String& s) { return print(s) + println(); }
+size_t Print::println(const char str[]) { return print(str) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(long long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+size_t Print::printNumber(unsigned long long n, uint8_t base) {
+    char buf[8 * sizeof(long long) + 1];
+    char* str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) { //same output as the avr core, including nan/inf/ovf
+    size_t n = 0;
+    if (isnan(number)) return print("nan");
+    if (isinf(number)) return print("inf");
+    if (number > 4294967040.0) return print("ovf");
+    if (number < -4294967040.0) return print("ovf");
+
+    if (number < 0.0) {
+        n += print('-');
+        number = -number;
+    }
+
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i) {
+        rounding /= 10.0;
+    }
+    number += rounding;
+
+    unsigned long intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    n += print(intPart);
+
+    if (digits > 0) {
+        n += print('.');
+    }
+    while (digits-- > 0) {
+        remainder *= 10.0;
+        unsigned int toPrint = (unsigned int)remainder;
+        n += print(toPrint);
+        remainder -= toPrint;
+    }
+    return n;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//STRING
+
+static std::string formatInteger(long long value, unsigned char base) {
+    char buf[70];
+    bool negative = value < 0 && base == 10;
+    unsigned long long n = negative ? -(unsigned long long)value : (unsigned long long)value;
+    char* str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    do {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'a' - 10;
+    } while (n);
+    if (negative) *--str = '-';
+    return std::string(str);
+}
+
+String::String(int value, unsigned char base) : s(formatInteger(value, base)) {}
+String::String(unsigned int value, unsigned char base) : s(formatInteger(value, base)) {}
+String::String(long value, unsigned char base) : s(formatInteger(value, base)) {}
+String::String(unsigned long value, unsigned char base) : s(formatInteger((long long)value, base)) {}
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned char decimalPlaces) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+    s = buf;
+}
+
+void String::trim() {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        s.clear();
+        return;
+    }
+    size_t last = s.find_last_not_of(" \t\r\n");
+    s = s.substr(first, last - first + 1);
+}
+
+void String::toUpperCase() {
+    for (char& c : s) {
+        if (c >= 'a' && c <= 'z') c -= 32;
+    }
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = s.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int temp = to;
+        to = from;
+        from = temp;
+    }
+    if (from >= s.size()) return String();
+    if (to > s.size()) to = s.size();
+    return String(s.substr(from, to - from));
+}
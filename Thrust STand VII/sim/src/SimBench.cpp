@@ -0,0 +1,481 @@
+//Virtual clock and sensor wiring for the native bench
+
+#include "SimBench.h"
+#include <avr/io.h>
+#include <math.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <deque>
+
+//timer vectors the firmware may or may not define
+extern "C" void sim_isr_timer2_compa() __attribute__((weak));
+
+namespace sim {
+
+namespace {
+
+void runHandler(int num);
+
+struct KeyEvent {
+    char key;
+    uint64_t at; //us
+};
+
+struct LoadCellState {
+    LoadCellConfig cfg;
+    uint64_t nextConversion; //us, when the next sample lands in the output register
+    long latched; //sample the chip will shift out
+    bool ready; //DOUT low
+    uint8_t clock; //level on PD_SCK
+    uint8_t bitsOut; //clock pulses into a bit banged read, 0 when none is going
+    uint64_t quietFrom; //us, no conversions from here to quietUntil, an unplugged or browned out board
+    uint64_t quietUntil;
+};
+
+const int MAX_INTERRUPTS = 8; //external interrupts 0-5, then the timer vectors
+const int TIMER2_COMPA = 6;
+
+BenchConfig cfg;
+Plant thePlant;
+BenchStats benchStats;
+
+uint64_t now = 0; //us
+uint64_t plantTime = 0; //us, the plant has been stepped up to here
+uint32_t nanosOwed = 0; //spendNanos() time not yet on the clock
+long lastEdgeIndex = 0;
+
+std::deque<KeyEvent> keys;
+std::deque<std::string> serialScript;
+std::string serialRx; //bytes of the line that's been sent, not read yet
+std::string serialTxLine;
+bool awaitingReply = false;
+uint64_t holdUntil = 0; //us, from a wait line
+void (*handlers[MAX_INTERRUPTS])() = {};
+bool pending[MAX_INTERRUPTS] = {};
+bool interruptsOn = true;
+
+LoadCellState cells[2];
+
+bool wdtOn = false;
+uint64_t wdtTimeout = 0;
+uint64_t wdtLastReset = 0;
+
+uint64_t timer2Elapsed = 0; //us since the last timer 2 compare match
+
+uint32_t noiseState = 2463534242u;
+
+std::map<std::string, std::vector<uint8_t>> files;
+std::vector<uint8_t> rom;
+
+float noise(float amplitude) { //xorshift, deterministic so runs repeat exactly
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return amplitude * ((noiseState & 0xFFFF) / 32767.5f - 1.0f);
+}
+
+int interruptForPin(uint8_t pin) { //Mega external interrupt numbering
+    switch (pin) {
+        case 2: return 0;
+        case 3: return 1;
+        case 21: return 2;
+        case 20: return 3;
+        case 19: return 4;
+        case 18: return 5;
+        default: return -1;
+    }
+}
+
+void runHandler(int num) { //interrupts are off inside an ISR, anything that fires meanwhile waits
+    interruptsOn = false;
+    handlers[num]();
+    setInterruptsEnabled(true);
+}
+
+void fireInterrupt(int num) {
+    if (num < 0 || !handlers[num]) {
+        return;
+    }
+    if (interruptsOn) {
+        runHandler(num);
+    } else {
+        pending[num] = true; //the flag stays set and the ISR runs as soon as interrupts come back on
+    }
+}
+
+uint32_t timer2PeriodMicros() { //CTC mode compare A period from the registers, 0 if it isn't running
+    static const uint16_t prescalers[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+    uint16_t prescaler = prescalers[TCCR2B & 0x07];
+    if (!prescaler || !(TIMSK2 & (1 << OCIE2A))) {
+        return 0;
+    }
+    return (uint32_t)prescaler * (OCR2A + 1) / 16; //16 MHz clock
+}
+
+float timer3EscPulse() { //pulse width on OC3C (pin 3) in us, 0 if the output isn't running
+    static const uint16_t prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    uint16_t prescaler = prescalers[TCCR3B & 0x07];
+    if (cfg.escPin != 3 || !prescaler || !(TCCR3A & (1 << COM3C1)) || ICR3 == 0) {
+        return 0;
+    }
+    float pulse = (float)(OCR3C < ICR3 ? OCR3C : ICR3) * prescaler / 16.0f;
+    if (pulse < 500) {
+        pulse *= 8; //OneShot125, the ESC tells the protocols apart by pulse width
+    }
+    return pulse;
+}
+
+LoadCellState* cellForPin(uint8_t doutPin) {
+    for (LoadCellState& cell : cells) {
+        if (cell.cfg.doutPin == doutPin) {
+            return &cell;
+        }
+    }
+    return nullptr;
+}
+
+long cellCounts(const LoadCellState& cell) {
+    const PlantState& s = thePlant.state();
+    float value = (&cell == &cells[0]) ? s.thrust * 1000.0f : s.torque * 1000.0f; //mN and N.mm
+    return cell.cfg.zeroCounts + lround(value * cell.cfg.countsPerUnit + noise(cell.cfg.noiseCounts));
+}
+
+void stepPlant() {
+    thePlant.setEscPulse(timer3EscPulse());
+    thePlant.step(cfg.plantStepMicros / 1e6f);
+    plantTime += cfg.plantStepMicros;
+    if (now < plantTime) now = plantTime;
+
+    //timer interrupts
+    uint32_t timer2Period = timer2PeriodMicros();
+    if (timer2Period) {
+        timer2Elapsed += cfg.plantStepMicros;
+        while (timer2Elapsed >= timer2Period) {
+            timer2Elapsed -= timer2Period;
+            fireInterrupt(TIMER2_COMPA);
+        }
+    }
+
+    //RPM markers, the interrupt is on CHANGE so every marker edge counts
+    const PlantState& s = thePlant.state();
+    long edgeIndex = (long)floor(s.angle * cfg.rpmMarkers / M_PI);
+    while (lastEdgeIndex < edgeIndex) {
+        lastEdgeIndex++;
+        benchStats.rpmEdges++;
+        fireInterrupt(interruptForPin(cfg.rpmPin));
+    }
+
+    //load cell conversions
+    for (LoadCellState& cell : cells) {
+        if (now >= cell.quietFrom && now < cell.quietUntil) {
+            cell.nextConversion = now; //converts straight away once it's back
+        } else if (now >= cell.nextConversion && cell.bitsOut == 0) { //the chip doesn't update the output mid read
+            cell.latched = cellCounts(cell);
+            cell.ready = true;
+            cell.nextConversion += (uint64_t)(1e6f / cell.cfg.samplesPerSecond);
+        }
+    }
+
+    if (s.rpm > benchStats.peakRpm) benchStats.peakRpm = s.rpm;
+    if (s.thrust > benchStats.peakThrust) benchStats.peakThrust = s.thrust;
+    if (s.busCurrent > benchStats.peakBusCurrent) benchStats.peakBusCurrent = s.busCurrent;
+    if (s.busVoltage < benchStats.minBusVoltage) benchStats.minBusVoltage = s.busVoltage;
+
+    if (wdtOn && now - wdtLastReset > wdtTimeout) {
+        throw Halt{"watchdog reset"};
+    }
+    if (now > (uint64_t)cfg.timeLimitMillis * 1000) {
+        throw Halt{"time limit reached"};
+    }
+}
+
+} // namespace
+
+void begin(const BenchConfig& config) {
+    cfg = config;
+    thePlant = Plant(cfg.plant);
+    thePlant.setAirspeed(cfg.airspeed);
+    benchStats = BenchStats();
+    now = 0;
+    plantTime = 0;
+    lastEdgeIndex = 0;
+    keys.clear();
+    serialScript.clear();
+    serialRx.clear();
+    serialTxLine.clear();
+    awaitingReply = false;
+    holdUntil = 0;
+    for (int i = 0; i < MAX_INTERRUPTS; i++) {
+        handlers[i] = nullptr;
+        pending[i] = false;
+    }
+    interruptsOn = true;
+    handlers[TIMER2_COMPA] = sim_isr_timer2_compa;
+    TCCR2B = 0;
+    TIMSK2 = 0;
+    ADCSRA = (1 << ADEN) | 0x07; //what the Arduino core starts the ADC with, a 125kHz clock
+    TCCR3A = 0;
+    TCCR3B = 0;
+    timer2Elapsed = 0;
+    nanosOwed = 0;
+    cells[0] = {cfg.thrustCell, 0, cfg.thrustCell.zeroCounts, false};
+    cells[1] = {cfg.torqueCell, 0, cfg.torqueCell.zeroCounts, false};
+    wdtOn = false;
+    noiseState = 2463534242u;
+    files.clear();
+    rom.assign(4096, 0xFF);
+}
+
+BenchConfig& config() { return cfg; }
+Plant& plant() { return thePlant; }
+BenchStats& stats() { return benchStats; }
+
+uint64_t nowMicros() {
+    return now;
+}
+
+void advance(uint64_t micros) {
+    uint64_t target = now + micros;
+    while (plantTime + cfg.plantStepMicros <= target) {
+        stepPlant();
+    }
+    if (now < target) now = target; //an ISR that ran on the way may already have moved past it
+}
+
+void advanceToNextStep() {
+    nanosOwed = 0; //the spin's part of a microsecond is in the jump
+    uint64_t target = plantTime + cfg.plantStepMicros;
+    advance(target > now ? target - now : 0);
+}
+
+void pressKey(char key, uint32_t atMillis) {
+    keys.push_back({key, (uint64_t)atMillis * 1000});
+}
+
+char nextKey() {
+    advance(cfg.keypadScanMicros);
+    if (!keys.empty() && keys.front().at <= now) {
+        char key = keys.front().key;
+        keys.pop_front();
+        return key;
+    }
+    return '\0';
+}
+
+void attachInterruptHandler(uint8_t interruptNum, void (*handler)()) {
+    if (interruptNum < MAX_INTERRUPTS) {
+        handlers[interruptNum] = handler;
+    }
+}
+
+void detachInterruptHandler(uint8_t interruptNum) {
+    if (interruptNum < MAX_INTERRUPTS) {
+        handlers[interruptNum] = nullptr;
+    }
+}
+
+void setInterruptsEnabled(bool enabled) {
+    interruptsOn = enabled;
+    if (!enabled) {
+        return;
+    }
+    for (int i = 0; i < MAX_INTERRUPTS; i++) {
+        if (pending[i] && interruptsOn) {
+            pending[i] = false;
+            if (handlers[i]) runHandler(i);
+        }
+    }
+}
+
+int analogCounts(uint8_t pin) {
+    uint8_t prescale = ADCSRA & 0x07;
+    advance(cfg.analogReadMicros * (prescale ? 1 << prescale : 2) / 128); //a conversion is 13 ADC clocks, analogReadMicros is at /128
+    benchStats.analogReads++;
+
+    const PlantState& s = thePlant.state();
+    float volts = 0;
+    if (pin == cfg.currentPin) {
+        //the commutation ripple is far quicker than a plant step, so the shaft angle is carried on to now
+        double angle = s.angle + s.omega * (double)(now - plantTime) / 1e6;
+        float commutation = (float)(angle * thePlant.config().motorPoles * 3); //6 per electrical turn
+        float ripple = thePlant.config().rippleDepth * (cosf(commutation) + 0.4f * cosf(2 * commutation + 0.7f));
+        volts = cfg.currentZeroVoltage + s.busCurrent * (1 + ripple) * cfg.currentSensitivity;
+    } else if (pin == cfg.voltagePin) {
+        volts = s.busVoltage / cfg.voltageDivider;
+    } else if (pin == cfg.airspeedPin) {
+        float dynamicPressure = 0.5f * thePlant.config().airDensity * s.airspeed * s.airspeed; //Pa
+        volts = cfg.airspeedZeroVoltage + dynamicPressure / 1000.0f * cfg.airspeedSensitivity;
+    } else if (pin == cfg.vibrationPin) {
+        float speed = s.rpm / 6000.0f;
+        float g = speed * speed * (cfg.imbalanceG * sin(s.angle) + cfg.bladePassG * sin(2 * s.angle + 0.5));
+        volts = cfg.accelZeroVoltage + g * cfg.accelSensitivity;
+    } else if (pin == cfg.motorTempPin) { //NTC to ground under a pullup
+        float ohms = cfg.thermistorNominal * expf(cfg.thermistorBeta * (1.0f / (s.motorTemp + 273.15f) - 1.0f / 298.15f));
+        volts = 5.0f * ohms / (ohms + cfg.thermistorPullup);
+    }
+
+    long counts = lround(volts / 5.0f * 1023.0f + noise(cfg.analogNoiseCounts));
+    if (counts < 0) counts = 0;
+    if (counts > 1023) counts = 1023;
+    return counts;
+}
+
+int digitalLevel(uint8_t pin) {
+    advance(cfg.digitalReadMicros);
+    return pinLevel(pin);
+}
+
+int pinLevel(uint8_t pin) {
+    if (pin == cfg.rpmPin) {
+        return lastEdgeIndex & 1;
+    }
+    LoadCellState* cell = cellForPin(pin);
+    if (cell && cell->bitsOut > 0 && cell->bitsOut <= 24) {
+        return (cell->latched >> (24 - cell->bitsOut)) & 1; //MSB first, valid after each rising edge
+    }
+    if (cell) {
+        return cell->ready ? 0 : 1;
+    }
+    return 0;
+}
+
+void pinOutput(uint8_t pin, uint8_t level) {
+    for (LoadCellState& cell : cells) {
+        if (cell.cfg.clkPin != pin || cell.clock == level) {
+            continue;
+        }
+        cell.clock = level;
+        if (!level || (cell.bitsOut == 0 && !cell.ready)) {
+            continue; //only rising edges shift, and only once there's a conversion to shift out
+        }
+        cell.bitsOut++;
+        if (cell.bitsOut > 24) { //25th pulse ends the read, any more just set the gain
+            cell.bitsOut = 0;
+            cell.ready = false;
+            benchStats.hx711Reads++;
+        }
+    }
+}
+
+void spendNanos(uint32_t nanos) {
+    nanosOwed += nanos;
+    if (nanosOwed >= 1000) {
+        uint32_t whole = nanosOwed / 1000;
+        nanosOwed %= 1000;
+        advance(whole);
+    }
+}
+
+void quietLoadCell(int cell, uint64_t fromMicros, uint64_t untilMicros) {
+    cells[cell].quietFrom = fromMicros;
+    cells[cell].quietUntil = untilMicros;
+}
+
+bool loadCellReady(uint8_t doutPin) {
+    advance(cfg.digitalReadMicros);
+    LoadCellState* cell = cellForPin(doutPin);
+    return cell && cell->ready;
+}
+
+long loadCellRead(uint8_t doutPin) {
+    LoadCellState* cell = cellForPin(doutPin);
+    if (!cell) {
+        return 0;
+    }
+    while (!cell->ready) {
+        advance(cfg.plantStepMicros);
+    }
+    long value = cell->latched;
+    cell->ready = false;
+    advance(cfg.hx711ReadMicros);
+    benchStats.hx711Reads++;
+    return value;
+}
+
+void sendSerialLine(const std::string& line) {
+    serialScript.push_back(line);
+}
+
+bool serialScriptDone() {
+    return serialScript.empty() && serialRx.empty() && !awaitingReply;
+}
+
+int serialAvailable() {
+    while (serialRx.empty() && !awaitingReply && now >= holdUntil && !serialScript.empty()) {
+        std::string line = serialScript.front();
+        serialScript.pop_front();
+        if (line.compare(0, 5, "wait ") == 0) {
+            holdUntil = now + (uint64_t)atol(line.c_str() + 5) * 1000;
+        } else if (line.compare(0, 9, "airspeed ") == 0) { //the tunnel changing speed, for the drag tare sweep
+            thePlant.setAirspeed(atof(line.c_str() + 9));
+        } else {
+            serialRx = line + "\n";
+            awaitingReply = true;
+        }
+    }
+    return (int)serialRx.size();
+}
+
+int serialRead() {
+    if (!serialAvailable()) {
+        return -1;
+    }
+    uint8_t c = serialRx[0];
+    serialRx.erase(0, 1);
+    return c;
+}
+
+void serialOutput(uint8_t c) {
+    if (c == '\r') {
+        return;
+    }
+    if (c != '\n') {
+        serialTxLine += (char)c;
+        return;
+    }
+    if (serialTxLine.compare(0, 3, "@ok") == 0 || serialTxLine.compare(0, 4, "@err") == 0) {
+        awaitingReply = false;
+    }
+    if (cfg.echoReplies && !cfg.echoSerial && serialTxLine[0] == '@') {
+        printf("%s\n", serialTxLine.c_str());
+    }
+    serialTxLine.clear();
+}
+
+void watchdogEnable(uint32_t timeoutMillis) {
+    wdtOn = true;
+    wdtTimeout = (uint64_t)timeoutMillis * 1000;
+    wdtLastReset = now;
+}
+
+void watchdogReset() {
+    wdtLastReset = now;
+}
+
+void watchdogDisable() {
+    wdtOn = false;
+}
+
+std::map<std::string, std::vector<uint8_t>>& sdFiles() {
+    return files;
+}
+
+std::vector<uint8_t>& eeprom() {
+    return rom;
+}
+
+bool dumpSdFiles(const std::string& directory) {
+    mkdir(directory.c_str(), 0755);
+    for (const auto& file : files) {
+        std::string path = directory + "/" + file.first;
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) {
+            return false;
+        }
+        fwrite(file.second.data(), 1, file.second.size(), out);
+        fclose(out);
+    }
+    return true;
+}
+
+} // namespace sim
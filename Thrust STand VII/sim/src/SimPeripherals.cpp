@@ -0,0 +1,175 @@
+//Library stand-ins (HX711, Keypad, U8g2, SD, EEPROM, watchdog) for the native bench
+
+#include <Arduino.h>
+#include <HX711.h>
+#include <Keypad.h>
+#include <U8g2lib.h>
+#include <SD.h>
+#include <EEPROM.h>
+#include <avr/wdt.h>
+#include "SimBench.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//HX711
+
+bool HX711::is_ready() {
+    return sim::loadCellReady(DOUT);
+}
+
+long HX711::read() {
+    return sim::loadCellRead(DOUT);
+}
+
+void HX711::wait_ready(unsigned long delay_ms) {
+    while (!is_ready()) {
+        if (delay_ms) {
+            delay(delay_ms);
+        } else {
+            delayMicroseconds(100);
+        }
+    }
+}
+
+long HX711::read_average(byte times) {
+    long sum = 0;
+    for (byte i = 0; i < times; i++) {
+        sum += read();
+    }
+    return sum / times;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//KEYPAD AND SCREEN
+
+char Keypad::getKey() {
+    return sim::nextKey();
+}
+
+void U8G2::sendBuffer() {
+    sim::advance(sim::config().displaySendMicros);
+    sim::stats().framesSent++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SD CARD
+
+SDClass SD;
+
+bool SDClass::begin(uint8_t csPin) {
+    if (!sim::config().sdCardInserted) {
+        sim::advance(sim::config().sdInitFailMicros);
+        return false;
+    }
+    sim::advance(sim::config().sdInitMicros);
+    return true;
+}
+
+File::File(const std::string& name, uint8_t mode) : state(std::make_shared<State>()) {
+    state->name = name;
+    state->position = (mode == FILE_WRITE) ? sim::sdFiles()[name].size() : 0; //FILE_WRITE appends
+    state->unflushed = 0;
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!state) {
+        return 0;
+    }
+    std::vector<uint8_t>& data = sim::sdFiles()[state->name];
+    if (data.size() < state->position + size) {
+        data.resize(state->position + size);
+    }
+    memcpy(&data[state->position], buf, size);
+    state->position += size;
+    sim::stats().sdBytes += size;
+
+    //the library holds one 512 byte block and writes it out when it fills
+    state->unflushed += size;
+    while (state->unflushed >= 512) {
+        state->unflushed -= 512;
+        sim::advance(sim::config().sdBlockWriteMicros);
+    }
+    return size;
+}
+
+int File::read() {
+    if (!state) return -1;
+    std::vector<uint8_t>& data = sim::sdFiles()[state->name];
+    if (state->position >= data.size()) return -1;
+    return data[state->position++];
+}
+
+int File::peek() {
+    if (!state) return -1;
+    std::vector<uint8_t>& data = sim::sdFiles()[state->name];
+    if (state->position >= data.size()) return -1;
+    return data[state->position];
+}
+
+int File::available() {
+    if (!state) return 0;
+    return sim::sdFiles()[state->name].size() - state->position;
+}
+
+void File::flush() {
+    if (!state) return;
+    state->unflushed = 0;
+    sim::advance(sim::config().sdFlushMicros);
+    sim::stats().sdFlushes++;
+}
+
+bool File::seek(uint32_t pos) {
+    if (!state || pos > sim::sdFiles()[state->name].size()) return false;
+    state->position = pos;
+    return true;
+}
+
+uint32_t File::position() {
+    return state ? state->position : 0;
+}
+
+uint32_t File::size() {
+    return state ? sim::sdFiles()[state->name].size() : 0;
+}
+
+void File::close() {
+    if (!state) return;
+    flush();
+    state.reset();
+}
+
+File SDClass::open(const char* filename, uint8_t mode) {
+    if (mode != FILE_WRITE && !exists(filename)) {
+        return File();
+    }
+    sim::sdFiles()[filename]; //creates the file if it isn't there
+    return File(filename, mode);
+}
+
+bool SDClass::exists(const char* filename) {
+    return sim::sdFiles().count(filename) > 0;
+}
+
+bool SDClass::remove(const char* filename) {
+    return sim::sdFiles().erase(filename) > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//EEPROM AND WATCHDOG
+
+EEPROMClass EEPROM;
+
+void wdt_enable(uint8_t timeout) {
+    sim::watchdogEnable(16UL << timeout); //WDTO_x steps in powers of two from ~16ms
+}
+
+void wdt_reset() {
+    sim::watchdogReset();
+}
+
+void wdt_disable() {
+    sim::watchdogDisable();
+}
@@ -0,0 +1,80 @@
+//Motor, propeller and battery model behind the native bench
+
+#include "SimBench.h"
+#include <math.h>
+
+namespace sim {
+
+Plant::Plant(const PlantConfig& config) : cfg(config) {
+    s.busVoltage = cfg.cells * cfg.cellFullVoltage;
+    s.motorTemp = cfg.ambientTemp;
+}
+
+void Plant::setEscPulse(float pulseMicros) {
+    s.escPulse = pulseMicros;
+}
+
+void Plant::setAirspeed(float airspeed) {
+    s.airspeed = airspeed;
+}
+
+static float quadratic(const float c[3], float x) {
+    return c[0] + c[1] * x + c[2] * x * x;
+}
+
+void Plant::step(float dt) {
+    //ESC: pulse width to duty, nothing below the start pulse
+    float duty = (s.escPulse - cfg.escMinPulse) / (cfg.escMaxPulse - cfg.escMinPulse);
+    if (duty < 0) duty = 0;
+    if (duty > 1) duty = 1;
+    s.duty = duty;
+
+    //battery open circuit voltage falls off linearly with charge used
+    float stateOfCharge = 1.0f - s.chargeUsed / cfg.capacityAh;
+    if (stateOfCharge < 0) stateOfCharge = 0;
+    float openVoltage = cfg.cells * (cfg.cellEmptyVoltage + (cfg.cellFullVoltage - cfg.cellEmptyVoltage) * stateOfCharge);
+
+    //motor electrical side. The bus sags with current, and current depends on the bus, so solve both together:
+    //Vbus = Voc - Rint*d*Im and Im = (d*Vbus - E)/R
+    float ke = 60.0f / (2.0f * (float)M_PI * cfg.kv); //V per rad/s, also N.m per amp
+    float backEmf = ke * s.omega;
+    float R = cfg.windingResistance;
+    float Rint = cfg.internalResistance;
+    float busVoltage = (openVoltage + Rint * duty * backEmf / R) / (1.0f + Rint * duty * duty / R);
+    float motorCurrent = (duty * busVoltage - backEmf) / R;
+    if (motorCurrent < 0) { //the ESC freewheels, no regen
+        motorCurrent = 0;
+        busVoltage = openVoltage;
+    }
+    float busCurrent = duty * motorCurrent + cfg.escIdleCurrent;
+    busVoltage -= Rint * cfg.escIdleCurrent;
+
+    //propeller
+    float n = s.omega / (2.0f * (float)M_PI); //rev/s
+    float D = cfg.diameter;
+    float advanceRatio = n > 1.0f ? s.airspeed / (n * D) : 0;
+    float ct = quadratic(cfg.ct, advanceRatio);
+    float cq = quadratic(cfg.cq, advanceRatio);
+    if (ct < 0) ct = 0;
+    if (cq < 0) cq = 0;
+    float thrust = ct * cfg.airDensity * n * n * D * D * D * D;
+    float propTorque = cq * cfg.airDensity * n * n * D * D * D * D * D;
+
+    //mechanical side, friction is modelled as the no load current
+    float frictionTorque = s.omega > 0 ? ke * cfg.noLoadCurrent : 0;
+    float shaftTorque = ke * motorCurrent - frictionTorque;
+    s.omega += dt * (shaftTorque - propTorque) / cfg.rotorInertia;
+    if (s.omega < 0) s.omega = 0;
+    s.angle += s.omega * dt;
+
+    s.rpm = s.omega * 60.0f / (2.0f * (float)M_PI);
+    s.thrust = thrust - 0.5f * cfg.airDensity * s.airspeed * s.airspeed * cfg.standDragArea; //the flow pushes the stand back too
+    s.torque = shaftTorque > 0 ? shaftTorque : 0;
+    s.motorCurrent = motorCurrent;
+    s.busCurrent = busCurrent;
+    s.busVoltage = busVoltage;
+    s.chargeUsed += busCurrent * dt / 3600.0f;
+    s.motorTemp += dt * (motorCurrent * motorCurrent * R - cfg.statorCooling * (s.motorTemp - cfg.ambientTemp)) / cfg.statorHeatCapacity;
+}
+
+} // namespace sim
@@ -0,0 +1,182 @@
+//Runs one test profile of the real firmware against the plant model and prints a summary.
+//    pio run -e native_sim && .pio/build/native_sim/program --profile stepped
+//Options:
+//    --profile smooth|stepped   which runTest() profile to run (default stepped)
+//    --airspeed <m/s>           tunnel flow during the run
+//    --sd-dir <dir>             copy the SD card contents here afterwards
+//    --no-sd                    boot and run with the card missing
+//    --sd-file <path>           put a host file on the card before boot, under its own name (e.g. CAMPAIGN.TXT)
+//    --verbose                  echo the firmware's Serial output
+//    --command <line>           drive the firmware through the Serial command interface instead of running a
+//                               profile. Repeat for more lines, "wait <ms>" pauses the script and "airspeed <m/s>"
+//                               changes the tunnel flow. Replies are printed
+//    --quiet-cell thrust|torque <from s> <until s>   that HX711 stops converting for a while, seconds into the test
+//    --max-row-gap <s>          exit non-zero if the CSV log ever goes longer than this between rows
+//Built with BENCHMARK_BUILD (env benchmark_native) it only boots, which runs the benchmarks, see benchmark/README
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "SimBench.h"
+
+//firmware entry points and settings (main.cpp)
+extern void setup();
+extern void loop();
+extern void runSmoothRampTest();
+extern void runSteppedRampTest();
+extern long testNumber;
+
+int main(int argc, char** argv) {
+    sim::BenchConfig bench;
+    std::string profile = "stepped";
+    std::string sdDir;
+    bool scripted = false;
+    int quietCell = -1;
+    double quietFrom = 0, quietUntil = 0;
+    double maxRowGap = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--profile" && i + 1 < argc) {
+            profile = argv[++i];
+        } else if (arg == "--airspeed" && i + 1 < argc) {
+            bench.airspeed = atof(argv[++i]);
+        } else if (arg == "--sd-dir" && i + 1 < argc) {
+            sdDir = argv[++i];
+        } else if (arg == "--sd-file" && i + 1 < argc) {
+            i++; //copied once the bench has been reset below
+        } else if (arg == "--quiet-cell" && i + 3 < argc) {
+            quietCell = std::string(argv[++i]) == "torque" ? 1 : 0;
+            quietFrom = atof(argv[++i]);
+            quietUntil = atof(argv[++i]);
+        } else if (arg == "--max-row-gap" && i + 1 < argc) {
+            maxRowGap = atof(argv[++i]);
+        } else if (arg == "--no-sd") {
+            bench.sdCardInserted = false;
+        } else if (arg == "--verbose") {
+            bench.echoSerial = true;
+        } else if (arg == "--command" && i + 1 < argc) {
+            scripted = true;
+            bench.echoReplies = true;
+            i++; //queued once the bench has been reset below
+        } else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 2;
+        }
+    }
+
+#ifdef BENCHMARK_BUILD
+    bench.echoSerial = true; //the report comes out on Serial, grep ^BENCH picks it out
+#endif
+    sim::begin(bench);
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--command") {
+            sim::sendSerialLine(argv[++i]);
+        } else if (std::string(argv[i]) == "--sd-file") {
+            std::string path = argv[++i];
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                fprintf(stderr, "can't read %s\n", path.c_str());
+                return 2;
+            }
+            std::string name = path.substr(path.find_last_of('/') + 1);
+            sim::sdFiles()[name].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+    }
+
+    //the stand has been calibrated before, so EEPROM holds the scale factors setup() loads
+    //(THST_CAL_ADDRESS and TRQ_CAL_ADDRESS in main.cpp)
+    EEPROM.put(0, bench.thrustCell.countsPerUnit);
+    EEPROM.put(100, bench.torqueCell.countsPerUnit);
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t testStart = 0;
+    try {
+        setup();
+#ifdef BENCHMARK_BUILD
+        return 0; //setup() ran the benchmarks, no test this time
+#endif
+
+        testStart = sim::nowMicros();
+        if (quietCell >= 0) {
+            sim::quietLoadCell(quietCell, testStart + (uint64_t)(quietFrom * 1e6), testStart + (uint64_t)(quietUntil * 1e6));
+        }
+        if (scripted) {
+            profile = "commands";
+            while (!sim::serialScriptDone()) { //a command that starts something only returns once it's over
+                loop();
+            }
+        } else if (profile == "smooth") {
+            sim::pressKey('#'); //accept the test number
+            sim::pressKey('#'); //start the test
+            runSmoothRampTest();
+        } else if (profile == "stepped") {
+            sim::pressKey('#');
+            sim::pressKey('#');
+            runSteppedRampTest();
+        } else {
+            fprintf(stderr, "unknown profile %s\n", profile.c_str());
+            return 2;
+        }
+    } catch (const sim::Halt& halt) {
+        fprintf(stderr, "halted at %.3f s: %s\n", sim::nowMicros() / 1e6, halt.reason.c_str());
+        return 1;
+    }
+    double wallMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+    char filename[32];
+    snprintf(filename, sizeof(filename), "Test_%d.csv", (int)testNumber - 1);
+    long rows = 0;
+    double rowGap = 0; //longest time between rows, a log that stops getting rows mid-test shows up here
+    if (sim::sdFiles().count(filename)) {
+        rows = -1; //don't count the header
+        const std::vector<uint8_t>& file = sim::sdFiles()[filename];
+        double lastTime = -1;
+        size_t lineStart = 0;
+        for (size_t i = 0; i < file.size(); i++) {
+            if (file[i] != '\n') continue;
+            rows++;
+            char first = file[lineStart];
+            if (first == '-' || (first >= '0' && first <= '9')) { //a row, not a # note or the header
+                double time = atof(std::string(file.begin() + lineStart, file.begin() + i).c_str());
+                if (lastTime >= 0 && time - lastTime > rowGap) rowGap = time - lastTime;
+                lastTime = time;
+            }
+            lineStart = i + 1;
+        }
+    } else {
+        snprintf(filename, sizeof(filename), "Test_%d.dlg", (int)testNumber - 1); //compressed, rows need tools/log_decode to count
+        if (!sim::sdFiles().count(filename)) {
+            snprintf(filename, sizeof(filename), "none");
+        }
+    }
+
+    const sim::BenchStats& stats = sim::stats();
+    printf("profile: %s\n", profile.c_str());
+    printf("test_time_s: %.3f\n", (sim::nowMicros() - testStart) / 1e6);
+    printf("wall_time_ms: %.2f\n", wallMillis);
+    printf("log_file: %s\n", filename);
+    printf("log_rows: %ld\n", rows);
+    printf("log_rate_hz: %.2f\n", rows / ((sim::nowMicros() - testStart) / 1e6));
+    printf("longest_row_gap_s: %.3f\n", rowGap);
+    printf("peak_rpm: %.0f\n", stats.peakRpm);
+    printf("peak_thrust_n: %.2f\n", stats.peakThrust);
+    printf("peak_bus_current_a: %.2f\n", stats.peakBusCurrent);
+    printf("min_bus_voltage_v: %.2f\n", stats.minBusVoltage);
+    printf("frames_sent: %llu\n", (unsigned long long)stats.framesSent);
+    printf("serial_bytes: %llu\n", (unsigned long long)stats.serialBytes);
+    printf("sd_bytes: %llu\n", (unsigned long long)stats.sdBytes);
+
+    if (!sdDir.empty() && !sim::dumpSdFiles(sdDir)) {
+        fprintf(stderr, "couldn't write SD contents to %s\n", sdDir.c_str());
+        return 1;
+    }
+    if (maxRowGap > 0 && rowGap > maxRowGap) {
+        fprintf(stderr, "rows stopped for %.3f s, more than %.3f\n", rowGap, maxRowGap);
+        return 1;
+    }
+    return 0;
+}
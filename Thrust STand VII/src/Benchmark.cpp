@@ -0,0 +1,32 @@
+#include "Benchmark.h"
+
+void Benchmark::header() {
+    out.println("BENCH name runs mean_us min_us max_us");
+}
+
+void Benchmark::run(const char* name, void (*kernel)(), uint16_t runs, void (*prepare)()) {
+    unsigned long total = 0;
+    unsigned long fastest = 0xFFFFFFFFUL;
+    unsigned long slowest = 0;
+    for (uint16_t i = 0; i < runs; i++) {
+        if (prepare) {
+            prepare();
+        }
+        unsigned long start = micros();
+        kernel();
+        unsigned long elapsed = micros() - start;
+        total += elapsed;
+        if (elapsed < fastest) fastest = elapsed;
+        if (elapsed > slowest) slowest = elapsed;
+    }
+
+    out.print("BENCH "); out.print(name);
+    out.print(' '); out.print(runs);
+    out.print(' '); out.print(runs ? (float)total / runs : 0, 1);
+    out.print(' '); out.print(runs ? fastest : 0);
+    out.print(' '); out.println(slowest);
+}
+
+void Benchmark::skip(const char* name) {
+    out.print("BENCH "); out.print(name); out.println(" 0 0 0 0");
+}
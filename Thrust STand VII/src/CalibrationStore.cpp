@@ -0,0 +1,91 @@
+#include "CalibrationStore.h"
+#include "Crc16.h"
+#include <EEPROM.h>
+
+#define RECORD_MAGIC 0x5443 //"CT"
+
+CalibrationStore::CalibrationStore(int baseAddress, uint8_t slotCount, uint16_t slotSize)
+    : base(baseAddress), slotCount(slotCount), slotSize(slotSize) {}
+
+bool CalibrationStore::readHeader(uint8_t slot, SlotHeader& header) const {
+    int address = slotAddress(slot);
+    EEPROM.get(address, header);
+
+    if (header.magic != RECORD_MAGIC || header.version == 0 || header.length > slotSize - sizeof(SlotHeader)) {
+        return false; //blank (0xFF) or never written
+    }
+
+    //the CRC covers the header (minus the CRC itself) and the payload, straight out of EEPROM
+    uint16_t crc = crc16(&header, sizeof(SlotHeader) - sizeof(header.crc));
+    for (uint16_t i = 0; i < header.length; i++) {
+        crc = crc16Update(crc, EEPROM.read(address + sizeof(SlotHeader) + i));
+    }
+    return crc == header.crc;
+}
+
+void CalibrationStore::scan() { //find the newest valid slot
+    newestSlot = -1;
+    newestSequence = 0;
+    for (uint8_t slot = 0; slot < slotCount; slot++) {
+        SlotHeader header;
+        if (!readHeader(slot, header)) {
+            continue;
+        }
+        if (newestSlot < 0 || (int32_t)(header.sequence - newestSequence) > 0) { //wrap safe comparison
+            newestSlot = slot;
+            newestSequence = header.sequence;
+        }
+    }
+    scanned = true;
+}
+
+uint8_t CalibrationStore::load(void* payload, uint16_t maxSize) {
+    scan();
+    if (newestSlot < 0) {
+        return 0;
+    }
+
+    SlotHeader header;
+    readHeader(newestSlot, header);
+    uint16_t length = min(header.length, maxSize);
+    uint8_t* bytes = (uint8_t*)payload;
+    for (uint16_t i = 0; i < length; i++) {
+        bytes[i] = EEPROM.read(slotAddress(newestSlot) + sizeof(SlotHeader) + i);
+    }
+    return header.version;
+}
+
+bool CalibrationStore::save(uint8_t version, const void* payload, uint16_t size) {
+    if (size > slotSize - sizeof(SlotHeader) || version == 0) {
+        return false;
+    }
+    if (!scanned) {
+        scan();
+    }
+
+    uint8_t slot = (newestSlot < 0) ? 0 : (newestSlot + 1) % slotCount;
+
+    SlotHeader header;
+    header.sequence = newestSequence + 1;
+    header.magic = RECORD_MAGIC;
+    header.length = size;
+    header.version = version;
+    header.reserved = 0;
+    header.crc = crc16(payload, size, crc16(&header, sizeof(SlotHeader) - sizeof(header.crc)));
+
+    //payload first and header last, so the slot only becomes valid once everything is down.
+    //update() skips bytes that already match, which saves a lot of wear on repeated saves.
+    int address = slotAddress(slot);
+    const uint8_t* bytes = (const uint8_t*)payload;
+    for (uint16_t i = 0; i < size; i++) {
+        EEPROM.update(address + sizeof(SlotHeader) + i, bytes[i]);
+    }
+    const uint8_t* headerBytes = (const uint8_t*)&header;
+    for (uint16_t i = 0; i < sizeof(SlotHeader); i++) {
+        EEPROM.update(address + i, headerBytes[i]);
+    }
+
+    newestSlot = slot;
+    newestSequence = header.sequence;
+    return true;
+}
@@ -0,0 +1,39 @@
+#include "Campaign.h"
+#include "CommandLine.h"
+
+CampaignLine parseCampaignLine(char* line, CampaignStep* step) {
+    step->settingCount = 0;
+    bool haveProfile = false;
+
+    char* p = line;
+    while (*p) {
+        while (*p == ' ' || *p == '\t') *p++ = '\0';
+        if (!*p || *p == '#') break; //comment runs to the end of the line
+        char* word = p;
+        char* equals = nullptr;
+        while (*p && *p != ' ' && *p != '\t') {
+            if (*p == '=' && !equals) equals = p;
+            p++;
+        }
+        if (*p) *p++ = '\0';
+
+        if (!haveProfile) {
+            if (equals || !parseNumber(word, &step->profile)) {
+                return CAMPAIGN_BAD;
+            }
+            haveProfile = true;
+            continue;
+        }
+
+        if (!equals || step->settingCount == CAMPAIGN_MAX_SETTINGS) {
+            return CAMPAIGN_BAD;
+        }
+        *equals = '\0';
+        CampaignSetting& setting = step->settings[step->settingCount];
+        if (!parseNumber(word, &setting.id) || !parseNumber(equals + 1, &setting.value) || setting.value < 0) {
+            return CAMPAIGN_BAD; //the keypad can't enter negative numbers either
+        }
+        step->settingCount++;
+    }
+    return haveProfile ? CAMPAIGN_STEP : CAMPAIGN_BLANK;
+}
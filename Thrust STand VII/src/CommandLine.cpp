@@ -0,0 +1,49 @@
+#include "CommandLine.h"
+
+bool CommandLine::feed(char c) {
+    if (c != '\n' && c != '\r') {
+        if (length < MAX_LINE) {
+            buffer[length++] = c;
+        } else {
+            overflowed = true;
+        }
+        return false;
+    }
+
+    //end of a line, the other half of a \r\n ends up here as an empty one
+    bool complete = length > 0 && !overflowed;
+    buffer[length] = '\0';
+    length = 0;
+    overflowed = false;
+    wordCount = 0;
+    if (!complete) {
+        return false;
+    }
+
+    //past MAX_WORDS the rest of the line stays in the last word, spaces and all
+    char* p = buffer;
+    while (*p && wordCount < MAX_WORDS) {
+        while (*p == ' ') *p++ = '\0';
+        if (!*p) break;
+        words[wordCount++] = p;
+        while (*p && *p != ' ') p++;
+    }
+    return wordCount > 0;
+}
+
+bool parseNumber(const char* text, long* value) {
+    bool negative = (*text == '-');
+    if (*text == '-' || *text == '+') text++;
+    if (!*text) {
+        return false;
+    }
+    long result = 0;
+    for (uint8_t digits = 0; *text; text++, digits++) {
+        if (*text < '0' || *text > '9' || digits == 8) { //8 digits at most, same as the keypad allows
+            return false;
+        }
+        result = result * 10 + (*text - '0');
+    }
+    *value = negative ? -result : result;
+    return true;
+}
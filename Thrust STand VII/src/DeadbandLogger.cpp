@@ -0,0 +1,37 @@
+#include "DeadbandLogger.h"
+
+void DeadbandLogger::begin(const float* deadbands, uint8_t channelCount, unsigned long heartbeatMillis) {
+    count = channelCount < MAX_CHANNELS ? channelCount : MAX_CHANNELS;
+    for (uint8_t i = 0; i < count; i++) {
+        bands[i] = deadbands[i];
+    }
+    heartbeat = heartbeatMillis;
+    started = false;
+    kept = 0;
+    skipped = 0;
+}
+
+LogDecision DeadbandLogger::decide(const float* values, unsigned long nowMillis) {
+    LogDecision decision = started ? LOG_SKIP : LOG_CHANGE; //the first row is always written
+    for (uint8_t i = 0; i < count && decision == LOG_SKIP; i++) {
+        float delta = values[i] - reference[i];
+        if (delta > bands[i] || -delta > bands[i]) {
+            decision = LOG_CHANGE;
+        }
+    }
+    if (decision == LOG_SKIP && nowMillis - keptAt >= heartbeat) {
+        decision = LOG_HEARTBEAT;
+    }
+
+    if (decision == LOG_SKIP) {
+        skipped++;
+        return LOG_SKIP;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        reference[i] = values[i];
+    }
+    keptAt = nowMillis;
+    started = true;
+    kept++;
+    return decision;
+}
@@ -0,0 +1,70 @@
+#include "DragTare.h"
+#include <math.h>
+
+bool DragTare::build(const float* airspeeds, const float* drags, uint8_t n, float step, DragTable& out) {
+    out = {};
+    if (n < 2 || n > DRAG_TARE_POINTS || !(step > 0)) {
+        return false;
+    }
+
+    //sort by airspeed, there's never more than a handful so insertion sort is plenty
+    float a[DRAG_TARE_POINTS];
+    float d[DRAG_TARE_POINTS];
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t j = i;
+        while (j > 0 && a[j - 1] > airspeeds[i]) {
+            a[j] = a[j - 1];
+            d[j] = d[j - 1];
+            j--;
+        }
+        a[j] = airspeeds[i];
+        d[j] = drags[i];
+    }
+    if (!(a[n - 1] > a[0])) {
+        return false;
+    }
+
+    //grid from 0 m/s out to the first entry past the fastest point swept, that one carries on the last slope
+    uint32_t count = (uint32_t)ceilf(a[n - 1] / step) + 1;
+    if (count > DRAG_TARE_POINTS) {
+        count = DRAG_TARE_POINTS;
+    }
+    if (count < 2) {
+        return false;
+    }
+
+    uint8_t j = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        float v = i * step;
+        while (j < n - 2 && a[j + 1] < v) {
+            j++;
+        }
+        float span = a[j + 1] - a[j];
+        if (v <= a[j] || span <= 0) { //below the slowest point, or two points at the same airspeed
+            out.drag[i] = v <= a[j] ? d[j] : d[j + 1];
+        } else {
+            float f = (v - a[j]) / span;
+            out.drag[i] = d[j] + (d[j + 1] - d[j]) * f;
+        }
+    }
+    out.step = step;
+    out.count = count;
+    return true;
+}
+
+void DragTare::begin(const DragTable& table) {
+    params = table;
+    enabled = table.count >= 2 && table.count <= DRAG_TARE_POINTS && table.step > 0;
+    if (!enabled) {
+        params = {};
+        return;
+    }
+    inverseStep = 1.0f / table.step;
+    last = table.count - 1;
+    tailScale = table.drag[last] / ((float)last * last);
+}
+
+void DragTare::clear() {
+    params = {};
+    enabled = false;
+}
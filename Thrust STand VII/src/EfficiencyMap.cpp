@@ -0,0 +1,55 @@
+#include "EfficiencyMap.h"
+
+void EfficiencyMap::begin(MapAxis axis, float binWidth) {
+    mapAxis = axis;
+    width = binWidth > 0 ? binWidth : 1;
+    total = 0;
+    memset(cells, 0, sizeof(cells));
+}
+
+void EfficiencyMap::add(float throttle, float axisValue, float motorEfficiency, float propellerEfficiency, float systemEfficiency) {
+    //with the motor stopped the efficiencies are 0/0, those samples say nothing about the map
+    if (!isfinite(motorEfficiency) || !isfinite(propellerEfficiency) || !isfinite(systemEfficiency)) {
+        return;
+    }
+
+    int throttleBin = (int)(throttle / (100.0f / THROTTLE_BINS));
+    int axisBin = (int)(axisValue / width);
+    throttleBin = constrain(throttleBin, 0, THROTTLE_BINS - 1); //100% lands in the top bin
+    axisBin = constrain(axisBin, 0, AXIS_BINS - 1);
+
+    Cell& cell = cells[throttleBin][axisBin];
+    if (cell.count == 0xFFFF) {
+        return; //full, and the mean isn't going anywhere after 65k samples
+    }
+    cell.motor += motorEfficiency;
+    cell.propeller += propellerEfficiency;
+    cell.system += systemEfficiency;
+    cell.count++;
+    if (total < 0xFFFF) total++;
+}
+
+void EfficiencyMap::write(Print& out) const {
+    out.print("Throttle (%),");
+    out.print(mapAxis == MAP_RPM ? "RPM" : "Airspeed (m/s)");
+    out.println(",Samples,Motor Efficiency,Propeller Efficiency,System Efficiency");
+
+    const float throttleWidth = 100.0f / THROTTLE_BINS;
+    for (uint8_t t = 0; t < THROTTLE_BINS; t++) {
+        for (uint8_t a = 0; a < AXIS_BINS; a++) {
+            const Cell& cell = cells[t][a];
+            if (cell.count == 0) {
+                continue;
+            }
+            //bins are written as their lower edge, the top axis bin is open ended
+            out.print(t * throttleWidth, 0); out.print(',');
+            out.print(a * width, mapAxis == MAP_RPM ? 0 : 1);
+            if (a == AXIS_BINS - 1) out.print('+');
+            out.print(',');
+            out.print(cell.count); out.print(',');
+            out.print(cell.motor / cell.count, 4); out.print(',');
+            out.print(cell.propeller / cell.count, 4); out.print(',');
+            out.println(cell.system / cell.count, 4);
+        }
+    }
+}
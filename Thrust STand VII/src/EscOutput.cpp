@@ -0,0 +1,55 @@
+#include "EscOutput.h"
+#include <avr/io.h>
+
+void EscOutput::begin(EscProtocol protocol, uint16_t rateHz, uint16_t pulseMicros) {
+    //fast PWM with TOP in ICR3 (mode 14), OC3C cleared on compare match. Standard PWM counts at 2 MHz (/8) so
+    //50 Hz still fits in 16 bits, OneShot125 counts at 16 MHz (/1) for the finer steps. Either way a
+    //1000-2000us command comes out as 2 counts per us: 0.5us ticks for PWM, 1/8 the pulse at 62.5ns for OneShot.
+    uint8_t clockSelect;
+    uint32_t countsPerSecond;
+    if (protocol == ESC_ONESHOT125) {
+        rateHz = ONESHOT_RATE;
+        clockSelect = (1 << CS30);
+        countsPerSecond = 16000000UL;
+    } else {
+        rateHz = constrain(rateHz, MIN_RATE, MAX_RATE);
+        clockSelect = (1 << CS31);
+        countsPerSecond = 2000000UL;
+    }
+
+    noInterrupts(); //the 16 bit registers share one temp byte with anything an ISR writes
+    TCCR3B = 0; //stop the timer while TOP changes, ICR3 isn't double buffered
+    TCCR3A = (1 << COM3C1) | (1 << WGM31);
+    ICR3 = countsPerSecond / rateHz - 1;
+    commandTicks = toTicks(pulseMicros);
+    commandPending = false;
+    OCR3C = commandTicks;
+    TCNT3 = 0;
+    TCCR3B = (1 << WGM33) | (1 << WGM32) | clockSelect;
+    interrupts();
+
+    pinMode(PIN, OUTPUT);
+    activeProtocol = protocol;
+    activeRate = rateHz;
+}
+
+void EscOutput::writeMicroseconds(uint16_t pulseMicros) {
+    uint16_t ticks = toTicks(pulseMicros);
+    noInterrupts();
+    commandTicks = ticks;
+    commandPending = true;
+    interrupts();
+}
+
+void EscOutput::cut(uint16_t pulseMicros) {
+    commandTicks = toTicks(pulseMicros);
+    commandPending = false; //anything staged before the trip is stale
+    OCR3C = commandTicks;
+}
+
+void EscOutput::tick() {
+    if (commandPending) {
+        OCR3C = commandTicks; //takes effect at the start of the next period
+        commandPending = false;
+    }
+}
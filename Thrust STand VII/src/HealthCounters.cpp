@@ -0,0 +1,58 @@
+#include "HealthCounters.h"
+
+#define HEALTH_RATE_PERIOD 1000 //ms between debug page snapshots
+
+void HealthCounters::loadCellRead(uint8_t cell, unsigned long atMicros, unsigned long periodMicros) {
+    if (cellRead[cell]) {
+        unsigned long gap = atMicros - lastCellRead[cell];
+        //reads land anywhere in the conversion cycle, so up to two periods apart can still have caught every
+        //one. Past that at least gap/period - 1 were overwritten, it undercounts rather than raising false alarms
+        if (gap >= 2 * periodMicros) {
+            totals.missedConversions[cell] += gap / periodMicros - 1;
+        }
+    }
+    lastCellRead[cell] = atMicros;
+    cellRead[cell] = true;
+}
+
+void HealthCounters::sdWrite(uint32_t bytes, unsigned long micros) {
+    totals.sdBytes += bytes;
+    if (micros > maxSdWriteMicros) {
+        maxSdWriteMicros = micros;
+    }
+}
+
+void HealthCounters::loopPass(unsigned long nowMicros, unsigned long budgetMicros) {
+    if (looping) {
+        unsigned long pass = nowMicros - lastLoop;
+        totals.loops++;
+        if (pass > budgetMicros) {
+            totals.loopOverruns++;
+        }
+        if (pass > maxLoopMicros) {
+            maxLoopMicros = pass;
+        }
+    }
+    lastLoop = nowMicros;
+    looping = true;
+}
+
+bool HealthCounters::update(unsigned long nowMillis) {
+    unsigned long elapsed = nowMillis - snapshotAt;
+    if (elapsed < HEALTH_RATE_PERIOD) {
+        return false;
+    }
+    ratesBetween(snapshot, totals, elapsed, &latest);
+    snapshot = totals;
+    snapshotAt = nowMillis;
+    return true;
+}
+
+void HealthCounters::ratesBetween(const HealthTotals& from, const HealthTotals& to, unsigned long millis, HealthRates* out) {
+    float perSecond = millis ? 1000.0f / millis : 0;
+    for (uint8_t i = 0; i < HEALTH_CHANNELS; i++) {
+        out->samples[i] = (to.samples[i] - from.samples[i]) * perSecond;
+    }
+    out->rpmEdges = (to.rpmEdges - from.rpmEdges) * perSecond;
+    out->sdBytes = (to.sdBytes - from.sdBytes) * perSecond;
+}
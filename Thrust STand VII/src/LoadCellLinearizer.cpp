@@ -0,0 +1,118 @@
+#include "LoadCellLinearizer.h"
+
+bool LoadCellLinearizer::fit(const int32_t* counts, const float* loads, uint8_t n, LinearizationFit& out) {
+    out = {{0, 0, 0}, 0, 0, 0};
+    if (n == 0 || n > MAX_POINTS) {
+        return false;
+    }
+
+    //normalize so the powers stay in float range (counts^3 would overflow otherwise)
+    float countScale = 0;
+    int32_t lowCounts = 0; //the tare point is always part of the range
+    int32_t highCounts = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        countScale = max(countScale, (float)abs(counts[i]));
+        lowCounts = min(lowCounts, counts[i]);
+        highCounts = max(highCounts, counts[i]);
+    }
+    if (countScale == 0) {
+        return false;
+    }
+
+    //normal equations for load = sum(c_j * x^(j+1)), one unknown per point up to three
+    uint8_t degree = min(n, (uint8_t)3);
+    float A[3][4] = {};
+    for (uint8_t i = 0; i < n; i++) {
+        float x = counts[i] / countScale;
+        float powers[3] = {x, x * x, x * x * x};
+        for (uint8_t r = 0; r < degree; r++) {
+            for (uint8_t c = 0; c < degree; c++) {
+                A[r][c] += powers[r] * powers[c];
+            }
+            A[r][3] += powers[r] * loads[i];
+        }
+    }
+
+    //gaussian elimination with partial pivoting
+    for (uint8_t col = 0; col < degree; col++) {
+        uint8_t pivot = col;
+        for (uint8_t r = col + 1; r < degree; r++) {
+            if (abs(A[r][col]) > abs(A[pivot][col])) pivot = r;
+        }
+        if (abs(A[pivot][col]) < 1e-12f) {
+            return false; //two points at the same reading
+        }
+        for (uint8_t c = 0; c < 4; c++) {
+            float temp = A[col][c];
+            A[col][c] = A[pivot][c];
+            A[pivot][c] = temp;
+        }
+        for (uint8_t r = 0; r < degree; r++) {
+            if (r == col) continue;
+            float factor = A[r][col] / A[col][col];
+            for (uint8_t c = col; c < 4; c++) {
+                A[r][c] -= factor * A[col][c];
+            }
+        }
+    }
+    for (uint8_t j = 0; j < degree; j++) {
+        out.coef[j] = A[j][3] / A[j][j];
+    }
+
+    out.countScale = countScale;
+    out.lowCounts = lowCounts;
+    out.highCounts = highCounts;
+    return true;
+}
+
+static float polynomial(const LinearizationFit& fit, float x) {
+    return x * (fit.coef[0] + x * (fit.coef[1] + x * fit.coef[2]));
+}
+
+static float derivative(const LinearizationFit& fit, float x) { //d(load)/dx
+    return fit.coef[0] + x * (2 * fit.coef[1] + x * 3 * fit.coef[2]);
+}
+
+float LoadCellLinearizer::evaluateFit(const LinearizationFit& fit, float counts) {
+    //inside the calibrated range use the polynomial, past it keep going along the end slope
+    float x = counts / fit.countScale;
+    float lowX = fit.lowCounts / fit.countScale;
+    float highX = fit.highCounts / fit.countScale;
+    if (x < lowX) {
+        return polynomial(fit, lowX) + derivative(fit, lowX) * (x - lowX);
+    }
+    if (x > highX) {
+        return polynomial(fit, highX) + derivative(fit, highX) * (x - highX);
+    }
+    return polynomial(fit, x);
+}
+
+void LoadCellLinearizer::clear() {
+    params = {{0, 0, 0}, 0, 0, 0};
+    enabled = false;
+}
+
+void LoadCellLinearizer::build(const LinearizationFit& fit) {
+    if (!(fit.countScale > 0) || fit.highCounts <= fit.lowCounts) {
+        clear();
+        return;
+    }
+    params = fit;
+
+    //smallest power of two segment width that covers the calibrated range
+    uint32_t span = (uint32_t)(fit.highCounts - fit.lowCounts);
+    shift = 0;
+    while (((uint32_t)SEGMENTS << shift) < span) {
+        shift++;
+    }
+    low = fit.lowCounts;
+
+    const float unit = 1 << FRACTION_BITS;
+    for (uint8_t k = 0; k <= SEGMENTS; k++) {
+        float counts = (float)low + (float)((uint32_t)k << shift);
+        table[k] = lround(evaluateFit(fit, counts) * unit);
+    }
+    lowSlope = (table[1] - table[0]) / (float)(1UL << shift);
+    highSlope = (table[SEGMENTS] - table[SEGMENTS - 1]) / (float)(1UL << shift);
+    enabled = true;
+}
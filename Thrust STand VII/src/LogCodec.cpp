@@ -0,0 +1,119 @@
+#include "LogCodec.h"
+#include "Crc16.h"
+#include <math.h>
+#include <string.h>
+
+const float logChannelResolution[LOG_CHANNELS] = {1000, 1000, 1000, 100, 10, 10, 100, 10};
+
+uint8_t writeVarint(uint32_t value, uint8_t* out) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+uint8_t readVarint(const uint8_t* in, size_t available, uint32_t* value) {
+    uint32_t result = 0;
+    for (uint8_t n = 0; n < LOG_MAX_VARINT && n < available; n++) {
+        result |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static int32_t toCounts(float value, uint8_t channel) {
+    float counts = value * logChannelResolution[channel];
+    if (!(counts > -1.0e9f && counts < 1.0e9f)) {
+        return 0; //nan or a wild value. Keeping counts under 1e9 means a delta always fits in 32 bits
+    }
+    return lroundf(counts);
+}
+
+uint8_t LogEncoder::header(uint8_t* out) {
+    memcpy(out, LOG_MAGIC, 4);
+    out[4] = LOG_FORMAT_VERSION;
+    out[5] = LOG_CHANNELS;
+    out[6] = LOG_KEYFRAME_INTERVAL;
+    memcpy(out + 7, logChannelResolution, sizeof(logChannelResolution)); //little endian IEEE floats on both ends
+    rowsInBlock = 0;
+    return LOG_HEADER_SIZE;
+}
+
+uint8_t LogEncoder::put(uint8_t* out, uint8_t length) {
+    crc = crc16(out, length, crc);
+    return length;
+}
+
+uint8_t LogEncoder::startBlock(const int32_t* values, uint8_t* out) {
+    out[0] = LOG_SYNC1;
+    out[1] = LOG_SYNC2;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < LOG_CHANNELS; i++) {
+        n += writeVarint(zigzagEncode(values[i]), out + 2 + n);
+    }
+    crc = CRC16_INIT;
+    put(out + 2, n);
+    rowsInBlock = 1;
+    return n + 2;
+}
+
+uint8_t LogEncoder::encode(const float* values, uint8_t* out) {
+    int32_t counts[LOG_CHANNELS];
+    for (uint8_t i = 0; i < LOG_CHANNELS; i++) {
+        counts[i] = toCounts(values[i], i);
+    }
+
+    uint8_t n = 0;
+    if (rowsInBlock >= LOG_KEYFRAME_INTERVAL) {
+        n = finish(out);
+    }
+    if (rowsInBlock == 0) {
+        n += startBlock(counts, out + n);
+    } else {
+        uint8_t* record = out + n;
+        uint8_t length = 1;
+        uint8_t mask = 0;
+        length += writeVarint(zigzagEncode(counts[LOG_TIME] - previous[LOG_TIME]), record + length);
+        for (uint8_t i = 1; i < LOG_CHANNELS; i++) {
+            int32_t delta = counts[i] - previous[i];
+            if (delta != 0) {
+                mask |= 1 << (i - 1);
+                length += writeVarint(zigzagEncode(delta), record + length);
+            }
+        }
+        record[0] = mask;
+        n += put(record, length);
+        rowsInBlock++;
+    }
+    memcpy(previous, counts, sizeof(previous));
+    return n;
+}
+
+uint8_t LogEncoder::note(const char* text, uint8_t* out) {
+    size_t length = strlen(text);
+    if (length > LOG_MAX_NOTE) length = LOG_MAX_NOTE;
+    out[0] = LOG_TAG_NOTE;
+    out[1] = (uint8_t)length;
+    memcpy(out + 2, text, length);
+    uint16_t noteCrc = crc16(out + 1, length + 1); //its own CRC, notes aren't part of the block's
+    out[2 + length] = noteCrc & 0xFF;
+    out[3 + length] = noteCrc >> 8;
+    return length + 4;
+}
+
+uint8_t LogEncoder::finish(uint8_t* out) {
+    if (rowsInBlock == 0) {
+        return 0;
+    }
+    out[0] = LOG_TAG_END;
+    out[1] = crc & 0xFF;
+    out[2] = crc >> 8;
+    rowsInBlock = 0;
+    return 3;
+}
@@ -0,0 +1,67 @@
+#include "LogIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool LogIndexer::add(const LogIndexEntry& entry) {
+    if (count < LOG_INDEX_PENDING) {
+        entries[count++] = entry;
+    }
+    return count == LOG_INDEX_PENDING;
+}
+
+void LogIndexer::checkpoint(uint32_t offset, char* out) {
+    int n = snprintf(out, LOG_INDEX_MAX_TEXT + 1, LOG_INDEX_TAG "%lu", (unsigned long)lastCheckpoint);
+    for (uint8_t i = 0; i < count; i++) {
+        n += snprintf(out + n, LOG_INDEX_MAX_TEXT + 1 - n, ",%u:%u:%lu:%lu", entries[i].segment, entries[i].step,
+            (unsigned long)entries[i].millis, (unsigned long)entries[i].offset);
+    }
+    lastCheckpoint = offset;
+    count = 0;
+}
+
+bool LogIndexer::trailer(char* out) const {
+    if (lastCheckpoint == 0) {
+        return false;
+    }
+    snprintf(out, LOG_INDEX_TRAILER_TEXT + 1, LOG_INDEX_END_TAG "%010lu", (unsigned long)lastCheckpoint);
+    return true;
+}
+
+static bool readNumber(const char*& p, unsigned long* value, char end) { //digits up to end (or the end of the text if end is 0)
+    char* stop;
+    if (*p < '0' || *p > '9') return false;
+    *value = strtoul(p, &stop, 10);
+    if (*stop != end && !(end == ',' && *stop == '\0')) return false;
+    p = *stop ? stop + 1 : stop;
+    return true;
+}
+
+bool parseIndexTrailer(const char* text, uint32_t* lastCheckpoint) {
+    const size_t tagLength = strlen(LOG_INDEX_END_TAG);
+    if (strncmp(text, LOG_INDEX_END_TAG, tagLength) != 0) return false;
+    const char* p = text + tagLength;
+    unsigned long value;
+    if (!readNumber(p, &value, '\0') || value == 0) return false;
+    *lastCheckpoint = value;
+    return true;
+}
+
+bool parseIndexCheckpoint(const char* text, uint32_t* previous, LogIndexEntry* entries, uint8_t* count) {
+    const size_t tagLength = strlen(LOG_INDEX_TAG);
+    if (strncmp(text, LOG_INDEX_TAG, tagLength) != 0) return false;
+    const char* p = text + tagLength;
+    unsigned long value;
+    if (!readNumber(p, &value, ',')) return false;
+    *previous = value;
+    *count = 0;
+    while (*p) {
+        if (*count == LOG_INDEX_PENDING) return false;
+        unsigned long segment, step, millis, offset;
+        if (!readNumber(p, &segment, ':') || !readNumber(p, &step, ':') || !readNumber(p, &millis, ':') || !readNumber(p, &offset, ',')) {
+            return false;
+        }
+        entries[(*count)++] = {(uint8_t)segment, (uint8_t)step, (uint32_t)millis, (uint32_t)offset};
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#include "RippleRpm.h"
+
+#define RIPPLE_MIN_PROMINENCE 4.0f //a ripple peak has to be this many times the average bin around it
+
+RippleEstimate RippleRpm::estimate(VibrationSpectrum& spectrum, float sampleHz, uint8_t poles, float minRpm, float maxRpm) {
+    RippleEstimate result = {0, 0};
+    if (poles == 0 || !(sampleHz > 0)) {
+        return result;
+    }
+    spectrum.analyse();
+
+    //bins 0 and 1 are the mean and the window's leakage of it, the top one has nothing past it to fit against
+    float hzPerBin = sampleHz / VIB_FFT_SIZE;
+    int32_t first = (int32_t)ceilf(rippleHz(minRpm, poles) / hzPerBin);
+    int32_t last = (int32_t)(rippleHz(maxRpm, poles) / hzPerBin);
+    if (first < 2) first = 2;
+    if (last > VIB_BINS - 2) last = VIB_BINS - 2;
+    if (last < first) {
+        return result;
+    }
+
+    int32_t peak = first;
+    uint32_t total = 0;
+    for (int32_t k = first; k <= last; k++) {
+        total += spectrum.magnitude(k);
+        if (spectrum.magnitude(k) > spectrum.magnitude(peak)) peak = k;
+    }
+
+    //the noise is everything else in the band, the peak's own Hann skirt left out
+    uint32_t skirt = 0;
+    int32_t skirtBins = 0;
+    for (int32_t k = peak - 1; k <= peak + 1; k++) {
+        if (k >= first && k <= last) {
+            skirt += spectrum.magnitude(k);
+            skirtBins++;
+        }
+    }
+    int32_t noiseBins = last - first + 1 - skirtBins;
+    float noise = noiseBins > 0 ? (float)(total - skirt) / noiseBins : 0;
+    if (noise < 1) noise = 1; //the spectrum is in whole counts, a clean burst can leave the floor at 0
+    result.prominence = spectrum.magnitude(peak) / noise;
+    if (result.prominence < RIPPLE_MIN_PROMINENCE) {
+        return result;
+    }
+
+    //a Hann windowed tone is close to a Gaussian around its peak, so a parabola through the logs of the
+    //three bins finds its centre to a few hundredths of a bin
+    float below = logf(spectrum.magnitude(peak - 1) + 1.0f);
+    float centre = logf(spectrum.magnitude(peak) + 1.0f);
+    float above = logf(spectrum.magnitude(peak + 1) + 1.0f);
+    float curve = below - 2 * centre + above;
+    float offset = curve < 0 ? 0.5f * (below - above) / curve : 0;
+    offset = constrain(offset, -0.5f, 0.5f);
+
+    result.rpm = (peak + offset) * hzPerBin * 60.0f / (poles * RIPPLE_PER_POLE);
+    return result;
+}
+
+float RippleRpm::disagreement(float rippleRpm, float opticalRpm) {
+    if (opticalRpm <= 0) {
+        return rippleRpm > 0 ? 100 : 0;
+    }
+    return fabsf(rippleRpm - opticalRpm) / opticalRpm * 100;
+}
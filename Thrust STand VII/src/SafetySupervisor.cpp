@@ -0,0 +1,89 @@
+#include "SafetySupervisor.h"
+
+//limits and samples are several bytes each and the tick can land mid copy, so anything that writes them
+//does it with interrupts off. check() runs in the first half of the tick, which already has them off.
+
+void SafetySupervisor::setLimits(const SafetyLimits& newLimits) {
+    noInterrupts();
+    limits = newLimits;
+    interrupts();
+}
+
+void SafetySupervisor::arm(unsigned long nowMillis) {
+    noInterrupts();
+    tripCause = TRIP_NONE;
+    lastSampleAt = nowMillis; //readings have until staleMillis from now to show up
+    isArmed = true;
+    interrupts();
+}
+
+void SafetySupervisor::disarm() {
+    isArmed = false;
+}
+
+void SafetySupervisor::publish(const SafetySample& sample, unsigned long nowMillis) {
+    noInterrupts();
+    latest = sample;
+    lastSampleAt = nowMillis;
+    interrupts();
+}
+
+void SafetySupervisor::update(const SafetySample& sample, uint8_t fields) {
+    noInterrupts(); //the tick's second half runs with interrupts on, and the next tick's check() can land in it
+    if (fields & SAFETY_THRUST) latest.thrust = sample.thrust;
+    if (fields & SAFETY_TORQUE) latest.torque = sample.torque;
+    if (fields & SAFETY_CURRENT) latest.current = sample.current;
+    if (fields & SAFETY_RPM) latest.rpm = sample.rpm;
+    interrupts();
+}
+
+bool SafetySupervisor::trip(TripCause cause, float value, float limit, unsigned long nowMillis) {
+    tripValue = value;
+    tripLimit = limit;
+    tripAt = nowMillis;
+    tripCause = cause;
+    return true;
+}
+
+bool SafetySupervisor::check(unsigned long nowMillis) {
+    if (!isArmed || tripCause != TRIP_NONE) {
+        return false; //a trip sticks until the next arm()
+    }
+
+    //load cells can read either way depending on the prop direction, so compare magnitudes
+    if (limits.maxThrust > 0 && abs(latest.thrust) > limits.maxThrust) {
+        return trip(TRIP_THRUST, latest.thrust, limits.maxThrust, nowMillis);
+    }
+    if (limits.maxTorque > 0 && abs(latest.torque) > limits.maxTorque) {
+        return trip(TRIP_TORQUE, latest.torque, limits.maxTorque, nowMillis);
+    }
+    if (limits.maxCurrent > 0 && abs(latest.current) > limits.maxCurrent) {
+        return trip(TRIP_CURRENT, latest.current, limits.maxCurrent, nowMillis);
+    }
+    if (limits.maxRpm > 0 && latest.rpm > limits.maxRpm) {
+        return trip(TRIP_RPM, latest.rpm, limits.maxRpm, nowMillis);
+    }
+    unsigned long sampleAge = nowMillis - lastSampleAt;
+    if (limits.staleMillis > 0 && sampleAge > limits.staleMillis) { //the limits above mean nothing if the readings stopped
+        return trip(TRIP_STALE_DATA, sampleAge, limits.staleMillis, nowMillis);
+    }
+    return false;
+}
+
+SafetyTrip SafetySupervisor::lastTrip() const {
+    noInterrupts();
+    SafetyTrip copy = {tripCause, tripValue, tripLimit, tripAt};
+    interrupts();
+    return copy;
+}
+
+const char* SafetySupervisor::causeLabel(TripCause cause) {
+    switch (cause) {
+        case TRIP_THRUST: return "Over thrust";
+        case TRIP_TORQUE: return "Over torque";
+        case TRIP_CURRENT: return "Over current";
+        case TRIP_RPM: return "Over RPM";
+        case TRIP_STALE_DATA: return "Sensor data stale";
+        default: return "None";
+    }
+}
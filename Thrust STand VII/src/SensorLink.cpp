@@ -0,0 +1,71 @@
+#include "SensorLink.h"
+#include "Crc16.h"
+#include <string.h>
+
+uint8_t encodeSensorFrame(uint8_t type, const void* payload, uint8_t length, uint8_t* out) {
+    out[0] = SENSOR_LINK_SYNC1;
+    out[1] = SENSOR_LINK_SYNC2;
+    out[2] = type;
+    out[3] = length;
+    memcpy(out + 4, payload, length);
+    uint16_t crc = crc16(out + 2, length + 2);
+    out[4 + length] = crc & 0xFF;
+    out[5 + length] = crc >> 8;
+    return length + SENSOR_LINK_OVERHEAD;
+}
+
+bool SensorLinkParser::feed(uint8_t byte) {
+    switch (state) {
+        case WAIT_SYNC1:
+            if (byte == SENSOR_LINK_SYNC1) state = WAIT_SYNC2;
+            return false;
+
+        case WAIT_SYNC2:
+            if (byte == SENSOR_LINK_SYNC2) {
+                state = READ_TYPE;
+            } else if (byte != SENSOR_LINK_SYNC1) { //A5 A5 5A still syncs on the second A5
+                state = WAIT_SYNC1;
+            }
+            return false;
+
+        case READ_TYPE:
+            frameType = byte;
+            crc = crc16Update(CRC16_INIT, byte);
+            state = READ_LENGTH;
+            return false;
+
+        case READ_LENGTH:
+            if (byte > SENSOR_LINK_MAX_PAYLOAD) {
+                lengthErrors++;
+                state = WAIT_SYNC1;
+                return false;
+            }
+            frameLength = byte;
+            received = 0;
+            crc = crc16Update(crc, byte);
+            state = byte ? READ_PAYLOAD : READ_CRC_LO;
+            return false;
+
+        case READ_PAYLOAD:
+            buffer[received++] = byte;
+            crc = crc16Update(crc, byte);
+            if (received == frameLength) state = READ_CRC_LO;
+            return false;
+
+        case READ_CRC_LO:
+            frameCrc = byte;
+            state = READ_CRC_HI;
+            return false;
+
+        case READ_CRC_HI:
+            frameCrc |= (uint16_t)byte << 8;
+            state = WAIT_SYNC1;
+            if (frameCrc != crc) {
+                crcErrors++;
+                return false;
+            }
+            goodFrames++;
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,120 @@
+#include "VibrationFft.h"
+
+#define VIB_HEADROOM 16383 //largest sample going in, so a butterfly's products can't overflow 32 bits
+#define HANN_AMPLITUDE 3.266f //pure tone amplitude over the root sum square of its three Hann bins (X[k]/N)
+#define HANN_PEAK 4.0f //pure tone amplitude over its bin, when it's right on one
+
+//sin(2*pi*k/256) * 32767 for the first quarter turn, the rest of the circle comes from symmetry
+static const int16_t sineTable[VIB_FFT_SIZE / 4 + 1] PROGMEM = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+static int16_t sineAt(uint16_t k) { //k in 1/VIB_FFT_SIZE turns, 0 to half a turn
+    const uint16_t quarter = VIB_FFT_SIZE / 4;
+    return pgm_read_word(&sineTable[k <= quarter ? k : 2 * quarter - k]);
+}
+
+static int16_t cosineAt(uint16_t k) {
+    const uint16_t quarter = VIB_FFT_SIZE / 4;
+    return k <= quarter ? pgm_read_word(&sineTable[quarter - k]) : -(int16_t)pgm_read_word(&sineTable[k - quarter]);
+}
+
+void fftFixed(int16_t* re, int16_t* im, uint8_t bits) {
+    const uint16_t n = 1 << bits;
+
+    //bit reversed order
+    for (uint16_t i = 1, j = 0; i < n; i++) {
+        uint16_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint16_t size = 2; size <= n; size <<= 1) {
+        const uint16_t half = size >> 1;
+        const uint16_t step = VIB_FFT_SIZE / size; //table steps per k
+        for (uint16_t k = 0; k < half; k++) {
+            int32_t wr = cosineAt(k * step);
+            int32_t wi = -(int32_t)sineAt(k * step); //e^(-j theta)
+            for (uint16_t i = k; i < n; i += size) {
+                uint16_t j = i + half;
+                int32_t tr = (wr * re[j] - wi * im[j]) >> 15;
+                int32_t ti = (wr * im[j] + wi * re[j]) >> 15;
+                re[j] = (re[i] - tr) >> 1;
+                im[j] = (im[i] - ti) >> 1;
+                re[i] = (re[i] + tr) >> 1;
+                im[i] = (im[i] + ti) >> 1;
+            }
+        }
+    }
+}
+
+void VibrationSpectrum::analyse() {
+    //only the wobble matters, a load cell's offset alone would use up all 16 bits
+    int64_t sum = 0;
+    for (uint16_t i = 0; i < VIB_FFT_SIZE; i++) sum += buffer.raw[i];
+    int32_t mean = sum / VIB_FFT_SIZE;
+    int32_t largest = 1;
+    for (uint16_t i = 0; i < VIB_FFT_SIZE; i++) {
+        int32_t v = buffer.raw[i] - mean;
+        if (v < 0) v = -v;
+        if (v > largest) largest = v;
+    }
+    shift = 0;
+    while (largest > VIB_HEADROOM) { largest >>= 1; shift--; }
+    while (largest <= VIB_HEADROOM / 2) { largest <<= 1; shift++; }
+
+    //raw[i] is read before re[i] is written, and re[i] only overlaps raw[i / 2], so going up in order is safe
+    for (uint16_t i = 0; i < VIB_FFT_SIZE; i++) {
+        int32_t v = buffer.raw[i] - mean;
+        v = shift >= 0 ? v << shift : v >> -shift;
+        int32_t window = (32768L - cosineAt(i <= VIB_FFT_SIZE / 2 ? i : VIB_FFT_SIZE - i)) >> 1; //Hann, 0.5 - 0.5cos
+        buffer.complex.re[i] = (v * window) >> 15;
+    }
+    for (uint16_t i = 0; i < VIB_FFT_SIZE; i++) buffer.complex.im[i] = 0;
+
+    fftFixed(buffer.complex.re, buffer.complex.im, VIB_FFT_BITS);
+
+    //magnitude[k] overlaps re[k] and im[k] never, so in order is safe here too
+    for (uint16_t k = 0; k < VIB_BINS; k++) {
+        int32_t r = buffer.complex.re[k];
+        int32_t m = buffer.complex.im[k];
+        buffer.spectrum.magnitude[k] = (uint16_t)sqrtf((float)(r * r + m * m));
+    }
+}
+
+uint16_t VibrationSpectrum::peakBin(float centre, uint8_t halfWidth) const {
+    int32_t first = (int32_t)(centre + 0.5f) - halfWidth;
+    int32_t last = (int32_t)(centre + 0.5f) + halfWidth;
+    if (first < 1) first = 1; //DC went with the mean
+    if (last > VIB_BINS - 1) last = VIB_BINS - 1;
+    uint16_t best = first;
+    for (int32_t k = first; k <= last; k++) {
+        if (buffer.spectrum.magnitude[k] > buffer.spectrum.magnitude[best]) best = k;
+    }
+    return best;
+}
+
+float VibrationSpectrum::amplitude(uint16_t bin) const {
+    float power = 0;
+    for (int16_t k = (int16_t)bin - 1; k <= (int16_t)bin + 1; k++) {
+        float m = magnitude(k < 0 ? 0 : k);
+        power += m * m;
+    }
+    return sqrtf(power) * HANN_AMPLITUDE * sampleScale();
+}
+
+float VibrationSpectrum::binAmplitude(uint16_t bin) const {
+    return magnitude(bin) * HANN_PEAK * sampleScale();
+}
+
+float VibrationSpectrum::sampleScale() const {
+    return shift >= 0 ? 1.0f / (1L << shift) : (float)(1L << -shift);
+}
@@ -2,17 +2,38 @@
 #include <Keypad.h> //library for reading the 4x4 matrix keyboard
 #include <U8g2lib.h> //library for controlling the OLED screen
 #include <HX711.h> //used for interacting with the ADC (analog to digital converters) HX711 boards that read the load cells
-#include <Servo.h> //used for controlling the ESC, which is a servo
 #include <avr/wdt.h> //watchdog for resetting the test if there's a hardware failure
+#include <avr/interrupt.h> //timer 2 system tick
+#include <avr/sleep.h> //idle sleep while the UI waits for a key
 #include <EEPROM.h> //eeprom stores the thrust and torque calibrations
 #include <SPI.h> //used for the Spi needed for the SD card
 #include <SD.h> //used for the SD card
+#include "CalibrationStore.h" //versioned, CRC checked calibration records in EEPROM
+#include "LoadCellLinearizer.h" //multi-point load cell calibration tables
+#include "RingBuffer.h" //key press queue filled from the system tick
+#include "SafetySupervisor.h" //thrust/torque/current/RPM limits checked every tick
+#include "EscOutput.h" //ESC pulses from timer 3, standard PWM up to 490 Hz or OneShot125
+#include "TimedChannel.h" //timestamped readings for lining the sensors up in time
+#include "SensorLink.h" //packets from the sensor node, when there is one
+#include "EfficiencyMap.h" //efficiency binned by throttle and airspeed/RPM, written at the end of each test
+#include "DeadbandLogger.h" //picks the rows worth writing in adaptive logging mode
+#include "LogCodec.h" //delta/varint compressed log format
+#include "LogIndex.h" //segment index at the end of each test log
+#include "FastHX711.h" //HX711 reads through direct port access instead of digitalWrite/digitalRead
+#include "AnalogLookup.h" //precomputed count to volts/amps/airspeed conversions
+#include "Benchmark.h" //timing report for the benchmark envs
+#include "CommandLine.h" //line assembly for the Serial command interface
+#include "Campaign.h" //campaign file lines, tests run back to back
+#include "Crc16.h" //checks the campaign resume record
+#include "VibrationFft.h" //vibration spectra from a burst of samples
+#include "HealthCounters.h" //sample rates and missed reads for the debug page and the test log
+#include "DragTare.h" //the stand's own drag by airspeed, taken off the thrust in tunnel runs
+#include "RippleRpm.h" //RPM from the commutation ripple on the current, checks the optical counter
+#include "ExtraSensors.h" //channels added through the sensor registry, each one is a type in its list
 
 /*TODO: 
 Thrust Profiles
-Drag Taring Menu
 Pre-test info screen
-RPM Verification
 */
 
 const char* Version = "Version 1.1";
@@ -23,19 +44,70 @@ extern void debugMenu();
 extern void runTest();
 extern void zeroAnalog();
 extern void selectProfile();
+extern void readSensorNode();
+extern void updateAnalogConversions();
+extern void serviceSerialCommands();
+extern void runCampaign();
+extern void flushHeldRow();
+extern void dragTareSweep();
+extern void clearDragTare();
+extern void rippleRpmCheck();
+extern void safetyFromPacket(const SamplePacket& packet);
+extern void safetyCurrentRead();
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //EEPROM Variables
 
+//old single float calibrations, only read now so stands calibrated before the calibration store keep their scales
 #define THST_CAL_ADDRESS 0
 #define TRQ_CAL_ADDRESS 100 //make sure this is sufficiently spaced from thst cal to avoid overwriting
 
+//calibration store: 8 rotating slots of 256 bytes from 512 to 2559. Every save moves to the next slot
+#define CAL_STORE_ADDRESS 512
+#define CAL_STORE_SLOTS 8
+#define CAL_STORE_SLOT_SIZE 256
+
+#define CAL_VERSION 3 //bump this when fields are added to Calibration. Only ever add to the end of the struct
+
+struct Calibration { //everything boot would otherwise have to re-measure. Fixed width types so the layout matches the native build
+    float thrustScale; //counts per mN
+    int32_t thrustOffset; //raw counts at zero load
+    float torqueScale; //counts per N.mm
+    int32_t torqueOffset;
+    float voltageOffset; //volts
+    float currentOffset; //amps
+
+    //version 2
+    LinearizationFit thrustFit; //multi-point calibrations, countScale is 0 if the cell only has a single point scale
+    LinearizationFit torqueFit;
+
+    //version 3
+    DragTable dragTable; //count is 0 if there's no drag tare
+};
+
+CalibrationStore calStore(CAL_STORE_ADDRESS, CAL_STORE_SLOTS, CAL_STORE_SLOT_SIZE);
+
+//where a campaign has got to, right after the calibration store. Written twice per test, nowhere near the wear limit
+#define CAMPAIGN_RESUME_ADDRESS 2560
+#define CAMPAIGN_RESUME_MAGIC 0xCA3E
+
+struct CampaignResume {
+    uint16_t magic;
+    uint16_t fileCrc; //of the campaign file, a different file doesn't get resumed
+    uint16_t nextStep; //test in the file to run next, counting from 0
+    uint8_t tries; //times nextStep has been started, a test that keeps resetting the board gets skipped
+    uint8_t reserved;
+    int32_t testNumber; //file number nextStep starts looking from
+    uint16_t crc;
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //Test Variables;
 const int testDataInterval = 200; //in milliseconds, the amount of time between sensor reading and data writing cycles
 
-float testStartTime = 0;
-float testTime = 0;
+unsigned long testStartMicros = 0; //micros() when the test started, for lining channels up
+unsigned long testStartMillis = 0; //millis() at the same time, test times count from this since micros() wraps every 71 minutes
+float testTime = 0; //s, the instant the row's values were lined up on
 float thrust = 0; //mN
 float torque = 0; //N.mm
 float airspeed = 0; //m/s
@@ -44,6 +116,29 @@ float voltage = 0; //volts
 float RPM = 0;
 float throttle = 0;
 
+//every raw reading is timestamped when it's taken, then each round all channels get interpolated to the newest
+//instant they have all reached. Otherwise power and efficiency would mix a thrust from 100ms ago with a current from now
+enum ChannelId {CH_THRUST, CH_TORQUE, CH_RPM, CH_VOLTAGE, CH_CURRENT, CH_AIRSPEED, CHANNEL_COUNT};
+TimedChannel channels[CHANNEL_COUNT];
+float extraValues[ExtraSensors::SLOTS]; //the registry's channels lined up with the rest, in list order
+HealthCounters health; //counts every reading, so a channel that's falling behind shows up on the debug page
+#define HEALTH_PRETEST_MILLIS 1000 //sensor readings for the log header's health lines, about 10 load cell conversions
+HealthTotals healthAtTestStart; //compared against at the end of the test for the log footer
+unsigned long healthTestStart = 0; //millis()
+
+void addReading(ChannelId channel, float value, unsigned long takenAt){ //every reading goes into its channel through here
+    channels[channel].add(value, takenAt);
+    health.sample(channel);
+}
+unsigned long sensorsReadAt = 0; //micros() at the end of the last readSensorData(), the sample ages are from here
+unsigned long lastAlignAt = 0;
+float rawCurrent = 0; //amps, newest reading before the moving average
+bool newSensorRow = false; //set when the aligned instant has moved on, so there's something new to log
+uint8_t staleChannels = 0; //bit per ChannelId, channels too old to hold the rows back. Their age column shows how old
+uint8_t staleChannelsLogged = 0; //what the test log has been told about
+const char* channelNames[CHANNEL_COUNT] = {"thrust", "torque", "rpm", "voltage", "current", "airspeed"};
+#define ALIGN_STALE_LIMIT 500 //ms, how long a quiet channel can hold the rows back when the stale data trip is off
+
 //Calculated Variables
 float electricPower = 0; //watts
 float mechanicalPower = 0; //watts
@@ -58,7 +153,36 @@ float systemEfficiency = 0; //0-100%
 const int SD_CS_PIN = 53;     // Change if your module uses a different CS
 File dataFile; //used for the arduino to write to
 const int flushPeriodMillis = 5000; //this is how often the arduino will flush (save to the SD card) while doing a test
-int lastFlush = 0; 
+unsigned long lastFlush = 0; //millis(), an int wrapped after 32s on the Mega
+bool sdAvailable = false; //false if boot gave up on the card. setUpTest() tries again before refusing to start a test
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//BOOT
+
+#define SD_BOOT_ATTEMPTS 2 //SD.begin tries before booting without a card. A missing card takes ~2s per try
+#define BOOT_TARE_SAMPLES 10 //same count HX711::tare() averages
+#define SENSOR_NODE_BOOT_WAIT 500 //ms to listen for the sensor node before reading the sensors locally. It sends every 10ms once it's up
+
+enum BootStageId {BOOT_DISPLAY, BOOT_PINS, BOOT_LOAD_CELLS, BOOT_CALIBRATION, BOOT_SENSOR_NODE, BOOT_SD_CARD, BOOT_TARE, BOOT_STAGE_COUNT};
+enum BootStageStatus {STAGE_PENDING, STAGE_OK, STAGE_SKIPPED, STAGE_FAILED};
+
+struct BootStage {
+    const char* label;
+    unsigned long start; //ms since power on
+    unsigned long end;
+    BootStageStatus status;
+};
+
+BootStage bootStages[BOOT_STAGE_COUNT] = { //filled in by setup(), shown on the second Debug page
+    {"Display", 0, 0, STAGE_PENDING},
+    {"Pins", 0, 0, STAGE_PENDING},
+    {"Load Cells", 0, 0, STAGE_PENDING},
+    {"Calibration", 0, 0, STAGE_PENDING},
+    {"Sensor Node", 0, 0, STAGE_PENDING},
+    {"SD Card", 0, 0, STAGE_PENDING},
+    {"Tare", 0, 0, STAGE_PENDING},
+};
+unsigned long bootTime = 0; //ms from power on to the main menu
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //LOAD CELLS
@@ -66,6 +190,11 @@ int lastFlush = 0;
 HX711 thrustSensor;
 HX711 torqueSensor;
 
+LoadCellLinearizer thrustLinearizer; //only used after a multi-point calibration
+LoadCellLinearizer torqueLinearizer;
+
+DragTare dragTare; //only used after a drag tare sweep
+
 #define TRQ_DOUT 48
 #define TRQ_CLK 49
 #define TRQ_UNITS "(N.mm)"
@@ -74,12 +203,22 @@ HX711 torqueSensor;
 #define THST_CLK 47
 #define THST_UNITS "(mN)"
 
+#define HX711_PERIOD_MICROS 100000UL //10 conversions a second with the RATE pin low
+
+FastHX711<THST_DOUT, THST_CLK> thrustReader; //does the bit banging for the local cells, the HX711 objects keep the offset and scale
+FastHX711<TRQ_DOUT, TRQ_CLK> torqueReader;
+unsigned long hx711ReadMicros = 0; //how long the last local read held the CPU, shown on the debug page
+unsigned long hx711ReadMicrosMax = 0;
+
 extern void tareTorque(); //these need to be here so the menu structure knows these exist before they're declared in the file
 extern void calibrateTorque();
 
 extern void tareThrust();
 extern void calibrateThrust();
 
+extern void multiPointCalibrateThrust();
+extern void multiPointCalibrateTorque();
+
 ///////////////////////////////////////////////////////////////////////////////////////
 // CURRENT AND VOLTAGE SENSOR DEFINITIONS
 
@@ -105,11 +244,44 @@ volatile unsigned long pulses;
 long lastRpmReadTime = 0;
 long rpmUpdateRate = 250; //update rate of rpm reading in ms
 
+#define RPM_GLITCH_MICROS 50 //edges closer than this are the sensor bouncing, a 10 degree marker still takes 80us to pass at 20000 RPM
+volatile unsigned long rpmGlitches = 0; //edges thrown out since the last getRPM()
+volatile unsigned long lastRpmEdge = 0; //micros()
+
 //interrupt service routine
 void rpmISR() {
+    unsigned long now = micros();
+    if (now - lastRpmEdge < RPM_GLITCH_MICROS) {
+        rpmGlitches++;
+        return;
+    }
+    lastRpmEdge = now;
     pulses++;
 }
 
+//RPM check, the optical reading against the current ripple (RippleRpm.h) during tests
+long rippleCheck = 0; //1 = a current burst every rippleCheckPeriod, logged next to the optical RPM
+long motorPoles = 14; //magnets in the bell, not pole pairs
+long rippleSampleRate = 20000; //Hz
+long rippleCheckPeriod = 2000; //ms between bursts, each holds the test loop up for ~13ms
+long rippleTolerance = 5; //% apart before a check gets flagged
+
+#define RIPPLE_ADC_PRESCALE (1 << ADPS2) //ADC clock / 16, ~16us a read instead of ~112us for a couple of bits of accuracy
+#define RIPPLE_FAST_RATE 60000 //Hz, back to back reads at that clock. Slower rates add a few up per sample
+#define RIPPLE_MIN_RPM 500 //band the ripple is looked for in
+#define RIPPLE_MAX_RPM 30000 //top of the band when the max RPM limit is off
+#define RIPPLE_MIN_THROTTLE 10 //%, below this the motor might not be turning yet
+#define RIPPLE_SETTLE_TIME 300 //ms for the motor to reach a new throttle's speed
+
+unsigned long lastRippleCheck = 0; //millis()
+float rippleThrottle = 0; //throttle the motor is settling at, and since when
+unsigned long rippleThrottleSince = 0;
+long rippleChecks = 0; //this test, for the summary line at the end
+long rippleMismatches = 0;
+long rippleWeak = 0; //bursts with no ripple standing out of the noise
+float rippleRpm = 0; //last burst's estimate, 0 if it was weak. Held in the log columns until the next burst
+bool rippleMismatch = false; //last burst was more than rippleTolerance off the optical RPM
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //AIRSPEED SENSOR
 
@@ -119,22 +291,163 @@ float zeroVoltage = 2.7;    // MODIFY THIS VALUE TO CORRESPOND TO VOLTAGE WITHOU
 #define sensitivity 1   // Sensor sensitivity in V/kPa
 #define airDensity 1.2    // Air density at sea level in kg/m^3
 
+//conversions from averaged counts, redone by updateAnalogConversions() whenever an offset above changes
+LinearScale voltageScale;
+LinearScale currentScale;
+AirspeedLookup airspeedLookup;
+
+////////////////////////////////////////////////////////////////////////////////////////
+//VIBRATION SENSOR
+
+#define VIBRATION_PIN A4 //accelerometer (ADXL335 or similar), one axis across the motor shaft
+#define ACCEL_VOLTS_PER_G 0.3 //ADXL335 on 3.3V, the zero doesn't matter since the spectrum leaves out DC
+
+enum VibrationSource {VIB_ACCEL, VIB_THRUST, VIB_TORQUE};
+
+VibrationSpectrum vibSpectrum; //1KB, only holds anything from the burst until the test file is closed
+bool vibrationCaptured = false; //finishTest() writes Vib_N.csv if this test took a burst
+float vibSampleHz = 0; //what the burst actually came in at
+float vibRpm = 0; //RPM across the burst, for finding the 1x and 2x peaks
+
+#define VIB_MIN_RATE 100 //Hz
+#define VIB_MAX_RATE 4000 //Hz, an analogRead takes ~112us
+#define VIB_SLEW_RATE 20 //% per second up to the scan throttle, same as the intervals test
+#define VIB_PEAK_SEARCH_BINS 2 //how far from the RPM's bin a 1x/2x peak can be
+
 ////////////////////////////////////////////////////////////////////////////////////////
 //THROTTLE LOGIC DEFINITIONS
 //(For a HARGRAVE MICRODRIVE ESC, accepted PWM frequencies range from 50Hz to 499 Hz
 
-Servo esc; 
+EscOutput esc; 
 const int MIN_THROTTLE = 1050;
 const int MAX_THROTTLE = 1950;
-const int ESC_PIN = 3;
+const int ESC_PIN = EscOutput::PIN; //timer 3 output C, the driver can't move it
+
+long escRate = 490; //Hz for standard PWM, each pulse is a throttle update so faster means less lag
+long escOneShot = 0; //1 = OneShot125 at the system tick rate, only for ESCs that support it
+
+void configureEsc(){ //applies the ESC menu settings if they changed. Only call with the throttle at minimum
+    EscProtocol protocol = escOneShot ? ESC_ONESHOT125 : ESC_PWM;
+    if (protocol == esc.protocol() && (protocol == ESC_ONESHOT125 || escRate == esc.rate())){
+        return; //restarting the timer for nothing would stretch one period
+    }
+    esc.begin(protocol, escRate, MIN_THROTTLE);
+    if (protocol == ESC_PWM){
+        escRate = esc.rate(); //show the clamped rate in the menu
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SAFETY LIMITS
+//checked every ms from the system tick while a test is running. Any of them cuts the ESC to MIN_THROTTLE and
+//ends the test, 0 turns that limit off
+
+long maxThrustLimit = 40000; //mN
+long maxTorqueLimit = 3000; //N.mm
+long maxCurrentLimit = 50; //amps
+long maxRpmLimit = 20000;
+long staleDataLimit = 500; //ms without fresh readings. Normal test loops publish well under 100ms apart
+
+SafetySupervisor supervisor;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//EFFICIENCY MAP
+
+long mapAxisSetting = MAP_AIRSPEED; //0 = throttle x airspeed, 1 = throttle x RPM
+long mapAirspeedBin = 5; //m/s per bin
+long mapRpmBin = 2000; //RPM per bin
+
+EfficiencyMap efficiencyMap;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//ADAPTIVE LOGGING
+
+//In adaptive mode a row only goes to the card when a channel has moved past its deadband since the last row
+//written, when the throttle changes, or when logHeartbeat runs out. Holds and settled steps end up a row a
+//second while ramps and steps still get every row. Reading it back: hold each row's values until the next row.
+long adaptiveLogging = 0; //0 = every row, 1 = adaptive
+long logHeartbeat = 1000; //ms, longest gap between rows
+long thrustDeadband = 100; //mN
+long torqueDeadband = 5; //N.mm
+long rpmDeadband = 300;
+long voltageDeadband = 200; //mV, a couple of ADC counts
+long currentDeadband = 500; //mA
+long airspeedDeadband = 50; //cm/s
+
+struct LogRow { //one CSV row, kept back in adaptive mode so the row just before a change can still be written
+    float time;
+    float current;
+    float voltage;
+    float torque;
+    float thrust;
+    float rpm;
+    float airspeed;
+    float throttle;
+    float electricPower;
+    float mechanicalPower;
+    float propellerPower;
+    float motorEfficiency;
+    float propellerEfficiency;
+    float systemEfficiency;
+    float ages[CHANNEL_COUNT]; //ms
+    float rippleRpm; //held from the last RPM check burst, after the ages in the CSV
+    bool rippleMismatch;
+    float extra[ExtraSensors::SLOTS]; //registry channels, after the ripple columns in the CSV
+};
+
+DeadbandLogger deadbandLogger;
+LogRow heldRow; //newest row adaptive mode skipped
+bool rowHeld = false;
+
+//compressed logs (Test_N.dlg) store time, current, voltage, torque, thrust, RPM, airspeed and throttle as
+//varint deltas, about a tenth the size of the CSV. tools/log_decode.cpp turns them back into CSV
+long compressedLogging = 0; //0 = CSV, 1 = compressed
+
+//raw logs keep what the sensors gave (HX711 counts, ADC sums, RPM edges and the window they were counted over)
+//instead of units, with a # raw header holding every constant that turns them into units. Rows are a handful of
+//integers, and tools/log_decode.cpp --raw can redo an old run with a corrected calibration. Always CSV, every row
+long rawLogging = 0; //0 = units, 1 = raw counts
+
+struct RawCounts { //newest reading of each sensor as it came in
+    int32_t thrust; //HX711, offset not taken off
+    int32_t torque;
+    uint16_t voltage; //ADC sum over averageCount reads, or the node's x16 average. The header says which
+    uint16_t current; //before the moving average
+    uint16_t airspeed;
+    uint32_t rpmEdges; //rising and falling, in the last finished RPM window
+    uint32_t rpmWindow; //us
+};
+
+RawCounts rawCounts;
+
+bool compressedLog(){ //raw logs are always CSV
+    return compressedLogging && !rawLogging;
+}
+
+LogEncoder logEncoder;
+
+#define LOG_INDEX_PERIOD 30000 //ms, an index entry at least this often so long runs can be seeked into by time as well
+
+LogIndexer logIndexer;
+uint8_t logSegment = 0; //segment and step the rows going into the file belong to
+uint8_t logStep = 0;
+unsigned long lastIndexMark = 0; //millis()
 
 //-----------------------------------------GLOBAL VARIABLES-----------------------------------
 
 //UI
 #define USER_NOTIF_DELAY 1800
+#define TEST_DISPLAY_PERIOD 200 //ms between screen refreshes during a test, each one ties up I2C for ~25ms
+#define DEBUG_REFRESH_PERIOD 250 //ms between debug page refreshes
+
+bool menuDirty = true; //loop() only redraws the menu when this is set
+bool uiBusy = false; //an action or value edit is running, Serial commands that would start another one get turned away
+bool testActive = false; //inside runTest()
+bool scriptedStart = false; //test started over Serial or by a campaign, setUpTest() skips its prompts
+bool testCancelled = false; //a key press ended the last test early
 
 long testNumber = 1;
-short testType = 1; //1 = normal test (default), 2 = piecewise test with pausing
+long testType = 1; //1 = smooth ramp (default), 2 = intervals, 3 = piecewise test with pausing, 4 = battery, 5 = vibration scan
 
 //smooth ramp
 long rampTime = 15; //in seconds
@@ -147,6 +460,21 @@ long intervalCount = 8;
 long intervalTime = 4;
 long rampSettleTime = 1000;
 
+//vibration scan
+long vibThrottle = 50; //as a percent
+long vibSettleTime = 3000; //ms at the throttle before the burst
+long vibSource = VIB_ACCEL; //0 = accelerometer, 1 = thrust cell, 2 = torque cell
+long vibSampleRate = 2000; //Hz, accelerometer only. The load cells go as fast as the HX711 converts
+
+//campaign
+long campaignCooldown = 30; //s with the motor off between tests
+long campaignAutoTare = 1; //re-zero the load cells after each cooldown
+
+//drag tare
+long dragTareStep = 2; //m/s between sweep points
+long dragTareMax = 20; //m/s, the last sweep point
+long dragTareEnabled = 1; //take the drag off the thrust when there's a table
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //KEYBOARD SETUP
 const byte ROWS = 4; //four rows
@@ -179,6 +507,138 @@ U8G2_SSD1309_128X64_NONAME0_F_HW_I2C u8g2(
     U8X8_PIN_NONE
 );
 
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SENSOR NODE
+
+//With a sensor node (src/sensor_arduino) wired to Serial1, the load cells, analog sensors and RPM are read on the
+//Nano and arrive here as SamplePackets. The system tick pulls bytes out of the UART and stamps each good frame with
+//its arrival time, so a slow loop here never costs a sample or its timing. Without a node everything is read locally.
+#define SENSOR_NODE_SERIAL Serial1
+#define SENSOR_PACKET_QUEUE 16 //150ms of packets (one slot stays empty), the longest test loop pass is about 90ms
+#define SENSOR_FRAME_MICROS ((sizeof(SamplePacket) + SENSOR_LINK_OVERHEAD) * 10000000UL / SENSOR_LINK_BAUD) //time on the wire
+
+struct ReceivedSample {
+    SamplePacket packet;
+    unsigned long receivedAt; //micros() here when the last byte came in
+};
+
+struct NodeLoadCell { //newest raw counts for tare and calibration, which need every conversion and not just the aligned value
+    long counts;
+    bool fresh;
+};
+
+SensorLinkParser sensorLink;
+RingBuffer<ReceivedSample, SENSOR_PACKET_QUEUE> sensorPackets;
+bool sensorNodeActive = false; //decided at boot
+uint16_t lastNodeSequence = 0;
+bool nodeSequenceValid = false;
+unsigned long droppedNodePackets = 0; //lost on the wire, to a bad CRC or to a full queue
+NodeLoadCell nodeThrust = {0, false};
+NodeLoadCell nodeTorque = {0, false};
+unsigned long nodeRpmEdges = 0; //packet windows are short, RPM adds them up to rpmUpdateRate like the local counter
+unsigned long nodeRpmWindow = 0; //us
+
+void pollSensorLink() { //tick side, with interrupts back on so the USART can keep filling Serial1 meanwhile
+    while (SENSOR_NODE_SERIAL.available()) {
+        if (sensorLink.feed(SENSOR_NODE_SERIAL.read()) && sensorLink.type() == LINK_SAMPLE && sensorLink.length() == sizeof(SamplePacket)) {
+            ReceivedSample sample;
+            memcpy(&sample.packet, sensorLink.payload(), sizeof(SamplePacket));
+            sample.receivedAt = micros();
+            sensorPackets.push(sample); //a full queue drops it, the sequence gap shows up in droppedNodePackets
+            safetyFromPacket(sample.packet);
+        }
+    }
+}
+
+unsigned long nodeToLocal(const ReceivedSample& sample, uint32_t nodeTime) { //node micros() to micros() here
+    return sample.receivedAt - SENSOR_FRAME_MICROS - (sample.packet.sentAt - nodeTime);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SYSTEM TICK
+
+//Timer 2 gives a 1 kHz tick (timer 0 is millis(), timer 3 drives the ESC). The keypad is scanned from
+//the tick and presses go into a queue, so nothing has to sit in a loop calling getKey() to catch a key.
+#define KEYPAD_SCAN_TICKS 10 //scan every 10ms, same as the keypad library's debounce time
+#define KEY_QUEUE_SIZE 8
+#define SAFETY_CURRENT_TICKS 2 //local current read for the supervisor every 2ms, an analogRead is 112us
+
+RingBuffer<char, KEY_QUEUE_SIZE> keyQueue;
+volatile unsigned long systemTicks = 0; //ms since startSystemTick()
+volatile bool adcClaimed = false; //main loop code is mid analogRead, the tick's current read waits for the next turn
+
+ISR(TIMER2_COMPA_vect) {
+    static uint8_t scanCountdown = KEYPAD_SCAN_TICKS;
+    static uint8_t currentCountdown = SAFETY_CURRENT_TICKS;
+    static volatile bool slowHalf = false; //a tick is still in the part below that runs with interrupts on
+    systemTicks++;
+
+    //safety first, so the ESC gets cut on the same tick the limit is crossed
+    if (supervisor.check(millis())) {
+        esc.cut(MIN_THROTTLE);
+    }
+    esc.tick(); //throttle changes go out in step with the tick
+
+    //a keypad scan is 100-150us of digitalWrite/digitalRead. With interrupts off that long the USART loses sensor
+    //node bytes, one comes every 40us at 250k and it only holds 2, so the rest runs with them back on
+    if (slowHalf) {
+        return; //the tick before is still going, it'll pick up whatever came in
+    }
+    slowHalf = true;
+    sei();
+    pollSensorLink();
+    if (--currentCountdown == 0) {
+        currentCountdown = SAFETY_CURRENT_TICKS;
+        safetyCurrentRead();
+    }
+
+    if (--scanCountdown == 0) {
+        scanCountdown = KEYPAD_SCAN_TICKS;
+        char key = customKeypad.getKey(); //the only place getKey() gets called, the library isn't safe to share
+        if (key != NO_KEY) {
+            keyQueue.push(key); //if the queue is full the press is dropped
+        }
+    }
+    cli(); //so a tick can't come in between here and the end of this one
+    slowHalf = false;
+}
+
+void startSystemTick() {
+    noInterrupts();
+    TCCR2A = (1 << WGM21); //CTC mode, count up to OCR2A then start over
+    TCCR2B = (1 << CS22); //16MHz / 64
+    OCR2A = 249; //250 counts = 1ms
+    TIMSK2 = (1 << OCIE2A);
+    interrupts();
+}
+
+char commandKeys[CommandLine::MAX_LINE + 1] = ""; //keys typed with the Serial key command, handed out before the keypad's
+uint8_t commandKeyIndex = 0;
+
+char readKey() { //next queued key press, NO_KEY if there isn't one. Never waits
+    serviceSerialCommands(); //every wait in the UI comes through here, so commands get answered wherever we are
+    if (commandKeys[commandKeyIndex]){
+        return commandKeys[commandKeyIndex++];
+    }
+    char key = NO_KEY;
+    keyQueue.pop(key);
+    return key;
+}
+
+void uiIdle() { //sleep until the next interrupt, the tick wakes us up at least once a ms
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+}
+
+char waitForKey() { //sleeps until a key is pressed and returns it
+    char key;
+    while (!(key = readKey())) {
+        uiIdle();
+    }
+    return key;
+}
+
+
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //MENU SETUP
@@ -203,9 +663,39 @@ MENU FLOW CHART:
                 2222 Interval Time
                 2223 Max Throttle
                 2224 Up/Down Mode (Just up or up and down)
+            223 Vibration Scan (spectrum written to Vib_N.csv next to the test)
+                2231 Throttle
+                2232 Settle Time
+                2233 Source (accelerometer, thrust or torque)
+                2234 Sample Rate
         23 Test Setup Selection
             231 RPM Marker Count
             232 Test File Name
+            235 ESC Update Rate
+            236 ESC OneShot125 On/Off
+        24 Safety Limits (0 turns a limit off)
+            241 Max Thrust
+            242 Max Torque
+            243 Max Current
+            244 Max RPM
+            245 Stale Data Timeout
+        25 Efficiency Map (written to Map_N.csv next to each test)
+            251 Second Axis (airspeed or RPM)
+            252 Airspeed Bin Width
+            253 RPM Bin Width
+        26 Logging
+            261 Adaptive Logging On/Off
+            262 Heartbeat Interval
+            263 Deadbands
+                2631-2636 Thrust, Torque, RPM, Voltage, Current, Airspeed
+            264 Compressed Log On/Off
+            265 Raw Counts Log On/Off
+            266 RPM Check (optical RPM against the current ripple, # rpm check lines in the log)
+                2661 On/Off
+                2662 Motor Poles
+                2663 Burst Sample Rate
+                2664 Time Between Checks
+                2665 Tolerance
 
     3 Tare Sensors
         // 31 Zero All
@@ -214,9 +704,24 @@ MENU FLOW CHART:
         // 34 Zero Force
         // 35 Zero Torque
         // 36 Zero Analog
+        37 Multi-Point Calibration
+            371 Thrust Sensor
+            372 Torque Sensor
 
     4 Debug Menu
         Display read values for all sensors,
+
+    5 Campaign (the tests in CAMPAIGN.TXT on the SD card, back to back)
+        51 Run Campaign
+        52 Cooldown Between Tests
+        53 Auto Tare On/Off
+
+    6 Drag Tare (motor off, the stand's own drag at each tunnel airspeed, taken off the thrust from then on)
+        61 Run Sweep
+        62 Airspeed Step
+        63 Max Airspeed
+        64 Subtract Drag On/Off
+        65 Clear Table
 */
 enum ItemType {TYPE_SUBMENU, TYPE_TOGGLE, TYPE_VALUE, TYPE_ACTION};
 
@@ -248,11 +753,46 @@ MenuItem menus[] = {
                 {2222, "Interval Time", TYPE_VALUE, 222, &intervalTime},
                 {2223, "Max Throttle (0-100%)", TYPE_VALUE, 222, &testThrottleMax, NULL},
                 {2224, "Ramp Settle Time (ms)", TYPE_VALUE, 222, &rampSettleTime, NULL},
+            {223, "Vibration", TYPE_SUBMENU, 22, NULL, NULL},
+                {2231, "Throttle (0-100%)", TYPE_VALUE, 223, &vibThrottle, NULL},
+                {2232, "Settle Time (ms)", TYPE_VALUE, 223, &vibSettleTime, NULL},
+                {2233, "Src 0=Acc 1=Thr 2=Trq", TYPE_VALUE, 223, &vibSource, NULL},
+                {2234, "Sample Rate (Hz)", TYPE_VALUE, 223, &vibSampleRate, NULL},
         {23, "Configure Hardware", TYPE_SUBMENU, 2, NULL, NULL},
             {231, "RPM Marker Count", TYPE_VALUE, 23, &pulsesPerRev, NULL},
             {232, "RPM Update Rate (ms)", TYPE_VALUE, 23, &rpmUpdateRate, NULL},
             {233, "A-Spd Override (m/s)", TYPE_VALUE, 23, &airspeedOverride, NULL},
             {234, "Moving AVG Gain (0-100)", TYPE_VALUE, 23, &averageGain, NULL},
+            {235, "ESC Rate (50-490Hz)", TYPE_VALUE, 23, &escRate, NULL},
+            {236, "ESC OneShot125 (0/1)", TYPE_VALUE, 23, &escOneShot, NULL},
+        {24, "Safety Limits", TYPE_SUBMENU, 2, NULL, NULL},
+            {241, "Max Thrust (mN)", TYPE_VALUE, 24, &maxThrustLimit, NULL},
+            {242, "Max Torque (N.mm)", TYPE_VALUE, 24, &maxTorqueLimit, NULL},
+            {243, "Max Current (A)", TYPE_VALUE, 24, &maxCurrentLimit, NULL},
+            {244, "Max RPM", TYPE_VALUE, 24, &maxRpmLimit, NULL},
+            {245, "Stale Data (ms)", TYPE_VALUE, 24, &staleDataLimit, NULL},
+        {25, "Efficiency Map", TYPE_SUBMENU, 2, NULL, NULL},
+            {251, "Axis (0=A-Spd 1=RPM)", TYPE_VALUE, 25, &mapAxisSetting, NULL},
+            {252, "A-Spd Bin (m/s)", TYPE_VALUE, 25, &mapAirspeedBin, NULL},
+            {253, "RPM Bin", TYPE_VALUE, 25, &mapRpmBin, NULL},
+        {26, "Logging", TYPE_SUBMENU, 2, NULL, NULL},
+            {261, "Adaptive Log (0/1)", TYPE_VALUE, 26, &adaptiveLogging, NULL},
+            {262, "Heartbeat (ms)", TYPE_VALUE, 26, &logHeartbeat, NULL},
+            {264, "Compressed (0/1)", TYPE_VALUE, 26, &compressedLogging, NULL},
+            {265, "Raw Counts (0/1)", TYPE_VALUE, 26, &rawLogging, NULL},
+            {263, "Deadbands", TYPE_SUBMENU, 26, NULL, NULL},
+                {2631, "Thrust (mN)", TYPE_VALUE, 263, &thrustDeadband, NULL},
+                {2632, "Torque (N.mm)", TYPE_VALUE, 263, &torqueDeadband, NULL},
+                {2633, "RPM", TYPE_VALUE, 263, &rpmDeadband, NULL},
+                {2634, "Voltage (mV)", TYPE_VALUE, 263, &voltageDeadband, NULL},
+                {2635, "Current (mA)", TYPE_VALUE, 263, &currentDeadband, NULL},
+                {2636, "A-Spd (cm/s)", TYPE_VALUE, 263, &airspeedDeadband, NULL},
+            {266, "RPM Check", TYPE_SUBMENU, 26, NULL, NULL},
+                {2661, "RPM Check (0/1)", TYPE_VALUE, 266, &rippleCheck, NULL},
+                {2662, "Motor Poles", TYPE_VALUE, 266, &motorPoles, NULL},
+                {2663, "Burst Rate (Hz)", TYPE_VALUE, 266, &rippleSampleRate, NULL},
+                {2664, "Check Every (ms)", TYPE_VALUE, 266, &rippleCheckPeriod, NULL},
+                {2665, "Tolerance (%)", TYPE_VALUE, 266, &rippleTolerance, NULL},
 
     {3, "Tare Sensors", TYPE_SUBMENU, 0, NULL, NULL},
         {32, "Zero Thrust", TYPE_ACTION, 3, NULL, tareThrust},
@@ -260,8 +800,23 @@ MenuItem menus[] = {
         {34, "Calibrate Thrust Sensor", TYPE_ACTION, 3, NULL, calibrateThrust},
         {35, "Calibrate Torque Sensor", TYPE_ACTION, 3, NULL, calibrateTorque},
         {36, "Zero Analog", TYPE_ACTION, 3, NULL, zeroAnalog},
+        {37, "Multi-Point Calibration", TYPE_SUBMENU, 3, NULL, NULL},
+            {371, "Thrust Sensor", TYPE_ACTION, 37, NULL, multiPointCalibrateThrust},
+            {372, "Torque Sensor", TYPE_ACTION, 37, NULL, multiPointCalibrateTorque},
 
     {4, "Debug", TYPE_ACTION, 0, NULL, debugMenu},
+
+    {5, "Campaign", TYPE_SUBMENU, 0, NULL, NULL},
+        {51, "Run Campaign", TYPE_ACTION, 5, NULL, runCampaign},
+        {52, "Cooldown (s)", TYPE_VALUE, 5, &campaignCooldown, NULL},
+        {53, "Auto Tare (0/1)", TYPE_VALUE, 5, &campaignAutoTare, NULL},
+
+    {6, "Drag Tare", TYPE_SUBMENU, 0, NULL, NULL},
+        {61, "Run Sweep", TYPE_ACTION, 6, NULL, dragTareSweep},
+        {62, "A-Spd Step (m/s)", TYPE_VALUE, 6, &dragTareStep, NULL},
+        {63, "Max A-Spd (m/s)", TYPE_VALUE, 6, &dragTareMax, NULL},
+        {64, "Subtract Drag (0/1)", TYPE_VALUE, 6, &dragTareEnabled, NULL},
+        {65, "Clear Table", TYPE_ACTION, 6, NULL, clearDragTare},
 }; 
 
 //this has to exist because calculating the number of items
@@ -283,10 +838,10 @@ MenuItem* getMenu(int menuId) {//returns null if no Menu Item with that ID, othe
 }
 
 void pressKeyToContinue(){
-    //wait for user to acknowledge
-    while (customKeypad.getKey() == NO_KEY){
-        //do nothing and wait for them to press a key
-    }
+    //wait for user to acknowledge. Anything pressed before the prompt went up doesn't count
+    keyQueue.clear();
+    commandKeys[commandKeyIndex] = '\0';
+    waitForKey();
 }
 
 void drawMenu(int menuId) { //pass the ID of the parent menu. Will fetch all submenus and display them
@@ -346,6 +901,28 @@ int getChosenMenuId(int choice) { //given an the int of the choice (1 index), th
     return -1;
 }
 
+void drawValueEdit(const char* label, const String& input, bool cursorOn){ //one frame of the value entry screen
+    u8g2.clearBuffer();
+    u8g2.setFontMode(1);
+    u8g2.setBitmapMode(1);
+    u8g2.setFont(u8g2_font_t0_12b_tr);
+    u8g2.drawStr(2, 11, label);
+    u8g2.drawLine(0, 13, 127, 13);
+    u8g2.setFont(u8g2_font_4x6_tr);
+    u8g2.drawStr(89, 51, "Accept: # ");
+    u8g2.drawStr(89, 57, "Delete: D");
+    u8g2.drawStr(89, 63, "Cancel: *");
+    u8g2.setFont(u8g2_font_t0_22b_tr);
+
+    //print the input string
+    u8g2.setCursor(3, 40);
+    u8g2.print(input);
+    if (cursorOn){
+        u8g2.print("|");
+    }
+    u8g2.sendBuffer();
+}
+
 void valueEditMenu(long* value, const char* label){ //pass this method a pointer to an int and a label to show for the int. It will give the user the UI to type in any positive integer of 8 digits or less.
     Serial.println("Inside value edit menu!");
     if (!value){
@@ -353,65 +930,54 @@ void valueEditMenu(long* value, const char* label){ //pass this method a pointer
         return;
     }
 
-    int startTime = millis(); //we track how long since it started so that we can time out
+    unsigned long startTime = millis(); //we track how long since it started so that we can time out
     Serial.print("Value is: "); Serial.println(*value);
     Serial.print("Label is: "); Serial.println(label);
     //set up the input string
     String input = String(*value);
+    bool redraw = true;
+    bool cursorShown = false;
 
     while(1){
-        //set up for entry
-        u8g2.clearBuffer();
-        u8g2.setFontMode(1);
-        u8g2.setBitmapMode(1);
-        u8g2.setFont(u8g2_font_t0_12b_tr);
-        u8g2.drawStr(2, 11, label);
-        u8g2.drawLine(0, 13, 127, 13);
-        u8g2.setFont(u8g2_font_4x6_tr);
-        u8g2.drawStr(89, 51, "Accept: # ");
-        u8g2.drawStr(89, 57, "Delete: D");
-        u8g2.drawStr(89, 63, "Cancel: *");
-        u8g2.setFont(u8g2_font_t0_22b_tr);
-        
-        //print the input string
-        u8g2.setCursor(3, 40);
-        u8g2.print(input);
+        bool cursorOn = (millis()-startTime)/300 % 2 == 1; //check time to do a cursor blink. Uses modulo to decide whethere it's an "even" or "odd" time
 
-        if ((millis()-startTime)/300 % 2 == 1){ //check time to do a cursor blink. Uses modulo to decide whethere it's an "even" or "odd" time
-            u8g2.print("|");
+        //only redraw when a key changed the input or the cursor blinked
+        if (redraw || cursorOn != cursorShown){
+            drawValueEdit(label, input, cursorOn);
+            cursorShown = cursorOn;
+            redraw = false;
         }
-        
-         //wait for the user to press a key
-        char userInput = customKeypad.getKey();
-    
-        // If a key is pressed, print it to the Serial Monitor
-        if (userInput) {
-            Serial.println(userInput);
-
-            //check to see if the key is a number, if it is then we should put the number into the string
-            if (userInput >= '0' && userInput <= '9') {
-                if (input.length() < 8){ //make sure the number doesn't get too long for int overflow!
-                    input += userInput;
-                }
 
-            //asterisk is the cancel button
-            } else if (userInput == '*') {
-                Serial.println("Cancel");
-                return;
-            
-            //pound is the confirm button
-            } else if (userInput == '#') {
-                *value = input.toInt();
-                return;
-
-            //D is the delete button
-            } else if (userInput == 'D') {
-                if (input.length() > 0) {
-                    input.remove(input.length() - 1);
-                }
+        char userInput = readKey();
+        if (!userInput){
+            uiIdle();
+            continue;
+        }
+        redraw = true;
+        Serial.println(userInput);
+
+        //check to see if the key is a number, if it is then we should put the number into the string
+        if (userInput >= '0' && userInput <= '9') {
+            if (input.length() < 8){ //make sure the number doesn't get too long for int overflow!
+                input += userInput;
             }
-        } 
-        u8g2.sendBuffer();
+
+        //asterisk is the cancel button
+        } else if (userInput == '*') {
+            Serial.println("Cancel");
+            return;
+
+        //pound is the confirm button
+        } else if (userInput == '#') {
+            *value = input.toInt();
+            return;
+
+        //D is the delete button
+        } else if (userInput == 'D') {
+            if (input.length() > 0) {
+                input.remove(input.length() - 1);
+            }
+        }
     }
 }
 
@@ -423,11 +989,15 @@ void executeMenu(int targetMenuId) {
     } else if (targetMenu.type == TYPE_ACTION) {
         Serial.println("Action Type!"); 
         if (targetMenu.action){
+            uiBusy = true;
             targetMenu.action(); //all the function if it's a function menu item
+            uiBusy = false;
         }
     } else if (targetMenu.type == TYPE_VALUE) {
         Serial.println("Value Type!");
+        uiBusy = true;
         valueEditMenu(targetMenu.variable, targetMenu.label);
+        uiBusy = false;
     } else if (targetMenu.type == TYPE_TOGGLE) {
         Serial.println("Toggle Type!");
         //write bool change function here
@@ -469,6 +1039,34 @@ void drawLoadingScreen(int loadPercent, const char* message){//pass load percent
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //LOAD CELL FUNCTIONS
 
+//the HX711 objects hold the scale and offset either way, these two get the raw counts from wherever the cell is wired
+
+bool loadCellReady(HX711* loadCell) { //true if a conversion is waiting
+    if (!sensorNodeActive) {
+        return (loadCell == &thrustSensor) ? thrustReader.isReady() : torqueReader.isReady();
+    }
+    readSensorNode();
+    return (loadCell == &thrustSensor ? nodeThrust : nodeTorque).fresh;
+}
+
+long readLoadCellCounts(HX711* loadCell) { //next raw conversion, waits for it like HX711::read()
+    if (!sensorNodeActive) {
+        while (!loadCellReady(loadCell)) {}
+        unsigned long start = micros();
+        long counts = (loadCell == &thrustSensor) ? thrustReader.read() : torqueReader.read();
+        hx711ReadMicros = micros() - start;
+        if (hx711ReadMicros > hx711ReadMicrosMax) hx711ReadMicrosMax = hx711ReadMicros;
+        return counts;
+    }
+    NodeLoadCell& cell = (loadCell == &thrustSensor) ? nodeThrust : nodeTorque;
+    while (!cell.fresh) {
+        readSensorNode();
+        if (!cell.fresh) uiIdle();
+    }
+    cell.fresh = false;
+    return cell.counts;
+}
+
 void tareLoadCell(HX711* loadCell) { //pass a load cell object, will take the user through taring the load cell
 
     //prompt the user to remove load from the load cell
@@ -490,11 +1088,42 @@ void tareLoadCell(HX711* loadCell) { //pass a load cell object, will take the us
     u8g2.drawStr(14, 39, "Taring...");
     u8g2.sendBuffer();
 
-    loadCell->tare();
+    long sum = 0;
+    for (int i = 0; i < BOOT_TARE_SAMPLES; i++) { //same average HX711::tare() takes
+        sum += readLoadCellCounts(loadCell);
+    }
+    loadCell->set_offset(sum / BOOT_TARE_SAMPLES);
     delay(USER_NOTIF_DELAY);
 }
 
-void calibrateLoadCell(HX711* loadCell, String units) {//pass a load cell and the unit string, and will take the user through calibration
+float measureLoadCell(HX711* loadCell, float* percentDev) { //averages a batch of tared readings and passes back the max sample deviation in percent
+    const int N = 50; //the number of samples to average out
+    long samples[N];
+
+    for (int i = 0; i < N; i++) { //read the load cell N times and put in array
+        samples[i] = readLoadCellCounts(loadCell) - loadCell->get_offset();   // blocks until fresh sample. Important that the offset comes off
+        Serial.println(samples[i]);
+    }
+
+    long sum = 0; //needed to initialize for below operation
+    long minVal = samples[0];
+    long maxVal = samples[0];
+
+    for (int i = 0; i < N; i++) { //finds the average, minimum, and maximum sample values of array
+        long v = samples[i];
+        sum += v;
+        if (v < minVal) minVal = v;
+        if (v > maxVal) maxVal = v;
+    }
+
+    float avgReading = (float)sum / N; //calculates the average value
+
+    float maxDev = maxVal-minVal; //calculates the maximum deviation
+    *percentDev = abs((maxDev / avgReading) * 100.0); //calculates the percent deviation
+    return avgReading;
+}
+
+bool calibrateLoadCell(HX711* loadCell, String units) {//pass a load cell and the unit string, and will take the user through calibration. false if they cancelled
     tareLoadCell(loadCell); //start by taring
 
     //tell user to place known load
@@ -506,10 +1135,7 @@ void calibrateLoadCell(HX711* loadCell, String units) {//pass a load cell and th
     u8g2.drawStr(3, 44, "Press any key to continue...");
     u8g2.sendBuffer();
 
-    //wait for user to acknowledge
-    while (customKeypad.getKey() == NO_KEY){
-        //do nothing and wait for them to press a key
-    }
+    pressKeyToContinue();
 
     long knownLoad = 0;
 
@@ -524,7 +1150,7 @@ void calibrateLoadCell(HX711* loadCell, String units) {//pass a load cell and th
         u8g2.drawStr(10, 39, "Canceled");
         u8g2.sendBuffer();
         delay(USER_NOTIF_DELAY);
-        return;
+        return false;
     }
 
     //tell user calibration is in progress
@@ -533,44 +1159,16 @@ void calibrateLoadCell(HX711* loadCell, String units) {//pass a load cell and th
     u8g2.drawStr(4, 40, "Calibrating...");
     u8g2.sendBuffer();
 
-    const int N = 50; //the number of samples to average out
-    long samples[N];
-
-    for (int i = 0; i < N; i++) { //read the load cell N times and put in array
-        samples[i] = loadCell->get_value();   // blocks until fresh sample. Important that it's get value, since that is with offset
-        Serial.println(samples[i]);
-    }
-
-    long sum = 0; //needed to initialize for below operation
-    long minVal = samples[0];
-    long maxVal = samples[0];
-
-    for (int i = 0; i < N; i++) { //finds the average, minimum, and maximum sample values of array
-        long v = samples[i];
-        sum += v;
-        if (v < minVal) minVal = v;
-        if (v > maxVal) maxVal = v;
-
-        /*
-        Serial.println(v);
-        Serial.print("Max Val: "); Serial.println(maxVal);
-        Serial.print("Min Val: "); Serial.println(minVal);
-        Serial.println();
-        */
-    }
-
-    float avgReading = (float)sum / N; //calculates the average value
-
-    float maxDev = maxVal-minVal; //calculates the maximum deviation
-    float percentDev = abs((maxDev / avgReading) * 100.0); //calculates the percent deviation
+    float percentDev;
+    float avgReading = measureLoadCell(loadCell, &percentDev);
 
     //set the calibration factor, this is in counts/unit load
     loadCell->set_scale(avgReading/knownLoad);
     
     Serial.print("Known Force: "); Serial.println(knownLoad);
-    Serial.print("Calibrated Force: "); Serial.println(loadCell->get_units());
+    Serial.print("Calibrated Force: "); Serial.println((readLoadCellCounts(loadCell) - loadCell->get_offset()) / loadCell->get_scale());
     Serial.print("Read Force: "); Serial.println(avgReading);
-    Serial.print("Max Deviation: "); Serial.println(maxDev);
+    Serial.print("Max Deviation (%): "); Serial.println(percentDev);
 
     //tell user the calibration is over
     u8g2.clearBuffer();
@@ -588,111 +1186,303 @@ void calibrateLoadCell(HX711* loadCell, String units) {//pass a load cell and th
 
     u8g2.sendBuffer();
     pressKeyToContinue();
+    return true;
 }
 
-void tareTorque(){
-    tareLoadCell(&torqueSensor);
-}
-
-void tareThrust(){
-    tareLoadCell(&thrustSensor);
-
-}
-
-void calibrateTorque(){ //helper function for the menu, calls calibrateLoadCell
-    calibrateLoadCell(&torqueSensor, TRQ_UNITS);
-    EEPROM.put(TRQ_CAL_ADDRESS, torqueSensor.get_scale()); //write the scale to EEPROM
-}
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//CALIBRATION STORAGE
 
-void calibrateThrust(){//helper function for the menu, calls calibrateLoadCell
-    calibrateLoadCell(&thrustSensor, THST_UNITS);
-    EEPROM.put(THST_CAL_ADDRESS, thrustSensor.get_scale()); //write the scale factor to EEPROM
+bool validScale(float scale){ //a blank or corrupted EEPROM reads back as NaN or 0, which would wreck every reading
+    return isfinite(scale) && scale != 0;
 }
 
-
-//////////////////////////////////////////////////////////////////////////////////////////////////
-//ANALOG SENSOR FUNCTIONS
-
-float findAnalogOffset(float (*valueFunction)()){ //pass this a function that returns a value. It will take a bunch of samples and then calculate the offset from 0 and return it to you
-    const int N = 30; //number of iterations
-    float sum = 0;
-    for (int i = 0; i < N; i++) {
-        sum = sum + valueFunction();
-        delay(50);
+void saveCalibration(){ //snapshot every scale and offset into the next EEPROM slot
+    Calibration cal;
+    cal.thrustScale = thrustSensor.get_scale();
+    cal.thrustOffset = thrustSensor.get_offset();
+    cal.torqueScale = torqueSensor.get_scale();
+    cal.torqueOffset = torqueSensor.get_offset();
+    cal.voltageOffset = VOLTAGE_OFFSET;
+    cal.currentOffset = CURRENT_OFFSET;
+    cal.thrustFit = thrustLinearizer.fitParams();
+    cal.torqueFit = torqueLinearizer.fitParams();
+    cal.dragTable = dragTare.table();
+
+    if (!calStore.save(CAL_VERSION, &cal, sizeof(cal))){
+        Serial.println("Calibration doesn't fit in a store slot!");
+        return;
     }
-    return (sum/N);
+    Serial.print("Calibration saved, slot "); Serial.println(calStore.activeSlot());
 }
 
-float getVoltage(){ //returns the average of averageCount voltage readings taken one after the other
-    float sum = 0;
-    for (int i = 0; i < averageCount; i++) {
-        sum = sum + analogRead(VOLTAGE_PIN); //get all of the voltages
+bool loadCalibration(){ //applies the newest valid calibration record. Returns false if there isn't one and the load cells still need taring
+    Calibration cal = {}; //fields newer than the stored record stay zeroed, which means no multi-point curve or drag tare
+    if (calStore.load(&cal, sizeof(cal)) != 0 && validScale(cal.thrustScale) && validScale(cal.torqueScale)){
+        thrustSensor.set_scale(cal.thrustScale);
+        thrustSensor.set_offset(cal.thrustOffset);
+        torqueSensor.set_scale(cal.torqueScale);
+        torqueSensor.set_offset(cal.torqueOffset);
+        VOLTAGE_OFFSET = cal.voltageOffset;
+        CURRENT_OFFSET = cal.currentOffset;
+        updateAnalogConversions();
+        thrustLinearizer.build(cal.thrustFit);
+        torqueLinearizer.build(cal.torqueFit);
+        dragTare.begin(cal.dragTable);
+        Serial.print("Calibration loaded, slot "); Serial.println(calStore.activeSlot());
+        return true;
     }
-    int voltage_value_in = sum/averageCount; //calculate the average voltage
 
-    return (VOLTAGE_CALIBRATION * ((voltage_value_in * (Vcc / 1023.0))))-VOLTAGE_OFFSET; //this line converts back from analog 0-1023 to raw voltage, then subtracts off the offset and multiplies by calibration factor
+    Serial.println("No stored calibration");
+    return false;
 }
 
-float getCurrent(){ //returns the average of averageCount voltage readings taken one after the other
-    float sum = 0;
-    for (int i = 0; i < averageCount; i++){
-        sum = sum + analogRead(CURRENT_PIN);
+bool loadLegacyCalibration(){ //old single float scales from before the calibration store. Returns true if any looked sane
+    bool found = false;
+    float torqueSensorScale;
+    EEPROM.get(TRQ_CAL_ADDRESS, torqueSensorScale);
+    if (validScale(torqueSensorScale)){
+        torqueSensor.set_scale(torqueSensorScale);
+        found = true;
     }
-    int current_value_in = sum/averageCount;    
-    float current_voltage = current_value_in * (Vcc / 1023.0); //this line converts back from analog 0-1023 to raw voltage, then subtracts off the offset and multiplies by calibration factor
-    return (current_voltage/CURRENT_SENSITIVITY)-CURRENT_OFFSET; //then, the analog voltage on the current pin is converted to current
-}
 
-float getAirspeed(){ 
-    if(airspeedOverride != 0){ //get the set airspeed inputted by the user, if they chose an override
-        return airspeedOverride;
+    float thrustSensorScale;
+    EEPROM.get(THST_CAL_ADDRESS, thrustSensorScale);
+    if (validScale(thrustSensorScale)){
+        thrustSensor.set_scale(thrustSensorScale);
+        found = true;
     }
-    else{ //read airspeed data from the sensor, and returning the average of a bunch of airspeed sensor readings. average count is defined globally 
-        float sum = 0;
-        for (int i = 0; i < averageCount; i++){
-            sum = sum + analogRead(AIRSPEED_PIN);
-        }
-        int airspeed_value_in = sum/averageCount;
-        float airspeed_voltage =  airspeed_value_in * (Vcc / 1023.0); 
+    return found;
+}
 
-        float pressure_kPa = (airspeed_voltage - zeroVoltage) / 1.0; // Convert voltage to differential pressure in kPa
-        float pressure_Pa = pressure_kPa * 1000.0; // Convert kPa to Pascals
+void multiPointCalibrateLoadCell(HX711* loadCell, LoadCellLinearizer* linearizer, String units) { //records known loads one at a time and fits a correction curve through them
+    tareLoadCell(loadCell); //start by taring, the tare is the zero point of the curve
 
-        float airspeed = 0.0;          
-        if (pressure_Pa > 0) {
-            airspeed = sqrt((2.0 * pressure_Pa) / airDensity); // Compute airspeed using Bernoulli equation
-        }
-        return airspeed;
-    }
-}
+    int32_t counts[LoadCellLinearizer::MAX_POINTS];
+    float loads[LoadCellLinearizer::MAX_POINTS];
+    uint8_t pointCount = 0;
 
-void zeroAnalog(){
-    //tell user we are zeroizing
-    u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_t0_22b_tr);
-    u8g2.drawStr(14, 39, "Zeroing");
-    u8g2.sendBuffer();
+    String messageString = ("Enter Load " + units); //two lines for the same dangling pointer reason as calibrateLoadCell
+    const char* message = messageString.c_str();
 
-    VOLTAGE_OFFSET = VOLTAGE_OFFSET + findAnalogOffset(getVoltage);
-    CURRENT_OFFSET = CURRENT_OFFSET + findAnalogOffset(getCurrent);
-}
+    while (pointCount < LoadCellLinearizer::MAX_POINTS) {
+        //tell user to place the next load
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_16b_tr);
+        u8g2.setCursor(3, 15);
+        u8g2.print("Load Point "); u8g2.print(pointCount + 1);
+        u8g2.drawStr(3, 27, "Apply the load.");
+        u8g2.setFont(u8g2_font_4x6_tr);
+        u8g2.drawStr(3, 44, "Press any key to continue...");
+        u8g2.drawStr(3, 51, "Enter a load of 0 to finish");
+        u8g2.sendBuffer();
 
-int getRPM() { //returns RPM. Updates once per rpm update ms
+        pressKeyToContinue();
 
-    if ((unsigned long)(millis() - lastRpmReadTime) <= (unsigned long)rpmUpdateRate) { //cast to unsigned to shut up compiler
-        Serial.println("RPM not ready");
-        return RPM;
+        long knownLoad = 0;
+        valueEditMenu(&knownLoad, message); //ask user to input the load on the cell
+        if (knownLoad == 0) { //cancel or 0 ends the point list
+            break;
+        }
+
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_22b_tr);
+        u8g2.drawStr(4, 40, "Measuring...");
+        u8g2.sendBuffer();
+
+        float percentDev;
+        counts[pointCount] = lround(measureLoadCell(loadCell, &percentDev));
+        loads[pointCount] = knownLoad;
+        Serial.print("Point "); Serial.print(pointCount + 1);
+        Serial.print(": "); Serial.print(counts[pointCount]);
+        Serial.print(" counts at "); Serial.println(knownLoad);
+        pointCount++;
     }
 
-    //grab RPM from sensor, and reset the time before the count starts again.
-    noInterrupts(); //stop reading RPMS here, so that the count corresponds to the period
-    long period = millis() - lastRpmReadTime; //mark the amount of time since the last read
+    LinearizationFit fit;
+    if (!LoadCellLinearizer::fit(counts, loads, pointCount, fit)) { //no points, or two points at the same reading
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_22b_tr);
+        u8g2.drawStr(10, 39, "Canceled");
+        u8g2.sendBuffer();
+        delay(USER_NOTIF_DELAY);
+        return;
+    }
+
+    linearizer->build(fit);
+    loadCell->set_scale(fit.countScale / fit.coef[0]); //slope at zero, so get_units() still reads sensibly outside the test loop
+
+    //check the compiled table against every point
+    float maxError = 0;
+    for (uint8_t i = 0; i < pointCount; i++) {
+        float error = abs((linearizer->toUnits(counts[i]) - loads[i]) / loads[i] * 100.0);
+        if (error > maxError) maxError = error;
+    }
+    Serial.print("Multi-point fit max error (%): "); Serial.println(maxError);
+
+    //tell user the calibration is over
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_16b_tr);
+    u8g2.drawStr(22, 13, "Calibrated");
+
+    u8g2.setFont(u8g2_font_4x6_tr);
+    u8g2.setCursor(3, 24);
+    u8g2.print("Load Points: "); u8g2.print(pointCount);
+    u8g2.setCursor(3, 31);
+    u8g2.print("Max Point Error: %"); u8g2.print(maxError);
+    u8g2.drawStr(3, 49, "Press any key to continue...");
+
+    u8g2.sendBuffer();
+    pressKeyToContinue();
+}
+
+float loadCellUnits(HX711* loadCell, LoadCellLinearizer* linearizer, long rawCounts) { //raw counts to engineering units, through the multi-point table if the cell has one
+    long counts = rawCounts - loadCell->get_offset();
+    if (linearizer->active()) {
+        return linearizer->toUnits(counts);
+    }
+    return counts / loadCell->get_scale();
+}
+
+float readLoadCell(HX711* loadCell, LoadCellLinearizer* linearizer) { //one conversion in engineering units
+    return loadCellUnits(loadCell, linearizer, readLoadCellCounts(loadCell));
+}
+
+void tareTorque(){
+    tareLoadCell(&torqueSensor);
+    saveCalibration();
+}
+
+void tareThrust(){
+    tareLoadCell(&thrustSensor);
+    saveCalibration();
+}
+
+void calibrateTorque(){ //helper function for the menu, calls calibrateLoadCell
+    if (!calibrateLoadCell(&torqueSensor, TRQ_UNITS)){ //backing out leaves the saved calibration, multi-point curve and all, alone
+        return;
+    }
+    torqueLinearizer.clear(); //a single point calibration replaces any multi-point curve
+    saveCalibration(); //write the scale and offset to EEPROM
+}
+
+void multiPointCalibrateTorque(){
+    multiPointCalibrateLoadCell(&torqueSensor, &torqueLinearizer, TRQ_UNITS);
+    saveCalibration();
+}
+
+void multiPointCalibrateThrust(){
+    multiPointCalibrateLoadCell(&thrustSensor, &thrustLinearizer, THST_UNITS);
+    saveCalibration();
+}
+
+void calibrateThrust(){//helper function for the menu, calls calibrateLoadCell
+    if (!calibrateLoadCell(&thrustSensor, THST_UNITS)){
+        return;
+    }
+    thrustLinearizer.clear();
+    saveCalibration(); //write the scale and offset to EEPROM
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//ANALOG SENSOR FUNCTIONS
+
+float findAnalogOffset(float (*valueFunction)()){ //pass this a function that returns a value. It will take a bunch of samples and then calculate the offset from 0 and return it to you
+    const int N = 30; //number of iterations
+    float sum = 0;
+    for (int i = 0; i < N; i++) {
+        sum = sum + valueFunction();
+        delay(50);
+    }
+    return (sum/N);
+}
+
+void updateAnalogConversions(){ //call after changing VOLTAGE_OFFSET, CURRENT_OFFSET or zeroVoltage
+    const float voltsPerCount = Vcc / 1023.0; //converts back from analog 0-1023 to the voltage on the pin
+    voltageScale.begin(VOLTAGE_CALIBRATION * voltsPerCount, VOLTAGE_OFFSET); //pin volts times the divider ratio, minus the offset
+    currentScale.begin(voltsPerCount / CURRENT_SENSITIVITY, CURRENT_OFFSET); //pin volts to amps, minus the offset
+    airspeedLookup.begin(voltsPerCount, zeroVoltage, sensitivity, airDensity); //Bernoulli on the pressure above zeroVoltage
+}
+
+//the ...FromCounts functions take an averaged ADC reading (0-1023) from here or from the sensor node
+float voltageFromCounts(float counts){
+    return voltageScale.convert(counts);
+}
+
+float currentFromCounts(float counts){
+    return currentScale.convert(counts);
+}
+
+float airspeedFromCounts(float counts){
+    if(airspeedOverride != 0){ //get the set airspeed inputted by the user, if they chose an override
+        return airspeedOverride;
+    }
+    return airspeedLookup.convert(counts);
+}
+
+int averageAnalog(int pin, uint16_t* sum){ //average of averageCount readings taken one after the other. sum gets them added up, for raw logs
+    uint16_t total = 0; //40 x 1023 still fits
+    adcClaimed = true;
+    for (int i = 0; i < averageCount; i++) {
+        total += analogRead(pin);
+    }
+    adcClaimed = false;
+    *sum = total;
+    return total/averageCount;
+}
+
+float getVoltage(){ //returns the average of averageCount voltage readings taken one after the other
+    return voltageFromCounts(averageAnalog(VOLTAGE_PIN, &rawCounts.voltage));
+}
+
+float getCurrent(){ //returns the average of averageCount current readings taken one after the other
+    return currentFromCounts(averageAnalog(CURRENT_PIN, &rawCounts.current));
+}
+
+float getAirspeed(){ 
+    if(airspeedOverride != 0){ //no point reading the sensor
+        return airspeedOverride;
+    }
+    return airspeedFromCounts(averageAnalog(AIRSPEED_PIN, &rawCounts.airspeed)); //read airspeed data from the sensor, and returning the average of a bunch of airspeed sensor readings. average count is defined globally 
+}
+
+void zeroAnalog(){
+    //tell user we are zeroizing
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_22b_tr);
+    u8g2.drawStr(14, 39, "Zeroing");
+    u8g2.sendBuffer();
+
+    VOLTAGE_OFFSET = VOLTAGE_OFFSET + findAnalogOffset(getVoltage);
+    CURRENT_OFFSET = CURRENT_OFFSET + findAnalogOffset(getCurrent);
+    updateAnalogConversions();
+    saveCalibration();
+}
+
+int getRPM() { //returns RPM. Updates once per rpm update ms, each update is also added to the RPM channel
+
+    if ((unsigned long)(millis() - lastRpmReadTime) <= (unsigned long)rpmUpdateRate) { //cast to unsigned to shut up compiler
+        Serial.println("RPM not ready");
+        return RPM;
+    }
+
+    //grab RPM from sensor, and reset the time before the count starts again.
+    noInterrupts(); //stop reading RPMS here, so that the count corresponds to the period
+    long period = millis() - lastRpmReadTime; //mark the amount of time since the last read
     long pulseCount = pulses;
     pulses = 0;
+    unsigned long glitches = rpmGlitches;
+    rpmGlitches = 0;
     lastRpmReadTime = millis();
     interrupts();
+    health.totals.rpmEdges += pulseCount;
+    health.totals.rpmGlitches += glitches;
    
-    return (float)(pulseCount*60000.0)/(period*2.0*pulsesPerRev); //return a float. The multiplication of 2 of the period is because pulses are counted on rising and falling.
+    float rpm = (float)(pulseCount*60000.0)/(period*2.0*pulsesPerRev); //The multiplication of 2 of the period is because pulses are counted on rising and falling.
+    rawCounts.rpmEdges = pulseCount;
+    rawCounts.rpmWindow = period*1000UL;
+    addReading(CH_RPM, rpm, micros() - period*500UL); //a count over the whole window belongs to the middle of it
+    return rpm;
 }
 
 
@@ -708,6 +1498,16 @@ void resetSensorData(){ //call to reset all sensor state variables to 0
     current = 0;
     voltage = 0;
     RPM = 0;
+    for (int i = 0; i < CHANNEL_COUNT; i++){
+        channels[i].clear();
+    }
+    ExtraSensors::clear();
+    for (int i = 0; i < ExtraSensors::SLOTS; i++){
+        extraValues[i] = 0;
+    }
+    nodeRpmEdges = 0;
+    nodeRpmWindow = 0;
+    rawCounts = {};
 
     //Calculated Variables
     electricPower = 0;
@@ -718,42 +1518,178 @@ void resetSensorData(){ //call to reset all sensor state variables to 0
     systemEfficiency = 0;
 }
 
-void readSensorData(){ //call to update all of the sensor data to match most recently collected values
+void sampleChannel(ChannelId channel, float (*readFunction)()){ //takes one reading and stamps it with the middle of the time it took
+    unsigned long start = micros();
+    float value = readFunction();
+    addReading(channel, value, start + (micros() - start)/2);
+}
 
-    if (averageGain > 100 || averageGain < 0) {
-        Serial.println("Avg gain out of bounds");
-        averageGain = 0;
+unsigned long alignmentTime(unsigned long now){ //newest instant every channel has a reading at or after, channels with nothing yet are skipped
+    //a channel that's stopped coming in (an unplugged HX711, the node losing a cell) would freeze the instant and the
+    //log would quietly stop getting rows, so past the limit it's left out and held at its last reading instead
+    unsigned long staleLimit = (staleDataLimit > 0 ? staleDataLimit : ALIGN_STALE_LIMIT)*1000UL;
+    unsigned long oldestAge = 0;
+    staleChannels = 0;
+    for (int i = 0; i < CHANNEL_COUNT; i++){
+        //RPM is a count over a whole rpmUpdateRate window, waiting on it would hold every row back by most of a window.
+        //It's interpolated between window centres and held past the newest, its age column shows how far off it is
+        if (i != CH_RPM && !channels[i].empty()){
+            if (channels[i].ageAt(now) > staleLimit){
+                staleChannels |= 1 << i;
+                continue;
+            }
+            oldestAge = max(oldestAge, channels[i].ageAt(now));
+        }
     }
+    oldestAge = ExtraSensors::oldestAge(now, oldestAge, staleLimit); //only the ones that say rows wait for them
+    return now - oldestAge;
+}
 
-    //read RPM
-    RPM = getRPM();
+void countLoadCellRead(uint8_t cell, unsigned long takenAt){ //missed conversions only count with the motor running, that's when every one should be read
+    if (supervisor.armed()){
+        health.loadCellRead(cell, takenAt, HX711_PERIOD_MICROS);
+    }
+}
 
-    //read torque and thrust if ready, otherwise keeps the old values
-    if(thrustSensor.is_ready()){
-        thrust = thrustSensor.get_units();
+void addCurrentSample(float reading, unsigned long takenAt){ //moving average, the raw value is kept for the safety supervisor
+    rawCurrent = reading;
+    float averaged = channels[CH_CURRENT].empty() ? reading : (1-(averageGain/100.0))*channels[CH_CURRENT].value + (averageGain/100.0)*reading;
+    addReading(CH_CURRENT, averaged, takenAt);
+}
+
+void readLocalSensors(){ //everything wired straight to the Mega
+    //read RPM
+    getRPM();
+
+    //read torque and thrust if ready, otherwise keeps the old values. DOUT going low means the conversion just finished
+    if(loadCellReady(&thrustSensor)){
+        unsigned long takenAt = micros();
+        rawCounts.thrust = readLoadCellCounts(&thrustSensor);
+        countLoadCellRead(0, takenAt);
+        addReading(CH_THRUST, loadCellUnits(&thrustSensor, &thrustLinearizer, rawCounts.thrust), takenAt);
     }
-    if(torqueSensor.is_ready()){
-        torque = torqueSensor.get_units();
+    if(loadCellReady(&torqueSensor)){
+        unsigned long takenAt = micros();
+        rawCounts.torque = readLoadCellCounts(&torqueSensor);
+        countLoadCellRead(1, takenAt);
+        addReading(CH_TORQUE, loadCellUnits(&torqueSensor, &torqueLinearizer, rawCounts.torque), takenAt);
     }
 
-    //read analog sensors
-    voltage = getVoltage();
-    current = (1-(averageGain/100.0))* current + (averageGain/100.0)*getCurrent(); //moving average
+    //read analog sensors, each average is stamped with the middle of its burst of reads
+    sampleChannel(CH_VOLTAGE, getVoltage);
+    unsigned long currentStart = micros();
+    float reading = getCurrent();
+    addCurrentSample(reading, currentStart + (micros() - currentStart)/2);
+    sampleChannel(CH_AIRSPEED, getAirspeed);
+}
+
+void readSensorNode(){ //turns the packets the tick queued up into channel readings, with the node's timestamps moved onto our clock
+    ReceivedSample sample;
+    while (sensorPackets.pop(sample)){
+        const SamplePacket& packet = sample.packet;
+        if (nodeSequenceValid){
+            uint16_t lost = packet.sequence - lastNodeSequence - 1;
+            droppedNodePackets += lost;
+            health.totals.adcOverruns += lost; //each packet carries one analog average, the node's ADC is the only one that can fall behind
+        }
+        lastNodeSequence = packet.sequence;
+        nodeSequenceValid = true;
+
+        if (packet.flags & SAMPLE_THRUST){
+            addReading(CH_THRUST, loadCellUnits(&thrustSensor, &thrustLinearizer, packet.thrustCounts), nodeToLocal(sample, packet.thrustAt));
+            countLoadCellRead(0, nodeToLocal(sample, packet.thrustAt));
+            nodeThrust = {packet.thrustCounts, true};
+            rawCounts.thrust = packet.thrustCounts;
+        }
+        if (packet.flags & SAMPLE_TORQUE){
+            addReading(CH_TORQUE, loadCellUnits(&torqueSensor, &torqueLinearizer, packet.torqueCounts), nodeToLocal(sample, packet.torqueAt));
+            countLoadCellRead(1, nodeToLocal(sample, packet.torqueAt));
+            nodeTorque = {packet.torqueCounts, true};
+            rawCounts.torque = packet.torqueCounts;
+        }
 
-    //float airspeed
-    airspeed = getAirspeed();
+        unsigned long analogAt = nodeToLocal(sample, packet.analogAt);
+        addReading(CH_VOLTAGE, voltageFromCounts(packet.voltageCounts/16.0), analogAt);
+        addCurrentSample(currentFromCounts(packet.currentCounts/16.0), analogAt);
+        addReading(CH_AIRSPEED, airspeedFromCounts(packet.airspeedCounts/16.0), analogAt);
+        rawCounts.voltage = packet.voltageCounts;
+        rawCounts.current = packet.currentCounts;
+        rawCounts.airspeed = packet.airspeedCounts;
+
+        nodeRpmEdges += packet.rpmEdges;
+        health.totals.rpmEdges += packet.rpmEdges;
+        nodeRpmWindow += packet.rpmWindow;
+        if (nodeRpmWindow >= (unsigned long)rpmUpdateRate*1000){
+            float rpm = (nodeRpmEdges*60000000.0)/(nodeRpmWindow*2.0*pulsesPerRev); //edges are rising and falling, same as getRPM()
+            addReading(CH_RPM, rpm, nodeToLocal(sample, packet.sentAt) - nodeRpmWindow/2);
+            rawCounts.rpmEdges = nodeRpmEdges;
+            rawCounts.rpmWindow = nodeRpmWindow;
+            nodeRpmEdges = 0;
+            nodeRpmWindow = 0;
+        }
+    }
+}
 
-    //time
-    testTime = millis()/1000.0 - testStartTime;
-    
-    //Calculated Variables
+void calculateDerivedValues(){ //powers and efficiencies from the lined up readings
     electricPower = abs(voltage*current); //watts
     mechanicalPower = abs(torque*RPM*0.1047/1000); //RPM is converted to Rad/S, torque is converted to N.m from N.mm
     propellerPower = abs(thrust*airspeed/1000); //
     motorEfficiency = abs(mechanicalPower/electricPower);
     propellerEfficiency = abs(propellerPower/mechanicalPower);
     systemEfficiency = abs(propellerPower/electricPower);
- 
+}
+
+float testSeconds(unsigned long at){ //a micros() instant as seconds into the test, good for as long as millis() is (49 days)
+    unsigned long sinceStart = millis() - testStartMillis;
+    //micros() only says how far at is from the millis() count, that difference is small so the wrap can't touch it
+    int64_t elapsed = (int64_t)sinceStart*1000 + (long)(at - testStartMicros - sinceStart*1000);
+    return elapsed/1000000.0;
+}
+
+void readSensorData(){ //call to update all of the sensor data to match most recently collected values
+
+    if (averageGain > 100 || averageGain < 0) {
+        Serial.println("Avg gain out of bounds");
+        averageGain = 0;
+    }
+
+    if (sensorNodeActive){
+        readSensorNode();
+    } else {
+        readLocalSensors();
+    }
+    adcClaimed = true; //most of them will be analog
+    ExtraSensors::sample(micros()); //wired to the Mega either way
+    adcClaimed = false;
+
+    if (supervisor.armed()){ //each test loop pass reads the sensors once
+        health.loopPass(micros(), HX711_PERIOD_MICROS);
+    }
+
+    //hand the newest readings to the safety supervisor. Current goes in unaveraged so a spike isn't smoothed away
+    SafetySample sample = {channels[CH_THRUST].value, channels[CH_TORQUE].value, rawCurrent, channels[CH_RPM].value};
+    supervisor.publish(sample, millis());
+
+    //line every channel up on the newest instant they've all reached, then work everything out from there
+    sensorsReadAt = micros();
+    unsigned long alignAt = alignmentTime(sensorsReadAt);
+    newSensorRow = (alignAt != lastAlignAt);
+    lastAlignAt = alignAt;
+    thrust = channels[CH_THRUST].valueAt(alignAt);
+    torque = channels[CH_TORQUE].valueAt(alignAt);
+    RPM = channels[CH_RPM].valueAt(alignAt);
+    voltage = channels[CH_VOLTAGE].valueAt(alignAt);
+    current = channels[CH_CURRENT].valueAt(alignAt);
+    airspeed = channels[CH_AIRSPEED].valueAt(alignAt);
+    ExtraSensors::align(alignAt, extraValues);
+    if (dragTareEnabled){
+        thrust -= dragTare.at(airspeed); //the stand's own drag at the same instant, so the display and every log mode get it
+    }
+
+    //time
+    testTime = testSeconds(alignAt);
+
+    calculateDerivedValues();
 }
 
 void pauseScreen(){//call to display the pause screen to prompt the user to either continue testing or end test
@@ -828,7 +1764,7 @@ void promptPlugInMotor(){ //Prompt the user to plug motor back in after prop has
     u8g2.sendBuffer();
 }
 
-void displaySensorData(){//call to display all relevant test data. Needs to be passed current thrust
+void drawSensorData(){ //one frame of the test screen, displaySensorData() decides when to draw one
     u8g2.clearBuffer(); //prepare the screen for writing
     u8g2.setFont(u8g2_font_6x12_tr);
     u8g2.drawStr(2, 9, "Test Running..."); 
@@ -857,146 +1793,789 @@ void displaySensorData(){//call to display all relevant test data. Needs to be p
     u8g2.sendBuffer();   
 }
 
+void displaySensorData(){//call to display all relevant test data. Needs to be passed current thrust
+    static unsigned long lastDisplay = 0;
+    if (millis() - lastDisplay < TEST_DISPLAY_PERIOD){ //nobody can read it faster than this, and the time is better spent sampling
+        return;
+    }
+    lastDisplay = millis();
+    drawSensorData();
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
-//DEBUG MENU
+//DRAG TARE
 
-void debugMenu() {
-    while(true){
-        readSensorData();
+#define DRAG_MEASURE_TIME 3000 //ms of readings averaged at each airspeed
 
-        u8g2.clearBuffer(); //prepare the screen for writing
-        u8g2.setFont(u8g2_font_6x12_tr);
-        u8g2.drawStr(2, 9, "Debug"); 
-        u8g2.drawLine(0, 10, 128, 10); //draw line across bottom
-        u8g2.setFont(u8g2_font_squeezed_r6_tr); //set small font for submenus
-
-        //left bar
-        u8g2.setCursor(1, 19); u8g2.print("RPM Sensor: "); u8g2.print(digitalRead(rpmPin));
-        u8g2.setCursor(1, 26); u8g2.print("THST: "); u8g2.print(thrust/1000); //N
-        u8g2.setCursor(1, 33); u8g2.print("TRQ: "); u8g2.print(torque/1000); //Nm
-        u8g2.setCursor(1, 40); u8g2.print("VLTS: "); u8g2.print(voltage);
-        u8g2.setCursor(1, 47); u8g2.print("AMPS: "); u8g2.print(current); 
-        u8g2.setCursor(1, 54); u8g2.print("ASPD: "); u8g2.print(airspeed); //m/s
-
-        u8g2.drawStr(4, 63, "Back: *");
-        u8g2.sendBuffer();    
-
-        char userInput = customKeypad.getKey();
-        // If a key is pressed, print it to the Serial Monitor
-        if (userInput && userInput == '*') {
-            return;
+void dragNotice(const char* message){ //one line big enough to read from the tunnel
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_16b_tr);
+    u8g2.drawStr(3, 39, message);
+    u8g2.sendBuffer();
+    delay(USER_NOTIF_DELAY);
+}
+
+void measureDrag(float* airspeedOut, float* dragOut){ //averages the lined up airspeed and thrust for DRAG_MEASURE_TIME
+    float airspeedSum = 0;
+    float thrustSum = 0;
+    long rows = 0;
+    unsigned long start = millis();
+    while (millis() - start < DRAG_MEASURE_TIME){
+        readSensorData();
+        if (newSensorRow){
+            airspeedSum += airspeed;
+            thrustSum += thrust;
+            rows++;
         }
     }
+    *airspeedOut = rows ? airspeedSum / rows : 0;
+    *dragOut = rows ? thrustSum / rows : 0;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////
-//SD CARD FUNCTIONS
-bool setUpTest(){//call this function to set up the file with the correct headers. Returns true on a successful setup. Also prompts the user to initiate the test. Begin the test right after a succesful call.
-    esc.writeMicroseconds(MIN_THROTTLE); //set throttle to zero
+void dragTareSweep(){ //walks the user through the tunnel speeds with the motor off and builds the drag table from what the thrust cell reads
+    if (airspeedOverride != 0){ //the table has to be built on measured airspeed
+        dragNotice("A-Spd Override on");
+        return;
+    }
+    if (dragTareStep <= 0 || dragTareMax < dragTareStep){
+        dragNotice("Check Step/Max");
+        return;
+    }
 
-    //ask user for test file
-    valueEditMenu(&testNumber, "Enter Test Number");
+    DragTable previous = dragTare.table(); //put back if the sweep gets canceled
+    dragTare.clear(); //measure what the stand really reads
 
-    // Build filename: Test_Number_X.csv
-    char filename[20];
-    snprintf(filename, sizeof(filename), "Test_%d.csv", (int)testNumber); //the test name needs to be less than 8 characters before the .csv
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_16b_tr);
+    u8g2.drawStr(3, 15, "Motor off,");
+    u8g2.drawStr(3, 27, "tunnel stopped.");
+    u8g2.setFont(u8g2_font_4x6_tr);
+    u8g2.drawStr(3, 44, "Press any key to continue...");
+    u8g2.sendBuffer();
+    pressKeyToContinue();
 
-    // Check if file already exists. If it does, prompt user to overwrite or not
-    if (SD.exists(filename)) {
+    tareLoadCell(&thrustSensor); //zero drag at zero airspeed is the first point
+
+    float airspeeds[DRAG_TARE_POINTS] = {0};
+    float drags[DRAG_TARE_POINTS] = {0};
+    uint8_t pointCount = 1;
+
+    for (long target = dragTareStep; target <= dragTareMax && pointCount < DRAG_TARE_POINTS; target += dragTareStep){
         u8g2.clearBuffer();
-        u8g2.setFont(u8g2_font_t0_14b_tr);
-        u8g2.drawStr(2, 15, "File Name Already");
-        u8g2.drawStr(2, 26, "In Use");
-        u8g2.setFont(u8g2_font_5x7_tr);
-        u8g2.drawStr(3, 55, "Cancel: *");
-        u8g2.drawStr(3, 47, "Overwrite: #");
+        u8g2.setFont(u8g2_font_t0_16b_tr);
+        u8g2.setCursor(3, 15);
+        u8g2.print("Tunnel: "); u8g2.print(target); u8g2.print(" m/s");
+        u8g2.setFont(u8g2_font_4x6_tr);
+        u8g2.drawStr(3, 28, "Measure once the flow settles");
+        u8g2.drawStr(3, 47, "Measure: #");
+        u8g2.drawStr(3, 55, "Finish: *");
         u8g2.sendBuffer();
 
-        while(1){
-            //wait for the user to press a key
-            char userInput = customKeypad.getKey();
-            if (userInput == '#'){
-                SD.remove(filename); //delete the file
-                break; //if user choses to override, exit the loop
-            }
-            if (userInput == '*'){
-                return false; //if user picks cancel, then return false.
-            }
+        char key;
+        while ((key = waitForKey()) != '#' && key != '*'){}
+        if (key == '*'){
+            break;
         }
-    }
-
-    // Create and open file
-    dataFile = SD.open(filename, FILE_WRITE);
-    if (!dataFile) {
-        Serial.println("Failed to create file!");
-        return false;
-    }
 
-    Serial.print("Created file: ");
-    Serial.println(filename);
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_22b_tr);
+        u8g2.drawStr(4, 40, "Measuring...");
+        u8g2.sendBuffer();
 
-    // Write CSV header
-    dataFile.println("Time (s),Current (A),Voltage (V),Torque(N.mm),Thrust(mN),RPM,Airspeed(m/s),Throttle (%),Electrical Power (W),Mechanical Power (W),Propulsive Power (W),Motor Efficiency (%), Propeller Efficiency (%), System Efficiency (%)");
-    dataFile.flush();   // Ensure data is written to the card
+        measureDrag(&airspeeds[pointCount], &drags[pointCount]);
+        Serial.print("Drag point "); Serial.print(pointCount);
+        Serial.print(": "); Serial.print(drags[pointCount]);
+        Serial.print(" at "); Serial.print(airspeeds[pointCount]); Serial.println(" m/s");
+        pointCount++;
+    }
 
-    Serial.println("Header written successfully.");
+    DragTable table;
+    if (!DragTare::build(airspeeds, drags, pointCount, dragTareStep, table)){ //no points, or the tunnel never got going
+        dragTare.begin(previous);
+        dragNotice("Canceled");
+        return;
+    }
+    dragTare.begin(table);
+    saveCalibration();
 
-    //prompt the user to begin the test.
+    //tell user the sweep is over
     u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_t0_14b_tr);
-    u8g2.drawStr(2, 15, "Start Test When");
-    u8g2.drawStr(2, 26, "Ready");
-    u8g2.setFont(u8g2_font_5x7_tr);
-    u8g2.drawStr(3, 55, "Cancel: *");
-    u8g2.drawStr(3, 47, "Start: #");
+    u8g2.setFont(u8g2_font_t0_16b_tr);
+    u8g2.drawStr(22, 13, "Drag Tared");
+
+    u8g2.setFont(u8g2_font_4x6_tr);
+    u8g2.setCursor(3, 24);
+    u8g2.print("Points: "); u8g2.print(pointCount);
+    u8g2.setCursor(3, 31);
+    u8g2.print("Up to: "); u8g2.print((table.count - 1) * table.step); u8g2.print(" m/s");
+    u8g2.setCursor(3, 38);
+    u8g2.print("Drag there: "); u8g2.print(table.drag[table.count - 1]); u8g2.print(" "); u8g2.print(THST_UNITS);
+    u8g2.drawStr(3, 49, "Press any key to continue...");
     u8g2.sendBuffer();
+    pressKeyToContinue();
+}
 
-    while(1){
-        //wait for the user to press a key
-        char userInput = customKeypad.getKey();
-        if (userInput == '#'){
-            break; //if user choses to override, exit the loop
-        }
-        if (userInput == '*'){
-            SD.remove(filename); //delete the file if the user cancels
-            return false; //if user picks cancel, then return false.
-        }
+void clearDragTare(){
+    dragTare.clear();
+    saveCalibration();
+    dragNotice("Table Cleared");
+}
+
+String dragText(){ //step:drag0:drag1:..., 0 if nothing is being taken off the thrust
+    if (!dragTareEnabled || !dragTare.active()){
+        return "0";
+    }
+    const DragTable& table = dragTare.table();
+    String text = String(table.step, 3);
+    for (uint8_t i = 0; i < table.count; i++){
+        text += ':'; text += String(table.drag[i], 1);
+    }
+    return text;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//BOOT REPORT
+
+void beginBootStage(BootStageId stage){
+    bootStages[stage].start = millis();
+}
+
+void endBootStage(BootStageId stage, BootStageStatus status){
+    bootStages[stage].end = millis();
+    bootStages[stage].status = status;
+}
+
+const char* bootStatusLabel(BootStageStatus status){
+    switch (status){
+        case STAGE_OK: return "ok";
+        case STAGE_SKIPPED: return "skip";
+        case STAGE_FAILED: return "FAIL";
+        default: return "...";
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//DEBUG MENU
+
+#define DEBUG_PAGES (ExtraSensors::COUNT ? 4 : 3) //the extra sensors page only shows up if there are any
+
+void drawDebugSensors(){ //page 1, live sensor values
+    readSensorData();
+
+    u8g2.clearBuffer(); //prepare the screen for writing
+    u8g2.setFont(u8g2_font_6x12_tr);
+    u8g2.drawStr(2, 9, "Debug"); 
+    u8g2.drawLine(0, 10, 128, 10); //draw line across bottom
+    u8g2.setFont(u8g2_font_squeezed_r6_tr); //set small font for submenus
+
+    //left bar
+    u8g2.setCursor(1, 19); u8g2.print("RPM Sensor: "); u8g2.print(digitalRead(rpmPin));
+    u8g2.setCursor(1, 26); u8g2.print("THST: "); u8g2.print(thrust/1000); //N
+    u8g2.setCursor(1, 33); u8g2.print("TRQ: "); u8g2.print(torque/1000); //Nm
+    u8g2.setCursor(1, 40); u8g2.print("VLTS: "); u8g2.print(voltage);
+    u8g2.setCursor(1, 47); u8g2.print("AMPS: "); u8g2.print(current); 
+    u8g2.setCursor(1, 54); u8g2.print("ASPD: "); u8g2.print(airspeed); //m/s
+
+    //right bar
+    u8g2.drawStr(66, 19, "HX711 read");
+    u8g2.setCursor(66, 26); u8g2.print("Last: "); u8g2.print(hx711ReadMicros); u8g2.print(" us");
+    u8g2.setCursor(66, 33); u8g2.print("Max: "); u8g2.print(hx711ReadMicrosMax); u8g2.print(" us");
+}
+
+void drawDebugBoot(){ //page 2, how long each boot stage took
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_6x12_tr);
+    u8g2.drawStr(2, 9, "Debug - Boot");
+    u8g2.drawLine(0, 10, 128, 10);
+    u8g2.setFont(u8g2_font_squeezed_r6_tr);
+
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++){
+        u8g2.drawStr(1, 19 + i*7, bootStages[i].label);
+        u8g2.setCursor(56, 19 + i*7);
+        u8g2.print(bootStages[i].start); u8g2.print("+"); u8g2.print(bootStages[i].end - bootStages[i].start); u8g2.print(" ms");
+        u8g2.drawStr(110, 19 + i*7, bootStatusLabel(bootStages[i].status));
+    }
+    u8g2.setCursor(80, 9); u8g2.print("Total "); u8g2.print(bootTime); //ms to the main menu
+}
+
+void drawDebugHealth(){ //page 3, sample rates and everything that's gone missing since boot
+    readSensorData();
+    health.update(millis());
+    const HealthRates& rates = health.rates();
+    const HealthTotals& totals = health.totals;
+
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_6x12_tr);
+    u8g2.drawStr(2, 9, "Debug - Health");
+    u8g2.drawLine(0, 10, 128, 10);
+    u8g2.setFont(u8g2_font_squeezed_r6_tr);
+
+    //left bar, per second and what was lost
+    u8g2.setCursor(1, 19); u8g2.print("THST "); u8g2.print(rates.samples[CH_THRUST], 1); u8g2.print("/s M"); u8g2.print(totals.missedConversions[0]);
+    u8g2.setCursor(1, 26); u8g2.print("TRQ "); u8g2.print(rates.samples[CH_TORQUE], 1); u8g2.print("/s M"); u8g2.print(totals.missedConversions[1]);
+    u8g2.setCursor(1, 33); u8g2.print("ANLG "); u8g2.print(rates.samples[CH_VOLTAGE], 1); u8g2.print("/s O"); u8g2.print(totals.adcOverruns);
+    u8g2.setCursor(1, 40); u8g2.print("RPM "); u8g2.print(rates.rpmEdges, 0); u8g2.print("e/s G"); u8g2.print(totals.rpmGlitches);
+    u8g2.setCursor(1, 47); u8g2.print("SD "); u8g2.print(rates.sdBytes, 0); u8g2.print(" B/s");
+    u8g2.setCursor(1, 54); u8g2.print("SD max "); u8g2.print(health.maxSdWriteMicros/1000.0, 1); u8g2.print(" ms");
+
+    //right bar, test loop passes with the motor running
+    u8g2.drawStr(66, 19, "Test loop");
+    u8g2.setCursor(66, 26); u8g2.print("Passes: "); u8g2.print(totals.loops);
+    u8g2.setCursor(66, 33); u8g2.print("Overrun: "); u8g2.print(totals.loopOverruns);
+    u8g2.setCursor(66, 40); u8g2.print("Max: "); u8g2.print(health.maxLoopMicros/1000.0, 1); u8g2.print(" ms");
+}
+
+void drawDebugExtra(){ //page 4, the registry's channels
+    readSensorData();
+
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_6x12_tr);
+    u8g2.drawStr(2, 9, "Debug - Extra");
+    u8g2.drawLine(0, 10, 128, 10);
+    u8g2.setFont(u8g2_font_squeezed_r6_tr);
+    ExtraSensors::draw(u8g2, 1, 19, 7, extraValues);
+}
+
+void debugMenu() {
+    int page = 0;
+    bool redraw = true;
+    unsigned long lastDraw = 0;
+    while(true){
+        if (redraw || millis() - lastDraw >= DEBUG_REFRESH_PERIOD){
+            if (page == 0){
+                drawDebugSensors();
+            } else if (page == 1){
+                drawDebugBoot();
+            } else if (page == 2){
+                drawDebugHealth();
+            } else {
+                drawDebugExtra();
+            }
+
+            u8g2.drawStr(4, 63, "Back: *");
+            u8g2.drawStr(80, 63, "Page: #");
+            u8g2.sendBuffer();
+            lastDraw = millis();
+            redraw = false;
+        }
+
+        char userInput = readKey();
+        if (userInput == '*') {
+            return;
+        }
+        if (userInput == '#') {
+            page = (page + 1) % DEBUG_PAGES;
+            redraw = true;
+        }
+        if (!userInput) {
+            uiIdle();
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SD CARD FUNCTIONS
+void logNote(const String& text){ //a line in the test file that isn't a row, e.g. a safety trip
+    if (compressedLog()){
+        uint8_t note[LOG_MAX_NOTE + 4];
+        dataFile.write(note, logEncoder.note(text.c_str(), note));
+    } else {
+        dataFile.println(text);
+    }
+}
+
+void indexCheckpoint(){ //held index entries out to the file, so a reset only loses the ones since the last flush
+    if (!logIndexer.pending()){
+        return;
+    }
+    char text[LOG_INDEX_MAX_TEXT + 1];
+    logIndexer.checkpoint(dataFile.position(), text);
+    logNote(text);
+}
+
+void indexMark(uint8_t segment, uint8_t step){ //the rows from here on belong to this segment and step
+    flushHeldRow(); //it belongs to the one before
+    if (compressedLog()){
+        uint8_t end[LOG_MAX_RECORD];
+        dataFile.write(end, logEncoder.finish(end)); //the next row starts a block, so decoding can start right here
+    }
+    logSegment = segment;
+    logStep = step;
+    lastIndexMark = millis();
+    LogIndexEntry entry = {segment, step, (uint32_t)(millis() - testStartMillis), (uint32_t)dataFile.position()};
+    if (logIndexer.add(entry)){
+        indexCheckpoint();
+    }
+}
+
+String fitText(const LinearizationFit& fit){ //c0:c1:c2:countScale:lowCounts:highCounts, countScale 0 means no multi-point curve
+    String text = String(fit.coef[0], 6);
+    text += ':'; text += String(fit.coef[1], 6);
+    text += ':'; text += String(fit.coef[2], 6);
+    text += ':'; text += String(fit.countScale, 3);
+    text += ':'; text += fit.lowCounts;
+    text += ':'; text += fit.highCounts;
+    return text;
+}
+
+void writeRawHeader(){ //every constant between the counts and the units, as they were when the test started
+    String line = "# raw thrust_scale="; line += String(thrustSensor.get_scale(), 6);
+    line += " thrust_offset="; line += thrustSensor.get_offset();
+    line += " thrust_fit="; line += fitText(thrustLinearizer.fitParams());
+    line += " torque_scale="; line += String(torqueSensor.get_scale(), 6);
+    line += " torque_offset="; line += torqueSensor.get_offset();
+    line += " torque_fit="; line += fitText(torqueLinearizer.fitParams());
+    logNote(line);
+
+    line = "# raw analog_divisor="; line += sensorNodeActive ? 16 : (int)averageCount; //what the analog columns are divided by to get ADC counts
+    line += " adc_max=1023 vcc="; line += String(Vcc, 3);
+    line += " voltage_calibration="; line += String(VOLTAGE_CALIBRATION, 3);
+    line += " voltage_offset="; line += String(VOLTAGE_OFFSET, 6);
+    line += " current_sensitivity="; line += String(CURRENT_SENSITIVITY, 6);
+    line += " current_offset="; line += String(CURRENT_OFFSET, 6);
+    line += " average_gain="; line += averageGain;
+    logNote(line);
+
+    line = "# raw zero_voltage="; line += String(zeroVoltage, 6);
+    line += " airspeed_sensitivity="; line += String((float)sensitivity, 3);
+    line += " air_density="; line += String((float)airDensity, 3);
+    line += " airspeed_override="; line += airspeedOverride;
+    line += " pulses_per_rev="; line += pulsesPerRev;
+    line += " drag_tare="; line += dragText(); //step:drag at each step from 0 m/s, taken off thrust like readSensorData() does
+    logNote(line);
+
+    dataFile.println("Time (us),Thrust (counts),Torque (counts),Voltage (ADC),Current (ADC),Airspeed (ADC),RPM Edges,RPM Window (us),Throttle (0.1%),Ripple RPM,RPM Mismatch");
+}
+
+void logHealth(const char* label, const HealthTotals& from, unsigned long millis, bool maxima){ //# health lines, what changed between from and now
+    HealthRates rates;
+    HealthCounters::ratesBetween(from, health.totals, millis, &rates);
+    String line = "# health "; line += label;
+    line += " seconds="; line += String(millis/1000.0, 1);
+    line += " per_s thrust="; line += String(rates.samples[CH_THRUST], 1);
+    line += " torque="; line += String(rates.samples[CH_TORQUE], 1);
+    line += " rpm="; line += String(rates.samples[CH_RPM], 1);
+    line += " voltage="; line += String(rates.samples[CH_VOLTAGE], 1);
+    line += " current="; line += String(rates.samples[CH_CURRENT], 1);
+    line += " airspeed="; line += String(rates.samples[CH_AIRSPEED], 1);
+    line += " rpm_edges="; line += String(rates.rpmEdges, 1);
+    line += " sd_bytes="; line += String(rates.sdBytes, 0);
+    logNote(line);
+
+    line = "# health "; line += label;
+    line += " thrust_missed="; line += health.totals.missedConversions[0] - from.missedConversions[0];
+    line += " torque_missed="; line += health.totals.missedConversions[1] - from.missedConversions[1];
+    line += " rpm_glitches="; line += health.totals.rpmGlitches - from.rpmGlitches;
+    line += " adc_overruns="; line += health.totals.adcOverruns - from.adcOverruns;
+    line += " loops="; line += health.totals.loops - from.loops;
+    line += " loop_overruns="; line += health.totals.loopOverruns - from.loopOverruns;
+    if (maxima){
+        line += " loop_max_us="; line += health.maxLoopMicros;
+        line += " sd_max_write_us="; line += health.maxSdWriteMicros;
+    }
+    logNote(line);
+}
+
+void logBootReport(){ //# health boot line in the test log, ms each boot stage took. A test that looks off might be down to how the stand came up
+    String line = "# health boot ms="; line += bootTime;
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++){
+        line += ' ';
+        for (const char* c = bootStages[i].label; *c; c++){
+            line += (*c == ' ') ? '_' : (char)tolower(*c); //"Load Cells" goes in as load_cells
+        }
+        line += '=';
+        if (bootStages[i].status == STAGE_OK){
+            line += bootStages[i].end - bootStages[i].start;
+        } else {
+            line += bootStatusLabel(bootStages[i].status);
+        }
+    }
+    logNote(line);
+}
+
+void testFileName(char* filename, size_t size){ //Test_N.csv, or .dlg for a compressed log
+    snprintf(filename, size, compressedLog() ? "Test_%d.dlg" : "Test_%d.csv", (int)testNumber); //the test name needs to be less than 8 characters before the .csv
+}
+
+bool setUpTest(){//call this function to set up the file with the correct headers. Returns true on a successful setup. Also prompts the user to initiate the test. Begin the test right after a succesful call.
+    esc.writeMicroseconds(MIN_THROTTLE); //set throttle to zero
+    configureEsc(); //pick up any rate or protocol change from the menu
+
+    //boot carries on without a card, give it one more go in case it's been put in since
+    if (!sdAvailable && !SD.begin(SD_CS_PIN)){
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_14b_tr);
+        u8g2.drawStr(2, 15, "No SD Card");
+        u8g2.setFont(u8g2_font_5x7_tr);
+        u8g2.drawStr(3, 35, "Insert a card to run tests");
+        u8g2.sendBuffer();
+        delay(USER_NOTIF_DELAY);
+        return false;
+    }
+    sdAvailable = true;
+
+    //ask user for test file, a Serial start already picked it
+    if (!scriptedStart){
+        valueEditMenu(&testNumber, "Enter Test Number");
+    }
+
+    char filename[20];
+    testFileName(filename, sizeof(filename));
+
+    // Check if file already exists. If it does, prompt user to overwrite or not
+    if (SD.exists(filename) && scriptedStart) {
+        return false; //the start command checks first, nothing gets overwritten without someone at the stand
+    }
+    if (SD.exists(filename)) {
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_14b_tr);
+        u8g2.drawStr(2, 15, "File Name Already");
+        u8g2.drawStr(2, 26, "In Use");
+        u8g2.setFont(u8g2_font_5x7_tr);
+        u8g2.drawStr(3, 55, "Cancel: *");
+        u8g2.drawStr(3, 47, "Overwrite: #");
+        u8g2.sendBuffer();
+
+        while(1){
+            //wait for the user to press a key
+            char userInput = waitForKey();
+            if (userInput == '#'){
+                SD.remove(filename); //delete the file
+                break; //if user choses to override, exit the loop
+            }
+            if (userInput == '*'){
+                return false; //if user picks cancel, then return false.
+            }
+        }
+    }
+
+    // Create and open file
+    dataFile = SD.open(filename, FILE_WRITE);
+    if (!dataFile) {
+        Serial.println("Failed to create file!");
+        return false;
+    }
+
+    Serial.print("Created file: ");
+    Serial.println(filename);
+
+    // Write the header, the decoder writes the CSV one for compressed logs
+    if (compressedLog()){
+        uint8_t header[LOG_HEADER_SIZE];
+        dataFile.write(header, logEncoder.header(header));
+    }
+    logBootReport();
+    //a second of readings with the motor still off, so the header says what rates the sensors were coming in at
+    //and whether anything was already going missing before the test spun anything up
+    HealthTotals beforeWindow = health.totals;
+    unsigned long windowStart = millis();
+    while (millis() - windowStart < HEALTH_PRETEST_MILLIS){
+        readSensorData();
+        wdt_reset();
+    }
+    logHealth("pretest", beforeWindow, millis() - windowStart, false);
+    if (dragTareEnabled && dragTare.active() && !rawLogging){ //raw logs carry the whole table in their header instead
+        const DragTable& table = dragTare.table();
+        String line = "# drag tare taken off thrust, step_mps="; line += String(table.step, 1);
+        line += " points="; line += table.count;
+        line += " max="; line += String(table.drag[table.count - 1], 1);
+        logNote(line);
+    }
+    if (ExtraSensors::COUNT && (compressedLog() || rawLogging)){ //their layouts are fixed, the extra channels only go in CSV logs
+        String line = "# not logged in this mode:";
+        ExtraSensors::labels(line);
+        logNote(line);
+    }
+    if (rawLogging){
+        writeRawHeader();
+    } else if (adaptiveLogging){ //adaptive logs start with a # line so the reader knows rows were thinned out and by how much
+        String line = "# adaptive log, hold each row until the next. heartbeat_ms="; line += logHeartbeat;
+        line += " thrust_mN="; line += thrustDeadband;
+        line += " torque_Nmm="; line += torqueDeadband;
+        line += " rpm="; line += rpmDeadband;
+        line += " voltage_mV="; line += voltageDeadband;
+        line += " current_mA="; line += currentDeadband;
+        line += " airspeed_cms="; line += airspeedDeadband;
+        logNote(line);
+    }
+    if (!compressedLog() && !rawLogging){
+        dataFile.print("Time (s),Current (A),Voltage (V),Torque(N.mm),Thrust(mN),RPM,Airspeed(m/s),Throttle (%),Electrical Power (W),Mechanical Power (W),Propulsive Power (W),Motor Efficiency (%), Propeller Efficiency (%), System Efficiency (%),Thrust Age (ms),Torque Age (ms),RPM Age (ms),Voltage Age (ms),Current Age (ms),Airspeed Age (ms),Ripple RPM,RPM Mismatch");
+        ExtraSensors::printHeader(dataFile);
+        dataFile.println();
+    }
+    dataFile.flush();   // Ensure data is written to the card
+
+    Serial.println("Header written successfully.");
+
+    //prompt the user to begin the test.
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_14b_tr);
+    u8g2.drawStr(2, 15, "Start Test When");
+    u8g2.drawStr(2, 26, "Ready");
+    u8g2.setFont(u8g2_font_5x7_tr);
+    u8g2.drawStr(3, 55, "Cancel: *");
+    u8g2.drawStr(3, 47, "Start: #");
+    u8g2.sendBuffer();
+
+    while(!scriptedStart){
+        //wait for the user to press a key
+        char userInput = waitForKey();
+        if (userInput == '#'){
+            break; //if user choses to override, exit the loop
+        }
+        if (userInput == '*'){
+            SD.remove(filename); //delete the file if the user cancels
+            return false; //if user picks cancel, then return false.
+        }
     }
     resetSensorData(); //this line makes sure that if a sensor is missing, it shows as zero and not the value of the last test
+    efficiencyMap.begin(mapAxisSetting == MAP_RPM ? MAP_RPM : MAP_AIRSPEED, mapAxisSetting == MAP_RPM ? mapRpmBin : mapAirspeedBin);
+    float deadbands[] = {(float)thrustDeadband, (float)torqueDeadband, (float)rpmDeadband, voltageDeadband/1000.0f, currentDeadband/1000.0f, airspeedDeadband/100.0f, 0}; //throttle last, any change counts
+    deadbandLogger.begin(deadbands, sizeof(deadbands)/sizeof(deadbands[0]), logHeartbeat);
+    rowHeld = false;
+    testCancelled = false;
+    vibrationCaptured = false;
+    logIndexer.begin();
+    logSegment = 0;
+    logStep = 0;
+    lastIndexMark = millis();
+    healthAtTestStart = health.totals;
+    healthTestStart = millis();
+    health.clearMaxima();
+    lastRippleCheck = millis();
+    rippleChecks = 0;
+    rippleMismatches = 0;
+    rippleWeak = 0;
+    rippleRpm = 0;
+    rippleMismatch = false;
+    staleChannelsLogged = 0;
     return true; //true means it was successful
 }
 
-void writeSensorSD(){
-
+void writeCsvRow(const LogRow& row){
     // Write one CSV row (Method 2: print-based)
 
-    dataFile.print(testTime, 3);            dataFile.print(','); // float
-    dataFile.print(current, 3);             dataFile.print(','); // float
-    dataFile.print(voltage, 3);             dataFile.print(','); // float
-    dataFile.print(torque, 3);              dataFile.print(','); // float
-    dataFile.print(thrust, 3);              dataFile.print(','); // float
-    dataFile.print(RPM, 1);                    dataFile.print(','); // int
-    dataFile.print(airspeed, 3);            dataFile.print(','); // float
-    dataFile.print(throttle, 1);            dataFile.print(','); // float
-    dataFile.print(electricPower, 3);       dataFile.print(','); // float
-    dataFile.print(mechanicalPower, 3);     dataFile.print(','); // float
-    dataFile.print(propellerPower, 3);      dataFile.print(','); // float
-    dataFile.print(motorEfficiency, 3);     dataFile.print(','); // float
-    dataFile.print(propellerEfficiency, 3); dataFile.print(','); // float
-    dataFile.print(systemEfficiency, 3);    dataFile.println();  // float + newline
-
-    //don't flush all the time
+    dataFile.print(row.time, 3);                dataFile.print(','); // float
+    dataFile.print(row.current, 3);             dataFile.print(','); // float
+    dataFile.print(row.voltage, 3);             dataFile.print(','); // float
+    dataFile.print(row.torque, 3);              dataFile.print(','); // float
+    dataFile.print(row.thrust, 3);              dataFile.print(','); // float
+    dataFile.print(row.rpm, 1);                    dataFile.print(','); // int
+    dataFile.print(row.airspeed, 3);            dataFile.print(','); // float
+    dataFile.print(row.throttle, 1);            dataFile.print(','); // float
+    dataFile.print(row.electricPower, 3);       dataFile.print(','); // float
+    dataFile.print(row.mechanicalPower, 3);     dataFile.print(','); // float
+    dataFile.print(row.propellerPower, 3);      dataFile.print(','); // float
+    dataFile.print(row.motorEfficiency, 3);     dataFile.print(','); // float
+    dataFile.print(row.propellerEfficiency, 3); dataFile.print(','); // float
+    dataFile.print(row.systemEfficiency, 3);    dataFile.print(','); // float
+
+    //how old each channel's newest reading was when the row was put together, bounds the time skew between columns
+    for (int i = 0; i < CHANNEL_COUNT; i++){
+        dataFile.print(row.ages[i], 1);
+        dataFile.print(',');
+    }
+    dataFile.print(row.rippleRpm, 0);           dataFile.print(','); // 0 with the RPM check off or a weak burst
+    dataFile.print(row.rippleMismatch ? 1 : 0);
+    ExtraSensors::printValues(dataFile, row.extra);
+    dataFile.println();
+}
+
+void flushIfDue(){ //don't flush all the time
     if ((millis()-lastFlush) > flushPeriodMillis){
+        indexCheckpoint();
         dataFile.flush();
         lastFlush = millis();
         Serial.println("Flushed Data");
     } else {
         Serial.println("Didn't flush");
     }
+}
+
+void writeLogRow(const LogRow& row){
+    if (compressedLog()){ //the derived columns and ages are left out, the decoder works the derived ones out again
+        float values[LOG_CHANNELS] = {row.time, row.current, row.voltage, row.torque, row.thrust, row.rpm, row.airspeed, row.throttle};
+        uint8_t record[LOG_MAX_RECORD];
+        dataFile.write(record, logEncoder.encode(values, record));
+    } else {
+        writeCsvRow(row);
+    }
+    flushIfDue();
+}
+
+void writeRawRow(){ //integers only, no float formatting. Throttle is what the stand set, not a reading
+    dataFile.print(sensorsReadAt - testStartMicros); dataFile.print(',');
+    dataFile.print(rawCounts.thrust);                dataFile.print(',');
+    dataFile.print(rawCounts.torque);                dataFile.print(',');
+    dataFile.print(rawCounts.voltage);               dataFile.print(',');
+    dataFile.print(rawCounts.current);               dataFile.print(',');
+    dataFile.print(rawCounts.airspeed);              dataFile.print(',');
+    dataFile.print(rawCounts.rpmEdges);              dataFile.print(',');
+    dataFile.print(rawCounts.rpmWindow);             dataFile.print(',');
+    dataFile.print((int)(throttle*10 + 0.5));        dataFile.print(',');
+    dataFile.print((long)(rippleRpm + 0.5));         dataFile.print(',');
+    dataFile.println(rippleMismatch ? 1 : 0);
+    flushIfDue();
+}
+
+void writeSensorRow(){
+    if (millis() - lastIndexMark >= LOG_INDEX_PERIOD){ //a long step or segment still gets an entry now and then
+        indexMark(logSegment, logStep);
+    }
+    efficiencyMap.add(throttle, mapAxisSetting == MAP_RPM ? RPM : airspeed, motorEfficiency, propellerEfficiency, systemEfficiency);
+
+    if (rawLogging){
+        writeRawRow();
+        return;
+    }
+
+    LogRow row = {testTime, current, voltage, torque, thrust, RPM, airspeed, throttle, electricPower, mechanicalPower,
+        propellerPower, motorEfficiency, propellerEfficiency, systemEfficiency, {}, rippleRpm, rippleMismatch, {}};
+    for (int i = 0; i < CHANNEL_COUNT; i++){
+        row.ages[i] = channels[i].ageAt(sensorsReadAt)/1000.0;
+    }
+    for (int i = 0; i < ExtraSensors::COUNT; i++){
+        row.extra[i] = extraValues[i];
+    }
+
+    if (!adaptiveLogging){
+        writeLogRow(row);
+        return;
+    }
+
+    float values[] = {thrust, torque, RPM, voltage, current, airspeed, throttle}; //same order as the deadbands in setUpTest()
+    LogDecision decision = deadbandLogger.decide(values, millis());
+    if (decision == LOG_SKIP){
+        heldRow = row;
+        rowHeld = true;
+        return;
+    }
+    if (decision == LOG_CHANGE && rowHeld){ //the last row before the change, so holding values doesn't stretch the steady part into the transient
+        writeLogRow(heldRow);
+    }
+    rowHeld = false;
+    writeLogRow(row);
     return;
 }
 
+void writeSensorSD(){
+    if (!newSensorRow){ //same instant as the last row, the load cells haven't converted since
+        return;
+    }
+    newSensorRow = false;
+    if (staleChannels != staleChannelsLogged){ //a channel went quiet or came back, the rows carry on either way
+        for (int i = 0; i < CHANNEL_COUNT; i++){
+            uint8_t bit = 1 << i;
+            if ((staleChannels ^ staleChannelsLogged) & bit){
+                String line = (staleChannels & bit) ? "# stale channel=" : "# recovered channel=";
+                line += channelNames[i];
+                line += " time="; line += String(testTime, 3);
+                line += " age_ms="; line += (long)(channels[i].ageAt(sensorsReadAt)/1000);
+                logNote(line);
+            }
+        }
+        staleChannelsLogged = staleChannels;
+    }
+    unsigned long start = micros();
+    uint32_t startPosition = dataFile.position();
+    writeSensorRow();
+    health.sdWrite(dataFile.position() - startPosition, micros() - start); //flushes included, they're the slow part
+    rippleRpmCheck(); //right after a row, so its note sits next to the RPM it was checked against
+}
+
+void flushHeldRow(){ //end of test, the last skipped row marks where the data stops
+    if (rowHeld){
+        writeLogRow(heldRow);
+        rowHeld = false;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//RPM CHECK
+
+float captureRipple(){ //a burst of fast current readings into vibSpectrum's buffer, returns the rate they came in at
+    int32_t* samples = vibSpectrum.samples();
+    //nothing goes through readSensorData() meanwhile, so the supervisor gets the last readings again like in captureVibration().
+    //The current is the one thing this does read, so that part of it stays fresh
+    SafetySample held = {channels[CH_THRUST].value, channels[CH_TORQUE].value, rawCurrent, channels[CH_RPM].value};
+    long reads = constrain(RIPPLE_FAST_RATE / constrain(rippleSampleRate, 1, RIPPLE_FAST_RATE), 1, 16); //summed into each sample, which also smooths some PWM away
+
+    //back to back reads come in evenly, pacing them off micros() would jitter by its 4us steps
+    adcClaimed = true; //the tick's current read would come out at the wrong ADC clock too
+    uint8_t adcClock = ADCSRA;
+    ADCSRA = (adcClock & ~0x07) | RIPPLE_ADC_PRESCALE;
+    unsigned long start = micros();
+    for (int i = 0; i < VIB_FFT_SIZE; i++){
+        int32_t sum = 0;
+        for (long r = 0; r < reads; r++){
+            sum += analogRead(CURRENT_PIN);
+        }
+        samples[i] = sum;
+        if ((i & 63) == 0){
+            wdt_reset();
+            held.current = currentFromCounts(sum / (float)reads);
+            supervisor.publish(held, millis());
+        }
+    }
+    unsigned long took = micros() - start;
+    ADCSRA = adcClock;
+    adcClaimed = false;
+    health.resume(); //the burst held the loop up on purpose
+    return took ? VIB_FFT_SIZE * 1000000.0 / took : 0;
+}
+
+RippleEstimate estimateRipple(float sampleHz){ //from the burst captureRipple() left in vibSpectrum
+    float topRpm = maxRpmLimit > 0 ? maxRpmLimit * 1.25 : RIPPLE_MAX_RPM; //some room past the limit, a trip is coming anyway
+    return RippleRpm::estimate(vibSpectrum, sampleHz, constrain(motorPoles, 2, 254), RIPPLE_MIN_RPM, topRpm);
+}
+
+void rippleRpmCheck(){ //every rippleCheckPeriod with the motor driven, one burst and a # rpm check line next to the rows
+    if (!rippleCheck || vibrationCaptured || !supervisor.armed() || throttle < RIPPLE_MIN_THROTTLE){
+        return; //a vibration burst waiting to be written shares the buffer
+    }
+    //the optical RPM is counted over rpmUpdateRate and the burst takes a few ms, on a ramp they'd be
+    //different speeds. Only checked once the whole optical window is at the one throttle
+    if (fabs(throttle - rippleThrottle) > 0.5){
+        rippleThrottle = throttle;
+        rippleThrottleSince = millis();
+    }
+    if (millis() - rippleThrottleSince < (unsigned long)rpmUpdateRate + RIPPLE_SETTLE_TIME){
+        return;
+    }
+    if (millis() - lastRippleCheck < (unsigned long)rippleCheckPeriod){
+        return;
+    }
+    float opticalRpm = RPM; //lined up with the row that was just written
+    RippleEstimate estimate = estimateRipple(captureRipple());
+    lastRippleCheck = millis();
+
+    float apart = RippleRpm::disagreement(estimate.rpm, opticalRpm);
+    const char* verdict = "ok";
+    rippleChecks++;
+    rippleRpm = estimate.rpm; //shows up in the rows from the next one on
+    rippleMismatch = estimate.rpm != 0 && apart > rippleTolerance;
+    if (estimate.rpm == 0){
+        verdict = "weak";
+        rippleWeak++;
+    } else if (apart > rippleTolerance){
+        verdict = "MISMATCH";
+        rippleMismatches++;
+        Serial.print("RPM check mismatch, ripple "); Serial.print(estimate.rpm, 0);
+        Serial.print(" optical "); Serial.println(opticalRpm, 0);
+    }
+
+    String line = "# rpm check time="; line += String(testTime, 3);
+    line += " ripple="; line += String(estimate.rpm, 0);
+    line += " optical="; line += String(opticalRpm, 0);
+    line += " apart_pct="; line += String(apart, 1);
+    line += " prominence="; line += String(estimate.prominence, 1);
+    line += ' '; line += verdict;
+    logNote(line);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 //TEST FUNCTIONS
 
@@ -1009,34 +2588,29 @@ void selectProfile(){
     u8g2.drawStr(17, 12, "Select Test Profile");
 
     u8g2.setFont(u8g2_font_5x7_tr);
-    u8g2.drawStr(1, 26, "1 - Smooth Ramp Up");
+    u8g2.drawStr(1, 24, "1 - Smooth Ramp Up");
 
-    u8g2.drawStr(2, 37, "2 - Intervals Ramp Up");
+    u8g2.drawStr(2, 33, "2 - Intervals Ramp Up");
 
-    u8g2.drawStr(2, 48, "3 - Motor Profile Testing");
+    u8g2.drawStr(2, 42, "3 - Motor Profile Testing");
 
     u8g2.drawLine(0, 14, 127, 14);
 
-    u8g2.drawStr(2, 59, "4 - Battery Load Testing");
+    u8g2.drawStr(2, 51, "4 - Battery Load Testing");
+
+    u8g2.drawStr(2, 60, "5 - Vibration Scan");
 
     u8g2.sendBuffer();
 
     while(1){
-        char userInput = customKeypad.getKey();
-        if(userInput){
-            Serial.println(userInput);
-            if(userInput == '1'){ //Smooth ramp 
-                testType = 1;
-            }
-            else if(userInput == '2'){ //Intervals
-                testType = 2;
-            }
-            else if(userInput == '3'){ //motor testing
-                testType = 3;
-            }   
-            else if(userInput == '4'){ //battery testing
-                testType = 4;
-            }
+        char userInput = waitForKey();
+        Serial.println(userInput);
+        if(userInput >= '1' && userInput <= '5'){ //1 smooth ramp, 2 intervals, 3 motor testing, 4 battery testing, 5 vibration scan
+            testType = userInput - '0';
+            return;
+        }
+        else if(userInput == '*'){ //back out without changing anything
+            return;
         }
     }
 }
@@ -1048,30 +2622,223 @@ void setThrottle(float throttleSetting){ //pass this a throttle from 0-100 and i
     if (throttleSetting > 100 || throttleSetting < 0){ //if the throttle is out of bounds, set it to 0
         throttleMicroseconds = MIN_THROTTLE;
     }
+    if (supervisor.tripped()){ //the supervisor already cut the ESC, don't let the test loop spin it back up
+        throttleMicroseconds = MIN_THROTTLE;
+    }
     
     esc.writeMicroseconds(throttleMicroseconds);
     Serial.print("Throttle Microseconds: "); Serial.println(throttleMicroseconds);
 }
 
-//This helper method does the motor control and ramps up the motor smoothly in intervals, pausing at each interval. 
-void smoothRamp(){
-    //initialize the test variables
-    bool testRunning = true;
-    throttle = 0.0;
-    long startTime = millis(); //this is for keeping track of what throttle level to set
-    long time = startTime;
-    testStartTime = millis()/1000; //this is for recording time to the SD card in seconds
-
-    while(testRunning){
-        wdt_reset(); //pet that dawg! (cause you're keeping the watchdog from going off by resetting every loop)
-        time = millis() - startTime;
+void armSupervisor(){ //loads the limits from the menu values and starts checking them
+    SafetyLimits limits = {(float)maxThrustLimit, (float)maxTorqueLimit, (float)maxCurrentLimit, (float)maxRpmLimit, (uint16_t)constrain(staleDataLimit, 0, 60000)};
+    supervisor.setLimits(limits);
+    supervisor.arm(millis());
+    health.resume(); //the prompts before this aren't loop overruns
+}
 
-        //throttle mapping
-        if (time < rampTime*1000){ //if time is in initial ramp up period
-            Serial.println(time/1000);
-            throttle = testThrottleMax*((float)time/(float)(rampTime))/1000; //cast to float to ensure SMOOOOOOOTH throttle
+//tick side, so check() has something newer than the last round while the main loop is held up on the screen or the card
+void safetyFromPacket(const SamplePacket& packet){ //a sensor node packet as soon as it's in
+    if (!supervisor.armed()){
+        return; //calibrations and tares change the scales between tests
+    }
+    SafetySample reading = {0, 0, currentFromCounts(packet.currentCounts/16.0), 0};
+    uint8_t fields = SAFETY_CURRENT;
+    if (packet.flags & SAMPLE_THRUST){
+        reading.thrust = loadCellUnits(&thrustSensor, &thrustLinearizer, packet.thrustCounts);
+        fields |= SAFETY_THRUST;
+    }
+    if (packet.flags & SAMPLE_TORQUE){
+        reading.torque = loadCellUnits(&torqueSensor, &torqueLinearizer, packet.torqueCounts);
+        fields |= SAFETY_TORQUE;
+    }
+    supervisor.update(reading, fields); //RPM needs a longer window than one packet, it stays with the main loop
+}
 
-        } else if ((time >= rampTime*1000) & (time < (rampTime + topTime)*1000)){ //if time is at the top
+void safetyCurrentRead(){ //one current reading off the local ADC, unless the main loop is using it
+    if (!supervisor.armed() || sensorNodeActive || adcClaimed){
+        return;
+    }
+    SafetySample reading = {0, 0, currentFromCounts(analogRead(CURRENT_PIN)), 0};
+    supervisor.update(reading, SAFETY_CURRENT);
+}
+
+void reportSafetyTrip(){ //logs why the supervisor cut the test, to the test file, Serial and the screen
+    SafetyTrip trip = supervisor.lastTrip();
+    const char* cause = SafetySupervisor::causeLabel(trip.cause);
+    float tripTime = (long)(trip.at - testStartMillis)/1000.0;
+
+    //one last line after the data so the file says why it ends early
+    String line = "SAFETY TRIP,"; line += cause; line += ',';
+    line += String(trip.value, 3); line += ','; line += String(trip.limit, 3); line += ',';
+    line += String(tripTime, 3);
+    logNote(line);
+
+    Serial.print("SAFETY TRIP: "); Serial.print(cause);
+    Serial.print(" "); Serial.print(trip.value); Serial.print(" (limit "); Serial.print(trip.limit);
+    Serial.print(") at "); Serial.print(tripTime, 3); Serial.println(" s");
+
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_14b_tr);
+    u8g2.drawStr(2, 15, "SAFETY TRIP");
+    u8g2.setFont(u8g2_font_5x7_tr);
+    u8g2.drawStr(3, 28, cause);
+    u8g2.setCursor(3, 38); u8g2.print("Read "); u8g2.print(trip.value); u8g2.print(" Limit "); u8g2.print(trip.limit);
+    u8g2.setCursor(3, 48); u8g2.print("At "); u8g2.print(tripTime, 2); u8g2.print(" s");
+    u8g2.drawStr(3, 60, "Press any key to continue...");
+    u8g2.sendBuffer();
+    pressKeyToContinue();
+}
+
+void writeEfficiencyMap(){ //Map_N.csv goes next to Test_N.csv, a few hundred bytes instead of every row
+    if (efficiencyMap.samples() == 0){
+        return;
+    }
+    char filename[20];
+    snprintf(filename, sizeof(filename), "Map_%d.csv", (int)testNumber);
+    if (SD.exists(filename)){
+        SD.remove(filename); //the test file was already cleared for overwriting, the map goes with it
+    }
+    File mapFile = SD.open(filename, FILE_WRITE);
+    if (!mapFile){
+        Serial.println("Failed to create map file!");
+        return;
+    }
+    efficiencyMap.write(mapFile);
+    mapFile.close();
+    Serial.print("Wrote efficiency map: "); Serial.println(filename);
+}
+
+float vibrationUnitsPerCount(){ //g, mN or N.mm per raw count
+    if (vibSource == VIB_THRUST){
+        return 1.0 / thrustSensor.get_scale(); //the slope is all that matters for a wobble, no need for the multi-point table
+    }
+    if (vibSource == VIB_TORQUE){
+        return 1.0 / torqueSensor.get_scale();
+    }
+    return Vcc / 1023.0 / ACCEL_VOLTS_PER_G;
+}
+
+const char* vibrationUnits(){
+    return vibSource == VIB_THRUST ? "mN" : vibSource == VIB_TORQUE ? "N.mm" : "g";
+}
+
+void vibrationPeak(int harmonic, float* hz, float* amplitude){ //biggest peak near harmonic x the shaft speed, 0s if that's past half the sample rate
+    float binHz = vibSampleHz / VIB_FFT_SIZE;
+    float expected = vibRpm / 60.0 * harmonic / binHz;
+    if (binHz <= 0 || expected < 1 || expected > VIB_BINS - 1 - VIB_PEAK_SEARCH_BINS){
+        *hz = 0;
+        *amplitude = 0;
+        return;
+    }
+    uint16_t bin = vibSpectrum.peakBin(expected, VIB_PEAK_SEARCH_BINS);
+    *hz = bin * binHz;
+    *amplitude = vibSpectrum.amplitude(bin) * vibrationUnitsPerCount();
+}
+
+void writeVibrationSpectrum(){ //Vib_N.csv goes next to Test_N.csv, the 1x/2x peaks and then every bin up to half the sample rate
+    if (!vibrationCaptured){
+        return;
+    }
+    vibrationCaptured = false;
+    char filename[20];
+    snprintf(filename, sizeof(filename), "Vib_%d.csv", (int)testNumber);
+    if (SD.exists(filename)){
+        SD.remove(filename); //same as the map, it goes with the test file it sits next to
+    }
+    File spectrumFile = SD.open(filename, FILE_WRITE);
+    if (!spectrumFile){
+        Serial.println("Failed to create spectrum file!");
+        return;
+    }
+
+    const char* sources[] = {"accelerometer", "thrust", "torque"};
+    spectrumFile.print("# source="); spectrumFile.print(sources[vibSource]);
+    spectrumFile.print(" sample_hz="); spectrumFile.print(vibSampleHz, 1);
+    spectrumFile.print(" samples="); spectrumFile.print(VIB_FFT_SIZE);
+    spectrumFile.print(" throttle="); spectrumFile.print(vibThrottle);
+    spectrumFile.print(" rpm="); spectrumFile.println(vibRpm, 0);
+    for (int harmonic = 1; harmonic <= 2; harmonic++){
+        float hz, amplitude;
+        vibrationPeak(harmonic, &hz, &amplitude);
+        spectrumFile.print("# peak_"); spectrumFile.print(harmonic); spectrumFile.print("x_hz="); spectrumFile.print(hz, 2);
+        spectrumFile.print(" amplitude="); spectrumFile.println(amplitude, 4);
+    }
+    spectrumFile.print("Frequency (Hz),Amplitude ("); spectrumFile.print(vibrationUnits()); spectrumFile.println(")");
+
+    float binHz = vibSampleHz / VIB_FFT_SIZE;
+    float unitsPerCount = vibrationUnitsPerCount();
+    for (uint16_t k = 1; k < VIB_BINS; k++){ //DC went with the mean
+        spectrumFile.print(k * binHz, 2); spectrumFile.print(',');
+        spectrumFile.println(vibSpectrum.binAmplitude(k) * unitsPerCount, 4);
+    }
+    spectrumFile.close();
+    Serial.print("Wrote vibration spectrum: "); Serial.println(filename);
+}
+
+bool stopRequested(){ //any key or a safety trip ends a test. A key is remembered so a campaign knows someone stopped it
+    if (readKey()){
+        testCancelled = true;
+    }
+    return testCancelled || supervisor.tripped();
+}
+
+void finishTest(){ //motor off and file closed, shared by every test profile
+    throttle = 0;
+    setThrottle(0);
+    supervisor.disarm();
+    wdt_disable(); //turn off the watch dog, the trip screen waits on the user
+    flushHeldRow();
+    if (compressedLog()){
+        uint8_t end[LOG_MAX_RECORD];
+        dataFile.write(end, logEncoder.finish(end)); //closes the last block so its CRC can be checked
+    }
+
+    if (supervisor.tripped()){
+        reportSafetyTrip();
+    }
+    logHealth("test", healthAtTestStart, millis() - healthTestStart, true);
+    if (rippleChecks){
+        String line = "# rpm check bursts="; line += rippleChecks;
+        line += " mismatches="; line += rippleMismatches;
+        line += " weak="; line += rippleWeak;
+        line += " poles="; line += motorPoles;
+        line += " tolerance_pct="; line += rippleTolerance;
+        logNote(line);
+    }
+
+    indexCheckpoint();
+    char trailer[LOG_INDEX_TRAILER_TEXT + 1];
+    if (logIndexer.trailer(trailer)){
+        logNote(trailer); //has to be the last thing in the file, readers find it from the end
+    }
+    dataFile.close();
+    writeEfficiencyMap();
+    writeVibrationSpectrum();
+    testNumber++;
+}
+
+//This helper method does the motor control and ramps up the motor smoothly in intervals, pausing at each interval. 
+void smoothRamp(){
+    //initialize the test variables
+    bool testRunning = true;
+    throttle = 0.0;
+    long startTime = millis(); //this is for keeping track of what throttle level to set
+    long time = startTime;
+    testStartMicros = micros(); //this is for recording time to the SD card
+    testStartMillis = millis();
+    indexMark(logSegment + 1, 0); //one segment per call, the piecewise test makes several
+
+    while(testRunning){
+        wdt_reset(); //pet that dawg! (cause you're keeping the watchdog from going off by resetting every loop)
+        time = millis() - startTime;
+
+        //throttle mapping
+        if (time < rampTime*1000){ //if time is in initial ramp up period
+            Serial.println(time/1000);
+            throttle = testThrottleMax*((float)time/(float)(rampTime))/1000; //cast to float to ensure SMOOOOOOOTH throttle
+
+        } else if ((time >= rampTime*1000) & (time < (rampTime + topTime)*1000)){ //if time is at the top
             throttle = (float)testThrottleMax;
 
         } else if (time >= (rampTime + topTime)*1000){ //if time is past the top
@@ -1092,9 +2859,8 @@ void smoothRamp(){
 
         setThrottle(throttle);
 
-        //check for any user input, cancel test if they pressed anything
-        char userInput = customKeypad.getKey();
-        if (userInput){
+        //check for any user input, cancel test if they pressed anything or a safety limit tripped
+        if (stopRequested()){
             throttle = 0;
             setThrottle(0);
             testRunning = false;
@@ -1109,199 +2875,946 @@ void runPiecewiseTest(){
         return;
     }
 
-    wdt_enable(WDTO_2S);
-    wdt_reset();
+    wdt_enable(WDTO_2S);
+    wdt_reset();
+
+    resetSensorData();
+
+    bool testRunning = true;
+    while(testRunning){
+        armSupervisor();
+        smoothRamp(); //TODO: CHANGE TO INTERVAL RAMP PROFILE AFTER MERGING
+        if (supervisor.tripped()){
+            break; //finishTest() reports it
+        }
+
+        throttle = 0;
+        setThrottle(0);
+        supervisor.disarm(); //motor is off and nothing gets read while the prompts are up
+        wdt_disable();
+
+        pauseScreen(); 
+        while(testRunning){ //prompt user to continue/end test
+            char userInput = waitForKey();
+            if(userInput){
+                Serial.println(userInput);
+                if(userInput == '*'){ //continue test
+                    break;
+                }
+                else if(userInput == '#'){ //end test
+                    testRunning = false; //break out of the main testing loop 
+                    break;
+                }
+            }
+        }
+
+        promptPropSwap();
+        while(testRunning){ //prompt user to unplug motor, swap props, and continue/end test
+            char userInput = waitForKey();
+            if(userInput){
+                Serial.println(userInput);
+                if(userInput == '*'){ //continue test
+                    break;
+                }
+                else if(userInput == '#'){ //end test
+                    testRunning = false; //break out of the main testing loop 
+                    break;
+                }
+            }
+        }
+
+        promptPlugInMotor();
+        while(testRunning){ //prompt user to plug in motor and continue/end test
+            char userInput = waitForKey();
+            if(userInput){
+                Serial.println(userInput);
+                if(userInput == '*'){ //continue test
+                    break;
+                }
+                else if(userInput == '#'){ //end test
+                    testRunning = false; //break out of the main testing loop 
+                    break;
+                }
+            }
+        }
+    }
+
+    finishTest();
+}
+
+void runSmoothRampTest(){ //give time in millis since starting the test, returns a struct containing info about throttle settings and whether to record data
+    esc.writeMicroseconds(MIN_THROTTLE);
+
+    if(!setUpTest()){
+        return;
+    }
+
+    wdt_enable(WDTO_2S); //this is the watchdog timer. If it goes 2s without wdt_reset being called, the board will do a hardware reset.
+    wdt_reset();
+
+    resetSensorData(); //this line makes sure that if a sensor is missing, it shows as zero and not the value of the last test
+    armSupervisor();
+    
+    smoothRamp();  //start up the motor and do the thing
+
+    finishTest();
+}
+
+void runSteppedRampTest(){
+    if(!setUpTest()){
+        return;
+    }
+
+    wdt_enable(WDTO_2S); //this is the watchdog timer. If it goes 2s without wdt_reset being called, the board will do a hardware reset.
+    wdt_reset();
+    armSupervisor();
+    
+    //initialize the test variables
+    bool testRunning = true;
+    throttle = 0.0;
+    float throttleStep = testThrottleMax/(float)intervalCount;
+
+    for (int i = 1; i <= intervalCount; i++) {
+
+        float targetThrottle = i*throttleStep;
+
+        //slew throttle to next throttle setting by advancing at a maximum speed of 20% per second
+        while (testRunning && throttle <= targetThrottle-1){
+            throttle = throttle+1;
+            setThrottle(throttle);
+
+            readSensorData();
+            displaySensorData();
+
+            //check for any user input, cancel test if they pressed anything or a safety limit tripped
+            if (stopRequested()){
+                throttle = 0;
+                setThrottle(0);
+                testRunning = false;
+                break; //exit the while loop
+            }
+
+            wdt_reset(); //pet the dogS
+            delay(50);
+        }
+
+        throttle = targetThrottle;
+        setThrottle(throttle); //snug up the throttle to the exact float percentage required
+
+        unsigned long rampStopTime = millis();
+        while (millis() < rampStopTime + (unsigned long)rampSettleTime) { //wait one second for the propulsion system to reach equilibrium
+            readSensorData();
+            displaySensorData();
+            if (stopRequested()){
+                throttle = 0;
+                setThrottle(0);
+                testRunning = false;
+                break; //exit the while loop
+            }
+            Serial.println("Allowing settle time");
+            wdt_reset();
+        }
+
+        wdt_reset();
+        //record data at that throttle setting once the throttle is in the right spot
+        indexMark(1, i);
+        unsigned long stepStartTime = millis();
+        while(testRunning && millis() - stepStartTime <= (unsigned long)intervalTime * 1000){ 
+            wdt_reset();
+
+            readSensorData();
+            displaySensorData();
+            writeSensorSD();
+
+            //check for any user input, cancel test if they pressed anything or a safety limit tripped
+            if (stopRequested()){
+                throttle = 0;
+                setThrottle(0);
+                testRunning = false;
+                break; //exit the while loop
+            }
+        }
+        //once the step is complete, resets to top of for loop and repeats the process.
+
+        if (!testRunning){ //if the user cancels and breaks out of the while loop, break them out of the for loop too
+            break;
+        }
+    }
+
+    //end the test once all steps have been done
+    finishTest();
+}
+
+void runBatteryTest(){
+
+}
+
+bool vibrationLeg(float from, float to, unsigned long duration){ //moves the throttle between two settings over duration ms, logging like any test. False if it was stopped
+    unsigned long start = millis();
+    for (unsigned long time = 0; time < duration; time = millis() - start){
+        wdt_reset();
+        throttle = from + (to - from) * ((float)time / duration);
+
+        readSensorData();
+        displaySensorData();
+        writeSensorSD();
+
+        setThrottle(throttle);
+
+        //check for any user input, cancel test if they pressed anything or a safety limit tripped
+        if (stopRequested()){
+            throttle = 0;
+            setThrottle(0);
+            return false;
+        }
+    }
+    throttle = to;
+    setThrottle(throttle);
+    return true;
+}
+
+bool captureVibration(){ //fills the spectrum's buffer, false if a key or the supervisor stopped it. Nothing gets logged while it runs
+    int32_t* samples = vibSpectrum.samples();
+    //the burst doesn't go through readSensorData(), so the supervisor gets the last readings again to keep the stale data check happy
+    SafetySample held = {channels[CH_THRUST].value, channels[CH_TORQUE].value, rawCurrent, channels[CH_RPM].value};
+
+    if (vibSource == VIB_ACCEL){
+        unsigned long period = 1000000UL / constrain(vibSampleRate, VIB_MIN_RATE, VIB_MAX_RATE);
+        unsigned long start = micros();
+        for (int i = 0; i < VIB_FFT_SIZE; i++){
+            long early = (long)(i * period) - (long)(micros() - start); //paced off the start, so one late read doesn't shift the rest
+            if (early > 0){
+                delayMicroseconds(early);
+            }
+            adcClaimed = true;
+            samples[i] = analogRead(VIBRATION_PIN);
+            adcClaimed = false;
+            if ((i & 15) == 0){
+                wdt_reset();
+                supervisor.publish(held, millis());
+            }
+        }
+        vibSampleHz = 1000000.0 / period;
+        return !stopRequested();
+    }
+
+    //the load cells set their own pace, 10 or 80 a second depending on the HX711's RATE pin
+    HX711* cell = (vibSource == VIB_THRUST) ? &thrustSensor : &torqueSensor;
+    LoadCellLinearizer* linearizer = (vibSource == VIB_THRUST) ? &thrustLinearizer : &torqueLinearizer;
+    float& heldValue = (vibSource == VIB_THRUST) ? held.thrust : held.torque;
+    unsigned long first = 0;
+    unsigned long last = 0;
+    for (int i = 0; i < VIB_FFT_SIZE; i++){
+        samples[i] = readLoadCellCounts(cell);
+        last = micros();
+        if (i == 0){
+            first = last;
+        }
+        heldValue = loadCellUnits(cell, linearizer, samples[i]); //still gets checked against its limit
+        supervisor.publish(held, millis());
+        wdt_reset();
+        if (stopRequested()){
+            return false;
+        }
+    }
+    vibSampleHz = (VIB_FFT_SIZE - 1) * 1000000.0 / (last - first);
+    return true;
+}
+
+void runVibrationTest(){ //up to vibThrottle, settle, a burst for the spectrum, back down. The rows either side are logged like any test
+    if(!setUpTest()){
+        return;
+    }
+
+    wdt_enable(WDTO_2S); //this is the watchdog timer. If it goes 2s without wdt_reset being called, the board will do a hardware reset.
+    wdt_reset();
+    resetSensorData();
+    armSupervisor();
+    testStartMicros = micros();
+    testStartMillis = millis();
+
+    float target = constrain(vibThrottle, 0, 100);
+    unsigned long slewTime = target * 1000 / VIB_SLEW_RATE;
+    indexMark(1, 0); //spin up, settle, spin down
+    bool spunUp = vibrationLeg(0, target, slewTime);
+    indexMark(1, 1);
+    if (spunUp && vibrationLeg(target, target, vibSettleTime)){
+        readSensorData();
+        float rpmBefore = RPM;
+        bool captured = captureVibration();
+        health.resume(); //the burst held the loop up on purpose
+        if (captured){
+            readSensorData();
+            vibRpm = (rpmBefore + RPM) / 2;
+            vibSpectrum.analyse();
+            wdt_reset();
+            vibrationCaptured = true;
+        }
+    }
+    if (!testCancelled && !supervisor.tripped()){
+        indexMark(1, 2);
+        vibrationLeg(throttle, 0, slewTime);
+    }
+
+    float peakHz[2] = {0, 0};
+    float peakAmplitude[2] = {0, 0};
+    bool captured = vibrationCaptured; //finishTest() clears it once the spectrum is written
+    if (captured){
+        String line = "VIBRATION,"; line += vibrationUnits(); line += ',';
+        line += String(vibRpm, 0);
+        for (int i = 0; i < 2; i++){
+            vibrationPeak(i + 1, &peakHz[i], &peakAmplitude[i]);
+            line += ','; line += String(peakHz[i], 2); line += ','; line += String(peakAmplitude[i], 4);
+        }
+        logNote(line); //RPM, then frequency and amplitude of the 1x and 2x peaks
+        Serial.println(line);
+    }
+
+    finishTest();
+
+    if (captured){
+        u8g2.clearBuffer();
+        u8g2.setFont(u8g2_font_t0_14b_tr);
+        u8g2.drawStr(2, 15, "Vibration");
+        u8g2.setFont(u8g2_font_5x7_tr);
+        u8g2.setCursor(3, 27); u8g2.print("RPM "); u8g2.print(vibRpm, 0);
+        for (int i = 0; i < 2; i++){
+            u8g2.setCursor(3, 37 + i*10); u8g2.print(i + 1); u8g2.print("x "); u8g2.print(peakHz[i], 1); u8g2.print(" Hz ");
+            u8g2.print(peakAmplitude[i], 3); u8g2.print(' '); u8g2.print(vibrationUnits());
+        }
+        u8g2.drawStr(3, 60, "Press any key to continue...");
+        u8g2.sendBuffer();
+        if (!scriptedStart){ //a campaign or the host carries on, the numbers are in the files
+            pressKeyToContinue();
+        }
+    }
+}
+
+void runTest(){//this method is in charge of deciding which test to run and then running it
+    testActive = true;
+    if(testType == 1){ //run smooth ramp test
+        runSmoothRampTest();
+    }
+    else if(testType == 2){
+        runSteppedRampTest();
+    }
+    else if(testType == 3){ //run piecewise test
+        runPiecewiseTest();
+    }
+    else if(testType == 4){
+        runBatteryTest();
+    }
+    else if(testType == 5){
+        runVibrationTest();
+    }
+    testActive = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//CAMPAIGN
+//Runs the tests in CAMPAIGN.TXT (format in Campaign.h) back to back, numbered on from the test number and
+//skipping any file that's already there. Between tests the motor gets campaignCooldown seconds off, then the load
+//cells are re-zeroed. A safety trip or a key press during a test ends the campaign. Where it's got to is kept in
+//EEPROM, so after a reset (watchdog, brownout) boot counts down and starts the cut short test again in a new file.
+//Progress goes out on Serial as @campaign lines.
+
+#define CAMPAIGN_FILE "CAMPAIGN.TXT"
+#define CAMPAIGN_MAX_TRIES 2 //starts of one test before a resume skips it
+#define CAMPAIGN_RESUME_WAIT 10 //s to cancel a resume at boot
+
+bool nextCampaignLine(File& file, char* line, bool* tooLong){ //false once the file has run out. line needs CAMPAIGN_MAX_LINE + 1
+    int c = file.read();
+    if (c < 0){
+        return false;
+    }
+    int length = 0;
+    *tooLong = false;
+    for (; c >= 0 && c != '\n'; c = file.read()){
+        if (c == '\r'){
+            continue;
+        }
+        if (length < CAMPAIGN_MAX_LINE){
+            line[length++] = c;
+        } else {
+            *tooLong = true;
+        }
+    }
+    line[length] = '\0';
+    return true;
+}
+
+bool campaignStepValid(const CampaignStep& step){
+    if (step.profile != 1 && step.profile != 2 && step.profile != 5){ //the piecewise test stops for prop swaps, someone has to be there for those
+        return false;
+    }
+    for (int i = 0; i < step.settingCount; i++){
+        MenuItem* item = getMenu(step.settings[i].id);
+        if (!item || item->type != TYPE_VALUE){
+            return false;
+        }
+    }
+    return true;
+}
+
+int scanCampaign(uint16_t* fileCrc, int* badLine){ //counts the tests and checks every line, -1 if there's no file. badLine is 0 if they're all fine
+    File file = SD.open(CAMPAIGN_FILE);
+    if (!file){
+        return -1;
+    }
+    char line[CAMPAIGN_MAX_LINE + 1];
+    bool tooLong;
+    int steps = 0;
+    int lineNumber = 0;
+    *fileCrc = CRC16_INIT;
+    *badLine = 0;
+    while (nextCampaignLine(file, line, &tooLong)){
+        lineNumber++;
+        *fileCrc = crc16(line, strlen(line), *fileCrc);
+        CampaignStep step;
+        CampaignLine kind = tooLong ? CAMPAIGN_BAD : parseCampaignLine(line, &step);
+        if (kind == CAMPAIGN_BAD || (kind == CAMPAIGN_STEP && !campaignStepValid(step))){
+            *badLine = lineNumber;
+            break;
+        }
+        if (kind == CAMPAIGN_STEP){
+            steps++;
+        }
+    }
+    file.close();
+    return steps;
+}
+
+bool loadCampaignStep(int index){ //sets up test index, settings from the lines before it included so a resume after a reset ends up the same
+    File file = SD.open(CAMPAIGN_FILE);
+    if (!file){
+        return false;
+    }
+    char line[CAMPAIGN_MAX_LINE + 1];
+    bool tooLong;
+    int steps = 0;
+    while (steps <= index && nextCampaignLine(file, line, &tooLong)){
+        CampaignStep step;
+        if (tooLong || parseCampaignLine(line, &step) != CAMPAIGN_STEP || !campaignStepValid(step)){
+            continue; //scanCampaign() already turned away files with bad lines
+        }
+        for (int i = 0; i < step.settingCount; i++){
+            *getMenu(step.settings[i].id)->variable = step.settings[i].value;
+        }
+        testType = step.profile;
+        steps++;
+    }
+    file.close();
+    return steps > index;
+}
+
+void saveCampaignResume(CampaignResume& resume){
+    resume.crc = crc16(&resume, offsetof(CampaignResume, crc));
+    EEPROM.put(CAMPAIGN_RESUME_ADDRESS, resume);
+}
+
+bool loadCampaignResume(CampaignResume* resume){ //false if no campaign was running
+    EEPROM.get(CAMPAIGN_RESUME_ADDRESS, *resume);
+    return resume->magic == CAMPAIGN_RESUME_MAGIC && resume->crc == crc16(resume, offsetof(CampaignResume, crc));
+}
+
+void clearCampaignResume(){
+    uint16_t blank = 0xFFFF;
+    EEPROM.put(CAMPAIGN_RESUME_ADDRESS, blank);
+}
+
+void campaignMessage(const char* title, const char* detail){
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_14b_tr);
+    u8g2.drawStr(2, 15, title);
+    u8g2.setFont(u8g2_font_5x7_tr);
+    u8g2.drawStr(3, 35, detail);
+    u8g2.sendBuffer();
+    delay(USER_NOTIF_DELAY);
+}
+
+bool campaignCountdown(const char* title, long seconds, int step, int stepCount){ //false if * cancels it
+    unsigned long start = millis();
+    long shown = -1;
+    while (true){
+        long left = seconds - (long)((millis() - start)/1000);
+        if (left <= 0){
+            return true;
+        }
+        if (left != shown){ //once a second is plenty
+            shown = left;
+            u8g2.clearBuffer();
+            u8g2.setFont(u8g2_font_t0_14b_tr);
+            u8g2.drawStr(2, 15, title);
+            u8g2.setFont(u8g2_font_5x7_tr);
+            u8g2.setCursor(3, 30); u8g2.print("Test "); u8g2.print(step + 1); u8g2.print(" of "); u8g2.print(stepCount);
+            u8g2.setCursor(3, 40); u8g2.print("Starts in "); u8g2.print(left); u8g2.print(" s");
+            u8g2.drawStr(3, 55, "Stop Campaign: *");
+            u8g2.sendBuffer();
+        }
+        if (readKey() == '*'){
+            return false;
+        }
+        uiIdle();
+    }
+}
+
+void autoTare(){ //tareLoadCell() without the prompt, the motor's been off for the cooldown. Not saved, the store would wear out
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_22b_tr);
+    u8g2.drawStr(14, 39, "Taring...");
+    u8g2.sendBuffer();
+
+    long thrustSum = 0;
+    long torqueSum = 0;
+    for (int i = 0; i < BOOT_TARE_SAMPLES; i++){ //both convert at once, so taking turns costs no extra time
+        thrustSum += readLoadCellCounts(&thrustSensor);
+        torqueSum += readLoadCellCounts(&torqueSensor);
+    }
+    thrustSensor.set_offset(thrustSum / BOOT_TARE_SAMPLES);
+    torqueSensor.set_offset(torqueSum / BOOT_TARE_SAMPLES);
+}
+
+void runCampaignFrom(CampaignResume& resume, int stepCount, bool afterReset){
+    const char* ending = "done";
+    bool rest = afterReset; //the motor may well have been running when the board reset
+    while (resume.nextStep < stepCount){
+        if (rest){
+            if (!campaignCountdown("Cooling Down", campaignCooldown, resume.nextStep, stepCount)){
+                ending = "stopped";
+                break;
+            }
+            if (campaignAutoTare){
+                autoTare();
+            }
+        }
+        rest = true;
+
+        if (!loadCampaignStep(resume.nextStep)){
+            ending = "changed";
+            break;
+        }
+        char filename[20];
+        testFileName(filename, sizeof(filename));
+        while (SD.exists(filename)){ //never overwrite, setUpTest() would refuse anyway
+            testNumber++;
+            testFileName(filename, sizeof(filename));
+        }
+        long number = testNumber;
+        resume.testNumber = number;
+        resume.tries++;
+        saveCampaignResume(resume);
+
+        scriptedStart = true;
+        runTest();
+        scriptedStart = false;
 
-    resetSensorData();
+        if (testNumber == number){ //finishTest() moves testNumber on, so it didn't get that far
+            ending = "failed";
+            break;
+        }
+        const char* result = supervisor.tripped() ? "tripped" : testCancelled ? "stopped" : "ok";
+        Serial.print("@campaign test "); Serial.print(resume.nextStep + 1); Serial.print('/'); Serial.print(stepCount);
+        Serial.print(' '); Serial.print(number); Serial.print(' '); Serial.println(result);
+        if (supervisor.tripped() || testCancelled){
+            ending = result;
+            break;
+        }
 
-    bool testRunning = true;
-    while(testRunning){
-        smoothRamp(); //TODO: CHANGE TO INTERVAL RAMP PROFILE AFTER MERGING
+        resume.nextStep++;
+        resume.tries = 0;
+        resume.testNumber = testNumber;
+        saveCampaignResume(resume);
+    }
+    clearCampaignResume();
 
-        throttle = 0;
-        setThrottle(0);
-        wdt_disable();
+    Serial.print("@campaign end "); Serial.print(ending); Serial.print(' ');
+    Serial.print(resume.nextStep); Serial.print('/'); Serial.println(stepCount);
+    char detail[40]; //two ints at their widest plus the text, so -Wformat-truncation has nothing to say
+    snprintf(detail, sizeof(detail), "%d of %d tests run", (int)resume.nextStep, stepCount);
+    campaignMessage(strcmp(ending, "done") == 0 ? "Campaign Done" : "Campaign Ended", detail);
+}
 
-        pauseScreen(); 
-        while(testRunning){ //prompt user to continue/end test
-            char userInput = customKeypad.getKey();
-            if(userInput){
-                Serial.println(userInput);
-                if(userInput == '*'){ //continue test
-                    break;
-                }
-                else if(userInput == '#'){ //end test
-                    testRunning = false; //break out of the main testing loop 
-                    break;
-                }
-            }
-        }
+void runCampaign(){ //checks the whole file before anything spins up, a bad line halfway through would strand the campaign
+    if (!sdAvailable && !SD.begin(SD_CS_PIN)){
+        campaignMessage("No SD Card", "Insert a card to run tests");
+        return;
+    }
+    sdAvailable = true;
+
+    uint16_t fileCrc;
+    int badLine;
+    int stepCount = scanCampaign(&fileCrc, &badLine);
+    char detail[24];
+    if (stepCount < 0){
+        campaignMessage("No Campaign", "Put " CAMPAIGN_FILE " on the card");
+        return;
+    }
+    if (badLine){
+        Serial.print("Bad campaign line "); Serial.println(badLine);
+        snprintf(detail, sizeof(detail), "Check line %d", badLine);
+        campaignMessage("Bad Campaign", detail);
+        return;
+    }
+    if (stepCount == 0){
+        campaignMessage("Empty Campaign", "No tests in " CAMPAIGN_FILE);
+        return;
+    }
 
-        promptPropSwap();
-        while(testRunning){ //prompt user to unplug motor, swap props, and continue/end test
-            char userInput = customKeypad.getKey();
-            if(userInput){
-                Serial.println(userInput);
-                if(userInput == '*'){ //continue test
-                    break;
-                }
-                else if(userInput == '#'){ //end test
-                    testRunning = false; //break out of the main testing loop 
-                    break;
-                }
-            }
+    u8g2.clearBuffer();
+    u8g2.setFont(u8g2_font_t0_14b_tr);
+    u8g2.setCursor(2, 15); u8g2.print("Campaign: "); u8g2.print(stepCount);
+    u8g2.setFont(u8g2_font_5x7_tr);
+    u8g2.setCursor(3, 28); u8g2.print("From Test "); u8g2.print(testNumber); u8g2.print(", "); u8g2.print(campaignCooldown); u8g2.print(" s apart");
+    u8g2.drawStr(3, 55, "Cancel: *");
+    u8g2.drawStr(3, 47, "Start: #");
+    u8g2.sendBuffer();
+    while (true){
+        char userInput = waitForKey();
+        if (userInput == '#'){
+            break;
         }
-
-        promptPlugInMotor();
-        while(testRunning){ //prompt user to plug in motor and continue/end test
-            char userInput = customKeypad.getKey();
-            if(userInput){
-                Serial.println(userInput);
-                if(userInput == '*'){ //continue test
-                    break;
-                }
-                else if(userInput == '#'){ //end test
-                    testRunning = false; //break out of the main testing loop 
-                    break;
-                }
-            }
+        if (userInput == '*'){
+            return;
         }
     }
 
-    throttle = 0;
-    setThrottle(0);
-    testNumber++;
-    dataFile.close();
-    wdt_disable();
+    Serial.print("@campaign start "); Serial.println(stepCount);
+    CampaignResume resume = {CAMPAIGN_RESUME_MAGIC, fileCrc, 0, 0, 0, (int32_t)testNumber, 0};
+    runCampaignFrom(resume, stepCount, false);
 }
 
-void runSmoothRampTest(){ //give time in millis since starting the test, returns a struct containing info about throttle settings and whether to record data
-    esc.writeMicroseconds(MIN_THROTTLE);
+void resumeCampaign(){ //boot, picks a campaign back up if a reset cut it short
+    CampaignResume resume;
+    if (!loadCampaignResume(&resume)){
+        return;
+    }
+    uint16_t fileCrc = 0;
+    int badLine = 0;
+    int stepCount = sdAvailable ? scanCampaign(&fileCrc, &badLine) : -1;
+    if (stepCount < 0 || badLine || fileCrc != resume.fileCrc){
+        Serial.println("@campaign end changed");
+        clearCampaignResume();
+        return;
+    }
+    if (resume.tries >= CAMPAIGN_MAX_TRIES){ //it's reset the board every time it's been run
+        Serial.print("@campaign skip "); Serial.println(resume.nextStep + 1);
+        resume.nextStep++;
+        resume.tries = 0;
+    }
+    if (resume.nextStep >= stepCount){
+        clearCampaignResume();
+        return;
+    }
 
-    if(!setUpTest()){
+    Serial.print("@campaign resume "); Serial.print(resume.nextStep + 1); Serial.print('/'); Serial.println(stepCount);
+    if (!campaignCountdown("Resuming Campaign", CAMPAIGN_RESUME_WAIT, resume.nextStep, stepCount)){
+        Serial.println("@campaign end stopped");
+        clearCampaignResume();
         return;
     }
+    testNumber = resume.testNumber;
+    uiBusy = true;
+    runCampaignFrom(resume, stepCount, true);
+    uiBusy = false;
+    menuDirty = true;
+}
 
-    wdt_enable(WDTO_2S); //this is the watchdog timer. If it goes 2s without wdt_reset being called, the board will do a hardware reset.
-    wdt_reset();
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//BENCHMARKS
+//Only in the benchmark and benchmark_native envs. Once boot is done, times the pieces a test loop is made of
+//and prints a BENCH report on Serial, then carries on to the menu as usual. See benchmark/README
 
-    resetSensorData(); //this line makes sure that if a sensor is missing, it shows as zero and not the value of the last test
-    
-    smoothRamp();  //start up the motor and do the thing
+#ifdef BENCHMARK_BUILD
+#define BENCHMARK_FILE "BENCH.CSV"
 
-    throttle = 0;
-    setThrottle(0);
-    testNumber++;
-    dataFile.close();
-    wdt_disable(); //turn off the watch dog
+void waitForThrustConversion(){ //so the read doesn't include the up to 100ms wait for the next conversion
+    while (!loadCellReady(&thrustSensor)) {}
 }
 
-void runSteppedRampTest(){
-    if(!setUpTest()){
-        return;
-    }
+void benchHx711Read(){
+    readLoadCellCounts(&thrustSensor);
+}
 
-    wdt_enable(WDTO_2S); //this is the watchdog timer. If it goes 2s without wdt_reset being called, the board will do a hardware reset.
-    wdt_reset();
-    
-    //initialize the test variables
-    bool testRunning = true;
-    throttle = 0.0;
-    float throttleStep = testThrottleMax/(float)intervalCount;
+void benchAnalogSet(){ //what readLocalSensors() spends on the analog channels
+    getVoltage();
+    getCurrent();
+    getAirspeed();
+}
 
-    for (int i = 1; i <= intervalCount; i++) {
+void prepareSdRow(){
+    Serial.flush(); //writeLogRow() prints, start every run with an empty TX buffer
+    newSensorRow = true;
+}
 
-        float targetThrottle = i*throttleStep;
+void benchSdRow(){
+    writeSensorSD();
+}
 
-        //slew throttle to next throttle setting by advancing at a maximum speed of 20% per second
-        while (testRunning && throttle <= targetThrottle-1){
-            throttle = throttle+1;
-            setThrottle(throttle);
+void benchCalibrationLoad(){
+    Calibration cal;
+    calStore.load(&cal, sizeof(cal));
+}
 
-            readSensorData();
-            displaySensorData();
+void runBenchmarks(){
+    Benchmark bench(Serial);
+    readSensorData(); //real values for the derived math and the screen
 
-            //check for any user input, cancel test if they pressed anything
-            char userInput = customKeypad.getKey();
-            if (userInput){
-                throttle = 0;
-                setThrottle(0);
-                testRunning = false;
-                break; //exit the while loop
-            }
+    bench.header();
+    bench.run("hx711_read", benchHx711Read, 10, waitForThrustConversion);
+    bench.run("analog_set", benchAnalogSet, 20);
+    bench.run("derived_math", calculateDerivedValues, 100);
+    bench.run("display_frame", drawSensorData, 10);
+    bench.run("eeprom_calibration_load", benchCalibrationLoad, 20);
 
-            wdt_reset(); //pet the dogS
-            delay(50);
-        }
+    if (sdAvailable){
+        dataFile = SD.open(BENCHMARK_FILE, FILE_WRITE);
+    }
+    if (sdAvailable && dataFile){
+        bench.run("sd_row", benchSdRow, 50, prepareSdRow);
+        dataFile.close();
+        SD.remove(BENCHMARK_FILE);
+    } else {
+        bench.skip("sd_row");
+    }
+    Serial.flush();
+}
+#endif
 
-        throttle = targetThrottle;
-        setThrottle(throttle); //snug up the throttle to the exact float percentage required
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SERIAL COMMANDS
+/*
+Line based commands on Serial (9600 baud, \n or \r\n), so a host script can set up and run tests without
+anyone at the keypad. Replies start with @ so they can be told apart from the debug prints around them.
+
+    list                       @item <id> <value> <label> for every value, then @ok list
+    get <id|name>              @ok get <id|name> <value>
+    set <id|name> <value>      @ok set <id|name> <value>
+    run <id>                   @ok run <id> right away, @done run <id> once the action returns
+    start [testNumber]         @ok start <n>, then @done start <n> ok|tripped when the test has finished
+    abort                      stops a running test, or cancels whatever prompt is up (same as pressing *)
+    key <keys>                 types keys as if on the keypad, for answering prompts ("key 2500#")
+    status                     @ok status state=idle|busy|test test=.. profile=.. and the latest readings
+    ripple                     one current burst: @burst <readings>, then @ok ripple sample_hz=.. poles=.. rpm=..
+                               optical=.. prominence=.. (tools/ripple_check.cpp reads these back). Idle only
+
+ids are the menu ids in the flow chart above, names are testNumber and profile (1-5, same as Select
+Profile). Anything that could go wrong answers @err <command> <reason>. Values can only be changed and
+things started from the menu; while a test or action is running only list/get/status/abort/key
+are taken. Commands get picked up wherever the firmware checks for a key (readKey), so a test in progress
+still answers status and abort.
+
+"run 51" starts a campaign ("key #" answers its start prompt). It reports as it goes, outside of any command:
+    @campaign start <tests>, @campaign test <k>/<tests> <testNumber> ok|tripped|stopped,
+    @campaign resume <k>/<tests> and @campaign skip <k> at boot, @campaign end <why> <run>/<tests>
+*/
 
-        unsigned long rampStopTime = millis();
-        while (millis() < rampStopTime + (unsigned long)rampSettleTime) { //wait one second for the propulsion system to reach equilibrium
-            readSensorData();
-            displaySensorData();
-            char userInput = customKeypad.getKey();
-            if (userInput){
-                throttle = 0;
-                setThrottle(0);
-                testRunning = false;
-                break; //exit the while loop
-            }
-            Serial.println("Allowing settle time");
-            wdt_reset();
-        }
+CommandLine commandLine;
 
-        wdt_reset();
-        //record data at that throttle setting once the throttle is in the right spot
-        unsigned long stepStartTime = millis();
-        while(testRunning && millis() - stepStartTime <= (unsigned long)intervalTime * 1000){ 
-            wdt_reset();
+struct NamedValue {
+    const char* name;
+    long* variable;
+    const char* label;
+};
 
-            readSensorData();
-            displaySensorData();
-            writeSensorSD();
+NamedValue namedValues[] = { //settings with no menu item of their own
+    {"testNumber", &testNumber, "Test Number"},
+    {"profile", &testType, "Test Profile (1-5)"},
+};
+const int NAMED_VALUE_COUNT = sizeof(namedValues)/sizeof(namedValues[0]);
 
-            //check for any user input, cancel test if they pressed anything
-            char userInput = customKeypad.getKey();
-            if (userInput){
-                throttle = 0;
-                setThrottle(0);
-                testRunning = false;
-                break; //exit the while loop
-            }
+long* commandVariable(const char* target){ //menu id of a value item or one of the names above, null if it's neither
+    long id;
+    if (parseNumber(target, &id)){
+        MenuItem* item = getMenu(id);
+        return (item && item->type == TYPE_VALUE) ? item->variable : nullptr;
+    }
+    for (int i = 0; i < NAMED_VALUE_COUNT; i++){
+        if (strcmp(target, namedValues[i].name) == 0){
+            return namedValues[i].variable;
         }
-        //once the step is complete, resets to top of for loop and repeats the process.
+    }
+    return nullptr;
+}
 
-        if (!testRunning){ //if the user cancels and breaks out of the while loop, break them out of the for loop too
-            break;
-        }
+void commandReply(const char* kind, const char* command, const char* detail){ //@ok/@err/@done lines
+    Serial.print('@'); Serial.print(kind); Serial.print(' '); Serial.print(command);
+    if (detail && *detail){
+        Serial.print(' '); Serial.print(detail);
     }
+    Serial.println();
+}
 
-    //end the test once all steps have been done
-    throttle = 0;
-    setThrottle(0);
-    testNumber++;
-    dataFile.close();
-    wdt_disable(); //turn off the watch dog
+void commandList(){
+    for (int i = 0; i < MENU_COUNT; i++){
+        if (menus[i].type == TYPE_VALUE){
+            Serial.print("@item "); Serial.print(menus[i].itemId); Serial.print(' ');
+            Serial.print(*menus[i].variable); Serial.print(' '); Serial.println(menus[i].label);
+        }
+    }
+    for (int i = 0; i < NAMED_VALUE_COUNT; i++){
+        Serial.print("@item "); Serial.print(namedValues[i].name); Serial.print(' ');
+        Serial.print(*namedValues[i].variable); Serial.print(' '); Serial.println(namedValues[i].label);
+    }
+    commandReply("ok", "list", NULL);
 }
 
-void runBatteryTest(){
+void commandStatus(){
+    Serial.print("@ok status state="); Serial.print(testActive ? "test" : uiBusy ? "busy" : "idle");
+    Serial.print(" test="); Serial.print(testNumber);
+    Serial.print(" profile="); Serial.print(testType);
+    Serial.print(" time="); Serial.print(testTime, 3);
+    Serial.print(" throttle="); Serial.print(throttle, 1);
+    Serial.print(" thrust="); Serial.print(thrust, 1); //mN
+    Serial.print(" torque="); Serial.print(torque, 2); //N.mm
+    Serial.print(" rpm="); Serial.print(RPM, 0);
+    Serial.print(" voltage="); Serial.print(voltage, 2);
+    Serial.print(" current="); Serial.print(current, 2);
+    Serial.print(" airspeed="); Serial.print(airspeed, 2);
+    ExtraSensors::printStatus(Serial, extraValues);
+    Serial.print(" tripped="); Serial.println(supervisor.tripped() ? 1 : 0);
+}
 
+void commandRipple(){ //the readings go out before they're analysed away, so the waveform can be checked on a PC
+    if (vibrationCaptured){
+        commandReply("err", "ripple", "spectrum in use");
+        return;
+    }
+    float sampleHz = captureRipple();
+    int32_t* samples = vibSpectrum.samples();
+    Serial.print("@burst "); //a second or so at 9600 baud, only ever between tests so nothing else needs the loop
+    for (int i = 0; i < VIB_FFT_SIZE; i++){
+        if (i) Serial.print(',');
+        Serial.print(samples[i]);
+        if ((i & 15) == 0){
+            wdt_reset();
+        }
+    }
+    Serial.println();
+    RippleEstimate estimate = estimateRipple(sampleHz);
+    Serial.print("@ok ripple sample_hz="); Serial.print(sampleHz, 1);
+    Serial.print(" poles="); Serial.print(motorPoles);
+    Serial.print(" rpm="); Serial.print(estimate.rpm, 0);
+    Serial.print(" optical="); Serial.print(RPM, 0);
+    Serial.print(" prominence="); Serial.println(estimate.prominence, 1);
 }
 
-void runTest(){//this method is in charge of deciding which test to run and then running it
-    if(testType == 1){ //run smooth ramp test
-        runSmoothRampTest();
+void commandStart(){
+    long number = testNumber;
+    if (commandLine.count() > 1 && (!parseNumber(commandLine.word(1), &number) || number < 0)){
+        commandReply("err", "start", "bad test number");
+        return;
     }
-    else if(testType == 2){
-        runSteppedRampTest();
+    long previous = testNumber;
+    testNumber = number;
+    char filename[20];
+    testFileName(filename, sizeof(filename));
+    if (sdAvailable && SD.exists(filename)){
+        testNumber = previous;
+        commandReply("err", "start", "file exists");
+        return;
     }
-    else if(testType == 3){ //run piecewise test
-        runPiecewiseTest();
+
+    char detail[32]; //the number and "tripped" at the end, with room for the widest long
+    snprintf(detail, sizeof(detail), "%ld", number);
+    commandReply("ok", "start", detail);
+    uiBusy = true;
+    scriptedStart = true;
+    runTest();
+    scriptedStart = false;
+    uiBusy = false;
+    menuDirty = true;
+
+    if (testNumber == number){ //finishTest() moves testNumber on, so it didn't get that far
+        commandReply("err", "start", "test didn't start");
+        return;
     }
-    else if(testType == 4){
-        runBatteryTest();
+    snprintf(detail, sizeof(detail), "%ld %s", number, supervisor.tripped() ? "tripped" : "ok");
+    commandReply("done", "start", detail);
+}
+
+void commandRun(){
+    long id;
+    MenuItem* item = parseNumber(commandLine.word(1), &id) ? getMenu(id) : nullptr;
+    if (!item || item->type != TYPE_ACTION || !item->action || item->action == runTest){
+        commandReply("err", "run", "not an action"); //tests go through start
+        return;
+    }
+    char detail[24]; //the line buffer gets reused by commands that come in while the action runs
+    snprintf(detail, sizeof(detail), "%ld", id);
+    commandReply("ok", "run", detail);
+    uiBusy = true;
+    item->action();
+    uiBusy = false;
+    menuDirty = true;
+    commandReply("done", "run", detail);
+}
+
+void runSerialCommand(){
+    const char* command = commandLine.word(0);
+    const char* target = commandLine.word(1);
+    bool idle = !uiBusy && !testActive;
+
+    if (strcmp(command, "list") == 0){
+        commandList();
+    } else if (strcmp(command, "status") == 0){
+        commandStatus();
+    } else if (strcmp(command, "ripple") == 0){
+        if (!idle){
+            commandReply("err", "ripple", "busy"); //a test's own burst could be mid capture, and the print would stall the test loop
+        } else {
+            commandRipple();
+        }
+    } else if (strcmp(command, "get") == 0){
+        long* variable = commandVariable(target);
+        if (!variable){
+            commandReply("err", "get", "no such value");
+            return;
+        }
+        Serial.print("@ok get "); Serial.print(target); Serial.print(' '); Serial.println(*variable);
+    } else if (strcmp(command, "set") == 0){
+        long* variable = commandVariable(target);
+        long value;
+        if (!variable){
+            commandReply("err", "set", "no such value");
+        } else if (!idle){
+            commandReply("err", "set", "busy");
+        } else if (!parseNumber(commandLine.word(2), &value) || value < 0 || (variable == &testType && (value < 1 || value > 5))){
+            commandReply("err", "set", "bad value"); //the keypad can't enter negative numbers either
+        } else {
+            *variable = value;
+            Serial.print("@ok set "); Serial.print(target); Serial.print(' '); Serial.println(value);
+        }
+    } else if (strcmp(command, "key") == 0){
+        strncpy(commandKeys, target, sizeof(commandKeys) - 1);
+        commandKeys[sizeof(commandKeys) - 1] = '\0';
+        commandKeyIndex = 0;
+        commandReply("ok", "key", NULL);
+    } else if (strcmp(command, "abort") == 0){
+        if (idle){
+            commandReply("err", "abort", "nothing running");
+            return;
+        }
+        strcpy(commandKeys, "*");
+        commandKeyIndex = 0;
+        commandReply("ok", "abort", NULL);
+    } else if (strcmp(command, "start") == 0 || strcmp(command, "run") == 0){
+        if (!idle){
+            commandReply("err", command, "busy");
+        } else if (command[0] == 's'){
+            commandStart();
+        } else {
+            commandRun();
+        }
+    } else {
+        commandReply("err", command, "unknown command");
+    }
+}
+
+void serviceSerialCommands(){ //reads whatever has arrived, runs a command once its line is complete. Never waits
+    while (Serial.available()){
+        if (commandLine.feed(Serial.read())){
+            runSerialCommand();
+        }
     }
 }
 
@@ -1309,59 +3822,157 @@ void runTest(){//this method is in charge of deciding which test to run and then
 //RUNTIME FUNCTIONS
 
 void setup() {
+    startSystemTick();
+
+    beginBootStage(BOOT_DISPLAY);
     u8g2.begin();
     Serial.begin(9600); // Start serial communication
     Serial.println("Keypad Ready");
-
     drawLoadingScreen(0, "Attaching pins");
+    endBootStage(BOOT_DISPLAY, STAGE_OK);
+
+    beginBootStage(BOOT_PINS);
     attachInterrupt(digitalPinToInterrupt(rpmPin), rpmISR, CHANGE); //attach RPM pin
-    esc.attach(ESC_PIN);
-    esc.writeMicroseconds(MIN_THROTTLE);
+    configureEsc(); //starts the ESC pulses at minimum throttle
+    SENSOR_NODE_SERIAL.begin(SENSOR_LINK_BAUD); //the tick starts parsing as soon as bytes turn up
 
-    drawLoadingScreen(10, "Initializing SD-Card");
     // Required for Mega SPI
     pinMode(53, OUTPUT);
     pinMode(SD_CS_PIN, OUTPUT);
+    ExtraSensors::begin();
+    endBootStage(BOOT_PINS, STAGE_OK);
 
-    while (!SD.begin(SD_CS_PIN)) {
-        Serial.println("SD card initialization failed!");
-    }
-
-    drawLoadingScreen(20, "Force Sensor Initialization");
+    beginBootStage(BOOT_LOAD_CELLS);
     torqueSensor.begin(TRQ_DOUT, TRQ_CLK);
     torqueSensor.set_gain(128);
 
     thrustSensor.begin(THST_DOUT, THST_CLK);
-    torqueSensor.set_gain(128);
+    thrustSensor.set_gain(128);
+    torqueReader.begin(); //the readers clock for gain 128 too
+    thrustReader.begin();
+    endBootStage(BOOT_LOAD_CELLS, STAGE_OK);
+
+    drawLoadingScreen(20, "Loading Calibration Factors");
+    beginBootStage(BOOT_CALIBRATION);
+    updateAnalogConversions(); //zero offsets until a calibration says otherwise
+    bool calibrated = loadCalibration(); //a validated calibration has the tare offsets in it, no need to re-measure them
+    bool legacyCalibration = !calibrated && loadLegacyCalibration();
+    endBootStage(BOOT_CALIBRATION, calibrated ? STAGE_OK : STAGE_FAILED);
+
+    //the SD card, listening for the sensor node and the tare don't depend on each other, so they run side by side. Between
+    //SD attempts the tare takes a sample from whichever load cell has a conversion ready, instead of averaging one cell then
+    //the other. The tare waits for the node check though, since that decides where the load cells are read from
+    drawLoadingScreen(40, calibrated ? "Initializing SD-Card" : "SD-Card and Sensor Zeroing");
+    beginBootStage(BOOT_SENSOR_NODE);
+    beginBootStage(BOOT_SD_CARD);
+    beginBootStage(BOOT_TARE);
+    if (calibrated){
+        endBootStage(BOOT_TARE, STAGE_SKIPPED);
+    }
+
+    bool sdDone = false;
+    bool nodeDone = false;
+    bool tareDone = calibrated;
+    int sdAttempts = 0;
+    long thrustSum = 0;
+    long torqueSum = 0;
+    int thrustSamples = 0;
+    int torqueSamples = 0;
+
+    while (!sdDone || !nodeDone || !tareDone){
+        if (!sdDone){
+            sdAttempts++;
+            if (SD.begin(SD_CS_PIN)){
+                sdAvailable = true;
+                sdDone = true;
+                endBootStage(BOOT_SD_CARD, STAGE_OK);
+            } else {
+                Serial.println("SD card initialization failed!");
+                if (sdAttempts >= SD_BOOT_ATTEMPTS){ //carry on without a card instead of hanging here
+                    sdDone = true;
+                    endBootStage(BOOT_SD_CARD, STAGE_FAILED);
+                }
+            }
+        }
+
+        if (!nodeDone){
+            if (!sensorPackets.empty()){ //one good frame is enough, the node only sends once it's running
+                sensorNodeActive = true;
+                nodeDone = true;
+                endBootStage(BOOT_SENSOR_NODE, STAGE_OK);
+            } else if (millis() - bootStages[BOOT_SENSOR_NODE].start >= SENSOR_NODE_BOOT_WAIT){
+                nodeDone = true; //no node, the sensors are wired straight to this board
+                endBootStage(BOOT_SENSOR_NODE, STAGE_SKIPPED);
+            } else if (sdDone){
+                uiIdle(); //nothing else to do while we listen
+            }
+        }
 
-    drawLoadingScreen(30, "Thrust Sensors Zeroing");
-    torqueSensor.tare();
-    thrustSensor.tare();
+        if (nodeDone && !tareDone){
+            if (thrustSamples < BOOT_TARE_SAMPLES && loadCellReady(&thrustSensor)){
+                thrustSum += readLoadCellCounts(&thrustSensor);
+                thrustSamples++;
+            }
+            if (torqueSamples < BOOT_TARE_SAMPLES && loadCellReady(&torqueSensor)){
+                torqueSum += readLoadCellCounts(&torqueSensor);
+                torqueSamples++;
+            }
+            if (thrustSamples == BOOT_TARE_SAMPLES && torqueSamples == BOOT_TARE_SAMPLES){
+                thrustSensor.set_offset(thrustSum / BOOT_TARE_SAMPLES);
+                torqueSensor.set_offset(torqueSum / BOOT_TARE_SAMPLES);
+                tareDone = true;
+                endBootStage(BOOT_TARE, STAGE_OK);
+            }
+        }
+    }
 
-    drawLoadingScreen(40, "Analog Zeroing");
     //zeroAnalog(); skipping this currently
 
-    drawLoadingScreen(50, "Loading Calibration Factors");
-    float torqueSensorScale;
-    EEPROM.get(TRQ_CAL_ADDRESS, torqueSensorScale); 
-    torqueSensor.set_scale(torqueSensorScale);
+    if (legacyCalibration){
+        saveCalibration(); //moves old style calibrations into the store so the next boot loads instantly
+    }
 
-    float thrustSensorScale;
-    EEPROM.get(THST_CAL_ADDRESS, thrustSensorScale); 
-    Serial.println(thrustSensorScale);
-    thrustSensor.set_scale(thrustSensorScale);
+    bootTime = millis();
+    Serial.print("Boot time (ms): "); Serial.println(bootTime);
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++){
+        Serial.print(bootStages[i].label); Serial.print(": ");
+        Serial.print(bootStages[i].end - bootStages[i].start); Serial.print(" ms ");
+        Serial.println(bootStatusLabel(bootStages[i].status));
+    }
+    if (!sensorNodeActive){
+        Serial.print("HX711 read (us): "); Serial.print(hx711ReadMicros); Serial.print(" max "); Serial.println(hx711ReadMicrosMax);
+    }
+
+    if (!sdAvailable){
+        drawLoadingScreen(100, "No SD-Card, tests disabled");
+        delay(USER_NOTIF_DELAY);
+    }
+
+    resumeCampaign(); //only does anything if a reset cut a campaign short
+
+#ifdef BENCHMARK_BUILD
+    runBenchmarks();
+#endif
 }
 
 //loop draws a menu and allows for navigation. Once something is selected, it does that function, then continues looping. 
 //If you would like your function to return to the main menu after completing, set the currentMenuId to zero at the end of your function runs
 void loop() { 
-    drawMenu(currentMenuId);
+    if (menuDirty){ //the menu only changes on a key press, no point pushing the same frame out over I2C again
+        drawMenu(currentMenuId);
+        menuDirty = false;
+    }
     
-    //wait for the user to press a key
-    char userInput = customKeypad.getKey();
+    //check for a key press, sleep until the next tick if there isn't one
+    char userInput = readKey();
+    if (!userInput) {
+        uiIdle();
+        return;
+    }
     
     // If a key is pressed, print it to the Serial Monitor
     if (userInput) {
+        menuDirty = true; //whatever the key did, the screen needs the menu back on it
         Serial.println(userInput);
 
         //check to see if the key is a number, if it is then save the number as "value"
@@ -0,0 +1,134 @@
+#include <Arduino.h>
+#include "FastHX711.h" //load cell ADCs, read through direct port access
+#include "SensorLink.h" //frame format shared with the UI board
+
+/*
+SENSOR NODE
+Runs on a Nano and does nothing but read the sensors: both HX711s whenever they have a conversion, the
+analog channels round robin as fast as the ADC goes, and the RPM markers on an interrupt. Every
+SENSOR_LINK_SAMPLE_PERIOD it sends one SamplePacket to the Mega (Serial1 there), which does the UI, the ESC
+and the SD card. Nothing in here waits on the screen or the card, so sample timing stays put.
+
+Wiring
+    Nano TX -> Mega RX1 (pin 19), grounds tied together
+    Thrust HX711 DOUT 4, CLK 5
+    Torque HX711 DOUT 6, CLK 7
+    RPM sensor 2
+    Voltage A0, Current A1, Airspeed A2
+*/
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//PINS
+
+#define THST_DOUT 4
+#define THST_CLK 5
+#define TRQ_DOUT 6
+#define TRQ_CLK 7
+#define RPM_PIN 2
+
+const uint8_t analogPins[3] = {A0, A1, A2}; //voltage, current, airspeed, same order as the packet
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//ACQUISITION STATE
+
+FastHX711<THST_DOUT, THST_CLK> thrustCell; //gain 128, raw counts only, the Mega applies offset and scale
+FastHX711<TRQ_DOUT, TRQ_CLK> torqueCell;
+
+volatile uint16_t rpmEdges = 0;
+
+uint8_t flags = 0; //SAMPLE_THRUST/SAMPLE_TORQUE since the last packet
+int32_t thrustCounts = 0;
+uint32_t thrustAt = 0;
+int32_t torqueCounts = 0;
+uint32_t torqueAt = 0;
+
+uint32_t analogSums[3] = {0, 0, 0};
+uint16_t analogReads[3] = {0, 0, 0};
+uint8_t analogChannel = 0;
+
+uint16_t sequence = 0;
+uint32_t windowStart = 0; //micros() the current packet window opened
+
+void rpmISR() {
+    rpmEdges++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//LINK
+
+void sendSample() {
+    uint32_t now = micros();
+    SamplePacket packet;
+
+    noInterrupts();
+    packet.rpmEdges = rpmEdges;
+    rpmEdges = 0;
+    interrupts();
+
+    packet.sequence = sequence++;
+    packet.sentAt = now;
+    packet.flags = flags;
+    packet.thrustCounts = thrustCounts;
+    packet.thrustAt = thrustAt;
+    packet.torqueCounts = torqueCounts;
+    packet.torqueAt = torqueAt;
+
+    uint16_t averages[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        averages[i] = analogReads[i] ? (analogSums[i] * 16) / analogReads[i] : 0; //x16 keeps the extra resolution from averaging
+        analogSums[i] = 0;
+        analogReads[i] = 0;
+    }
+    packet.voltageCounts = averages[0];
+    packet.currentCounts = averages[1];
+    packet.airspeedCounts = averages[2];
+    packet.analogAt = windowStart + (now - windowStart) / 2;
+    packet.rpmWindow = now - windowStart;
+
+    uint8_t frame[sizeof(SamplePacket) + SENSOR_LINK_OVERHEAD];
+    uint8_t length = encodeSensorFrame(LINK_SAMPLE, &packet, sizeof(packet), frame);
+    if (Serial.availableForWrite() >= length) { //never block on the UART, a late sample is worse than a lost one.
+        Serial.write(frame, length);                //a skipped packet still used up its sequence number, so the Mega sees the gap
+    }
+
+    flags = 0;
+    windowStart = now;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//RUNTIME FUNCTIONS
+
+void setup() {
+    Serial.begin(SENSOR_LINK_BAUD);
+
+    thrustCell.begin();
+    torqueCell.begin();
+
+    pinMode(RPM_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(RPM_PIN), rpmISR, CHANGE);
+
+    windowStart = micros();
+}
+
+void loop() {
+    //load cells, stamped when DOUT goes low since that's when the conversion finished
+    if (thrustCell.isReady()) {
+        thrustAt = micros();
+        thrustCounts = thrustCell.read();
+        flags |= SAMPLE_THRUST;
+    }
+    if (torqueCell.isReady()) {
+        torqueAt = micros();
+        torqueCounts = torqueCell.read();
+        flags |= SAMPLE_TORQUE;
+    }
+
+    //one ADC conversion per pass so the load cells never wait more than ~110us
+    analogSums[analogChannel] += analogRead(analogPins[analogChannel]);
+    analogReads[analogChannel]++;
+    analogChannel = (analogChannel + 1) % 3;
+
+    if (micros() - windowStart >= SENSOR_LINK_SAMPLE_PERIOD) {
+        sendSample();
+    }
+}
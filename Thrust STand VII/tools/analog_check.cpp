@@ -0,0 +1,59 @@
+//Holds the airspeed lookup (include/AnalogLookup.h) up against the float formula it replaced, on the host.
+//Counts are swept in small fractional steps since that's what the sensor node sends and what the zero
+//almost always lands on, with a finer sweep over the first couple of counts where sqrt bends hardest.
+//
+//    analog_check --selftest               worst error for a few zero voltages, FAIL past AIRSPEED_TOLERANCE
+
+#include "AnalogLookup.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define VCC 5.0 //same constants as main.cpp
+#define SENSITIVITY 1.0
+#define AIR_DENSITY 1.2
+#define AIRSPEED_TOLERANCE 0.02 //m/s
+
+static double formula(double counts, double zeroVolts) { //getAirspeed() before the table
+    double pascals = (counts * VCC / 1023.0 - zeroVolts) / SENSITIVITY * 1000.0;
+    return pascals > 0 ? sqrt(2.0 * pascals / AIR_DENSITY) : 0;
+}
+
+static double worstError(const AirspeedLookup& lookup, double zeroVolts, double from, double to, double step, double& worstAt) {
+    double worst = 0;
+    for (double counts = from; counts <= to; counts += step) {
+        double error = fabs(lookup.convert((float)counts) - formula(counts, zeroVolts));
+        if (error > worst) {
+            worst = error;
+            worstAt = counts;
+        }
+    }
+    return worst;
+}
+
+static int selfTest() {
+    int failures = 0;
+    const float zeros[] = {2.7f, 2.5f, 2.5123f, 0.5f}; //the default, a whole count, a fraction of one, a 0.5-4.5V part
+    for (float zero : zeros) {
+        AirspeedLookup lookup;
+        lookup.begin(VCC / 1023.0, zero, SENSITIVITY, AIR_DENSITY);
+        double zeroCounts = zero / (VCC / 1023.0);
+        double nearAt = 0, fullAt = 0;
+        double near = worstError(lookup, zero, zeroCounts - 1, zeroCounts + 2, 0.001, nearAt);
+        double full = worstError(lookup, zero, zeroCounts, 1023, 1 / 64.0, fullAt);
+        printf("zero %.4fV: worst %.4f m/s in the first 2 counts (at %.3f), %.4f m/s over the range (at %.3f)\n",
+            zero, near, nearAt - zeroCounts, full, fullAt - zeroCounts);
+        failures += near > AIRSPEED_TOLERANCE;
+        failures += full > AIRSPEED_TOLERANCE;
+    }
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--selftest") == 0) {
+        return selfTest();
+    }
+    fprintf(stderr, "usage: analog_check --selftest\n");
+    return 2;
+}
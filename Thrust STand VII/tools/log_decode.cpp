@@ -0,0 +1,793 @@
+//Turns a compressed test log (Test_N.dlg, format in include/LogCodec.h) back into the CSV the stand writes
+//in its normal logging mode. The derived columns (power, efficiency) are worked out again from the logged
+//channels with the same formulas as readSensorData(). Damaged blocks are dropped and counted on stderr.
+//
+//
+//It also reads the segment index at the end of a log (include/LogIndex.h), CSV or compressed, and pulls out
+//just one segment or step without going through the rest of the file. A raw counts log (# raw header, see
+//writeRawHeader() in main.cpp) comes out in units too, with any of its constants swapped for corrected ones,
+//and its drag tare taken off the thrust the same way the stand does it live.
+//
+//    log_decode Test_1.dlg > Test_1.csv
+//    log_decode --index Test_1.csv       segment, step, time and byte offset of every index entry
+//    log_decode --step 1:3 Test_1.dlg    only the rows of segment 1 step 3, as CSV
+//    log_decode --raw Test_1.csv thrust_scale=41.7 > units.csv    raw counts to units, key=value overrides the header
+//    log_decode --selftest               round trip, corruption, truncation and index checks against LogEncoder
+
+#include "LogCodec.h"
+#include "LogIndex.h"
+#include "DragTare.h"
+#include "Crc16.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+struct LogItem { //a row or a note, in file order
+    bool isNote;
+    double values[LOG_CHANNELS]; //engineering units, time in seconds
+    std::string text;
+};
+
+struct DecodeStats {
+    size_t rows = 0;
+    size_t blocks = 0;
+    size_t badBlocks = 0; //failed CRC or didn't parse, their rows are dropped
+    size_t badNotes = 0;
+    size_t skippedBytes = 0; //between blocks, while looking for the next sync
+    bool truncated = false; //last block had no end marker, its rows are kept but unchecked
+};
+
+struct LogHeader {
+    uint8_t channels;
+    uint8_t keyframeInterval;
+    float resolution[LOG_CHANNELS];
+};
+
+class LogDecoder {
+public:
+    LogDecoder(const std::vector<uint8_t>& data) : data(data) {}
+
+    bool decode(std::vector<LogItem>& items, DecodeStats& stats) {
+        if (!readHeader()) {
+            return false;
+        }
+        size_t pos = LOG_HEADER_SIZE;
+        while (pos < data.size()) {
+            if (data[pos] == LOG_SYNC1 && pos + 1 < data.size() && data[pos + 1] == LOG_SYNC2) {
+                std::vector<LogItem> block;
+                size_t end = 0;
+                BlockResult result = readBlock(pos + 2, block, end);
+                if (result == BLOCK_BAD) {
+                    stats.badBlocks++;
+                    pos++; //a false sync inside a damaged block, look again from the next byte
+                    continue;
+                }
+                for (LogItem& item : block) {
+                    if (!item.isNote) stats.rows++;
+                    items.push_back(item);
+                }
+                stats.blocks++;
+                stats.truncated = (result == BLOCK_TRUNCATED);
+                pos = end;
+            } else if (data[pos] == LOG_TAG_NOTE) {
+                LogItem note;
+                size_t end = readNote(pos, note);
+                if (end) {
+                    items.push_back(note);
+                    pos = end;
+                } else {
+                    stats.badNotes++;
+                    pos++;
+                }
+            } else {
+                stats.skippedBytes++;
+                pos++;
+            }
+        }
+        return true;
+    }
+
+    const LogHeader& header() const { return head; }
+
+private:
+    enum BlockResult {BLOCK_OK, BLOCK_BAD, BLOCK_TRUNCATED};
+
+    bool readHeader() {
+        if (data.size() < LOG_HEADER_SIZE || memcmp(data.data(), LOG_MAGIC, 4) != 0) {
+            fprintf(stderr, "not a compressed stand log\n");
+            return false;
+        }
+        if (data[4] != LOG_FORMAT_VERSION || data[5] != LOG_CHANNELS) {
+            fprintf(stderr, "log format %u with %u channels, this decoder reads format %u with %u\n", data[4], data[5], LOG_FORMAT_VERSION, LOG_CHANNELS);
+            return false;
+        }
+        head.channels = data[5];
+        head.keyframeInterval = data[6];
+        memcpy(head.resolution, data.data() + 7, sizeof(head.resolution));
+        return true;
+    }
+
+    size_t readNote(size_t pos, LogItem& note) { //returns the position after the note, 0 if it's damaged
+        if (pos + 2 > data.size()) return 0;
+        uint8_t length = data[pos + 1];
+        if (length > LOG_MAX_NOTE || pos + 4 + length > data.size()) return 0;
+        uint16_t crc = crc16(&data[pos + 1], length + 1);
+        if (data[pos + 2 + length] != (crc & 0xFF) || data[pos + 3 + length] != (crc >> 8)) return 0;
+        note.isNote = true;
+        note.text.assign((const char*)&data[pos + 2], length);
+        return pos + 4 + length;
+    }
+
+    bool readValue(size_t& pos, int32_t& value, bool& cutOff) {
+        uint32_t raw;
+        uint8_t n = readVarint(data.data() + pos, data.size() - pos, &raw);
+        if (n == 0) {
+            cutOff = data.size() - pos < LOG_MAX_VARINT;
+            return false;
+        }
+        pos += n;
+        value = zigzagDecode(raw);
+        return true;
+    }
+
+    LogItem row(const int32_t* counts) {
+        LogItem item;
+        item.isNote = false;
+        for (uint8_t i = 0; i < LOG_CHANNELS; i++) {
+            item.values[i] = counts[i] / (double)head.resolution[i];
+        }
+        return item;
+    }
+
+    BlockResult readBlock(size_t pos, std::vector<LogItem>& block, size_t& end) {
+        int32_t counts[LOG_CHANNELS];
+        bool cutOff = false;
+        size_t start = pos;
+        for (uint8_t i = 0; i < LOG_CHANNELS; i++) {
+            if (!readValue(pos, counts[i], cutOff)) {
+                end = data.size();
+                return cutOff ? BLOCK_TRUNCATED : BLOCK_BAD;
+            }
+        }
+        uint16_t crc = crc16(&data[start], pos - start);
+        block.push_back(row(counts));
+        uint16_t rows = 1;
+
+        for (;;) {
+            if (pos >= data.size()) {
+                end = pos;
+                return BLOCK_TRUNCATED;
+            }
+            uint8_t tag = data[pos];
+            if (tag == LOG_TAG_END) {
+                if (pos + 3 > data.size()) {
+                    end = data.size();
+                    return BLOCK_TRUNCATED;
+                }
+                if (data[pos + 1] != (crc & 0xFF) || data[pos + 2] != (crc >> 8)) {
+                    return BLOCK_BAD;
+                }
+                end = pos + 3;
+                return BLOCK_OK;
+            }
+            if (tag == LOG_TAG_NOTE) {
+                LogItem note;
+                size_t noteEnd = readNote(pos, note);
+                if (!noteEnd) return BLOCK_BAD;
+                block.push_back(note);
+                pos = noteEnd;
+                continue;
+            }
+            if ((tag & 0x80) || rows >= head.keyframeInterval) {
+                return BLOCK_BAD;
+            }
+
+            start = pos++;
+            int32_t delta;
+            if (!readValue(pos, delta, cutOff)) {
+                end = data.size();
+                return cutOff ? BLOCK_TRUNCATED : BLOCK_BAD;
+            }
+            counts[LOG_TIME] += delta;
+            for (uint8_t i = 1; i < LOG_CHANNELS; i++) {
+                if (!(tag & (1 << (i - 1)))) continue;
+                if (!readValue(pos, delta, cutOff)) {
+                    end = data.size();
+                    return cutOff ? BLOCK_TRUNCATED : BLOCK_BAD;
+                }
+                counts[i] += delta;
+            }
+            crc = crc16(&data[start], pos - start, crc);
+            block.push_back(row(counts));
+            rows++;
+        }
+    }
+
+    const std::vector<uint8_t>& data;
+    LogHeader head;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//CSV OUTPUT
+
+static void printValue(FILE* out, double value, int digits) { //nan and inf spelled like the Arduino print() does
+    if (isnan(value)) {
+        fputs("nan", out);
+    } else if (isinf(value)) {
+        fputs("inf", out);
+    } else {
+        fprintf(out, "%.*f", digits, value);
+    }
+}
+
+static void writeCsv(FILE* out, const std::vector<LogItem>& items) {
+    fprintf(out, "Time (s),Current (A),Voltage (V),Torque(N.mm),Thrust(mN),RPM,Airspeed(m/s),Throttle (%%),Electrical Power (W),Mechanical Power (W),Propulsive Power (W),Motor Efficiency (%%), Propeller Efficiency (%%), System Efficiency (%%)\r\n");
+    for (const LogItem& item : items) {
+        if (item.isNote) {
+            fprintf(out, "%s\r\n", item.text.c_str());
+            continue;
+        }
+        const double* v = item.values;
+        double electricPower = fabs(v[LOG_VOLTAGE] * v[LOG_CURRENT]);
+        double mechanicalPower = fabs(v[LOG_TORQUE] * v[LOG_RPM] * 0.1047 / 1000);
+        double propellerPower = fabs(v[LOG_THRUST] * v[LOG_AIRSPEED] / 1000);
+        double columns[14] = {v[LOG_TIME], v[LOG_CURRENT], v[LOG_VOLTAGE], v[LOG_TORQUE], v[LOG_THRUST], v[LOG_RPM], v[LOG_AIRSPEED],
+            v[LOG_THROTTLE], electricPower, mechanicalPower, propellerPower, fabs(mechanicalPower / electricPower),
+            fabs(propellerPower / mechanicalPower), fabs(propellerPower / electricPower)};
+        for (int i = 0; i < 14; i++) {
+            printValue(out, columns[i], (i == 5 || i == 7) ? 1 : 3); //RPM and throttle to one place, like the stand
+            fputs(i < 13 ? "," : "\r\n", out);
+        }
+    }
+}
+
+static void printStats(const DecodeStats& stats) {
+    fprintf(stderr, "%zu rows in %zu blocks, %zu bad blocks, %zu bad notes, %zu bytes skipped%s\n", stats.rows, stats.blocks,
+        stats.badBlocks, stats.badNotes, stats.skippedBytes, stats.truncated ? ", last block cut off (kept, unchecked)" : "");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//INDEX
+
+#define INDEX_SEARCH_BYTES 8192 //how far back from the end to look for a checkpoint when there's no trailer
+
+static bool isCompressed(const std::vector<uint8_t>& data) {
+    return data.size() >= 4 && memcmp(data.data(), LOG_MAGIC, 4) == 0;
+}
+
+static bool textAt(const std::vector<uint8_t>& data, size_t pos, std::string& text) { //the # line or note starting at pos
+    if (isCompressed(data)) {
+        if (pos + 4 > data.size() || data[pos] != LOG_TAG_NOTE) return false;
+        uint8_t length = data[pos + 1];
+        if (pos + 4 + length > data.size()) return false;
+        uint16_t crc = crc16(&data[pos + 1], length + 1);
+        if (data[pos + 2 + length] != (crc & 0xFF) || data[pos + 3 + length] != (crc >> 8)) return false;
+        text.assign((const char*)&data[pos + 2], length);
+        return true;
+    }
+    if (pos >= data.size() || data[pos] != '#') return false;
+    size_t end = pos;
+    while (end < data.size() && data[end] != '\r' && data[end] != '\n') end++;
+    text.assign((const char*)&data[pos], end - pos);
+    return true;
+}
+
+static bool findLastCheckpoint(const std::vector<uint8_t>& data, uint32_t* offset, bool* fromTrailer) {
+    bool compressed = isCompressed(data);
+    std::string text;
+    //the trailer is the last thing in the file and always the same length
+    size_t trailerSize = LOG_INDEX_TRAILER_TEXT + (compressed ? 4 : 2);
+    if (data.size() >= trailerSize && textAt(data, data.size() - trailerSize, text) && parseIndexTrailer(text.c_str(), offset)) {
+        *fromTrailer = true;
+        return *offset < data.size();
+    }
+    //cut short, the last checkpoint is somewhere near the end
+    *fromTrailer = false;
+    const size_t tagLength = strlen(LOG_INDEX_TAG);
+    size_t stop = data.size() > INDEX_SEARCH_BYTES ? data.size() - INDEX_SEARCH_BYTES : 0;
+    for (size_t pos = data.size() - (data.size() >= tagLength ? tagLength : data.size()); pos > stop; pos--) {
+        if (memcmp(&data[pos], LOG_INDEX_TAG, tagLength) != 0) continue;
+        size_t start = compressed ? pos - 2 : pos; //a note's text starts after the tag and length
+        if (compressed ? pos < 2 : (pos > 0 && data[pos - 1] != '\n')) continue;
+        LogIndexEntry entries[LOG_INDEX_PENDING];
+        uint32_t previous;
+        uint8_t count;
+        if (textAt(data, start, text) && parseIndexCheckpoint(text.c_str(), &previous, entries, &count)) {
+            *offset = start;
+            return true;
+        }
+    }
+    return false;
+}
+
+//every entry in file order. False if the file has no index or the chain is broken
+static bool readIndex(const std::vector<uint8_t>& data, std::vector<LogIndexEntry>& index, bool* fromTrailer) {
+    uint32_t offset;
+    if (!findLastCheckpoint(data, &offset, fromTrailer)) {
+        return false;
+    }
+    std::vector<LogIndexEntry> backwards;
+    while (offset != 0) {
+        std::string text;
+        LogIndexEntry entries[LOG_INDEX_PENDING];
+        uint32_t previous;
+        uint8_t count;
+        if (!textAt(data, offset, text) || !parseIndexCheckpoint(text.c_str(), &previous, entries, &count) || previous >= offset) {
+            fprintf(stderr, "bad index checkpoint at %lu\n", (unsigned long)offset);
+            return false;
+        }
+        for (int i = count - 1; i >= 0; i--) {
+            backwards.push_back(entries[i]);
+        }
+        offset = previous;
+    }
+    index.assign(backwards.rbegin(), backwards.rend());
+    return true;
+}
+
+//byte range of one segment and step. The periodic entries for the same step carry on the range
+static bool stepRange(const std::vector<LogIndexEntry>& index, uint8_t segment, uint8_t step, size_t fileSize, size_t* start, size_t* end) {
+    size_t i = 0;
+    while (i < index.size() && !(index[i].segment == segment && index[i].step == step)) i++;
+    if (i == index.size()) {
+        return false;
+    }
+    *start = index[i].offset;
+    while (i < index.size() && index[i].segment == segment && index[i].step == step) i++;
+    *end = i < index.size() ? index[i].offset : fileSize;
+    return *start <= *end && *end <= fileSize;
+}
+
+static void printIndex(const std::vector<LogIndexEntry>& index) {
+    printf("segment,step,time (s),offset\n");
+    for (const LogIndexEntry& entry : index) {
+        printf("%u,%u,%.3f,%lu\n", entry.segment, entry.step, entry.millis / 1000.0, (unsigned long)entry.offset);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//RAW COUNTS
+
+#define RAW_TAG "# raw "
+#define RAW_COLUMNS 9 //time (us), thrust, torque, voltage, current, airspeed, RPM edges, RPM window (us), throttle (0.1%)
+                      //newer logs add ripple RPM and the mismatch flag after these, already in units so they're not read
+
+typedef std::map<std::string, std::string> RawConstants;
+
+static bool rawKeyValue(const std::string& pair, RawConstants& constants) { //key=value, false if it isn't one
+    size_t equals = pair.find('=');
+    if (equals == std::string::npos || equals == 0) return false;
+    constants[pair.substr(0, equals)] = pair.substr(equals + 1);
+    return true;
+}
+
+static double rawNumber(const RawConstants& constants, const char* key, bool* missing) {
+    RawConstants::const_iterator it = constants.find(key);
+    if (it == constants.end()) {
+        fprintf(stderr, "raw header has no %s\n", key);
+        *missing = true;
+        return 0;
+    }
+    return atof(it->second.c_str());
+}
+
+static double rawLoad(const RawConstants& constants, const char* cell, double counts, bool* missing) { //same as loadCellUnits()
+    std::string key = cell;
+    counts -= rawNumber(constants, (key + "_offset").c_str(), missing);
+    double fit[6] = {0}; //c0:c1:c2:countScale:lowCounts:highCounts
+    RawConstants::const_iterator it = constants.find(key + "_fit");
+    if (it != constants.end()) {
+        sscanf(it->second.c_str(), "%lf:%lf:%lf:%lf:%lf:%lf", &fit[0], &fit[1], &fit[2], &fit[3], &fit[4], &fit[5]);
+    }
+    if (fit[3] == 0) {
+        return counts / rawNumber(constants, (key + "_scale").c_str(), missing);
+    }
+    //the multi-point polynomial in counts/countScale, carried on along the end slope outside the calibrated range
+    double x = counts / fit[3];
+    double edge = x < fit[4] / fit[3] ? fit[4] / fit[3] : x > fit[5] / fit[3] ? fit[5] / fit[3] : x;
+    double load = fit[0] * edge + fit[1] * edge * edge + fit[2] * edge * edge * edge;
+    double slope = fit[0] + 2 * fit[1] * edge + 3 * fit[2] * edge * edge;
+    return load + slope * (x - edge);
+}
+
+static bool rawDragTare(const RawConstants& constants, DragTare& dragTare) { //step:drag0:drag1:..., 0 or no key means none
+    RawConstants::const_iterator it = constants.find("drag_tare");
+    DragTable table = {};
+    if (it != constants.end()) {
+        const char* p = it->second.c_str();
+        char* stop;
+        table.step = strtof(p, &stop);
+        while (*stop == ':' && table.count < DRAG_TARE_POINTS) {
+            p = stop + 1;
+            table.drag[table.count++] = strtof(p, &stop);
+        }
+        if (*stop != '\0') {
+            fprintf(stderr, "raw header drag_tare doesn't parse\n");
+            return false;
+        }
+    }
+    dragTare.begin(table);
+    return true;
+}
+
+//turns a raw counts log into rows in units. Index lines are dropped, their offsets don't fit the output
+static bool decodeRaw(const std::vector<uint8_t>& data, const RawConstants& overrides, std::vector<LogItem>& items, size_t* badRows) {
+    std::string text(data.begin(), data.end());
+    RawConstants constants;
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(start, end - start);
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        start = end + 1;
+        if (line.compare(0, strlen(RAW_TAG), RAW_TAG) == 0) {
+            size_t pos = strlen(RAW_TAG);
+            while (pos < line.size()) {
+                size_t space = line.find(' ', pos);
+                if (space == std::string::npos) space = line.size();
+                rawKeyValue(line.substr(pos, space - pos), constants);
+                pos = space + 1;
+            }
+        } else if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+    if (constants.empty()) {
+        fprintf(stderr, "not a raw counts log, no %sheader\n", RAW_TAG);
+        return false;
+    }
+    for (RawConstants::const_iterator it = overrides.begin(); it != overrides.end(); ++it) {
+        constants[it->first] = it->second;
+    }
+
+    bool missing = false;
+    double divisor = rawNumber(constants, "analog_divisor", &missing);
+    double voltsPerCount = rawNumber(constants, "vcc", &missing) / rawNumber(constants, "adc_max", &missing);
+    double voltageGain = voltsPerCount * rawNumber(constants, "voltage_calibration", &missing);
+    double voltageOffset = rawNumber(constants, "voltage_offset", &missing);
+    double currentGain = voltsPerCount / rawNumber(constants, "current_sensitivity", &missing);
+    double currentOffset = rawNumber(constants, "current_offset", &missing);
+    double averageGain = rawNumber(constants, "average_gain", &missing) / 100;
+    double zeroVolts = rawNumber(constants, "zero_voltage", &missing);
+    double pascalsPerVolt = 1000 / rawNumber(constants, "airspeed_sensitivity", &missing);
+    double airDensity = rawNumber(constants, "air_density", &missing);
+    double airspeedOverride = rawNumber(constants, "airspeed_override", &missing);
+    double edgesPerRev = 2 * rawNumber(constants, "pulses_per_rev", &missing); //rising and falling
+    DragTare dragTare;
+    if (missing || !rawDragTare(constants, dragTare)) {
+        return false;
+    }
+
+    double current = 0;
+    bool first = true;
+    *badRows = 0;
+    for (const std::string& line : lines) {
+        LogItem item;
+        if (line[0] == '#') {
+            if (line.compare(0, strlen(LOG_INDEX_TAG), LOG_INDEX_TAG) == 0 || line.compare(0, strlen(LOG_INDEX_END_TAG), LOG_INDEX_END_TAG) == 0) continue;
+            item.isNote = true;
+            item.text = line;
+            items.push_back(item);
+            continue;
+        }
+        double raw[RAW_COLUMNS];
+        const char* p = line.c_str();
+        int n = 0;
+        for (char* stop; n < RAW_COLUMNS; n++, p = stop + 1) {
+            raw[n] = strtod(p, &stop);
+            if (stop == p || (*stop != ',' && *stop != '\0') || (*stop == '\0' && n < RAW_COLUMNS - 1)) break;
+        }
+        if (n < RAW_COLUMNS) {
+            if (!first || line.compare(0, 4, "Time") != 0) (*badRows)++; //the column names aren't a bad row
+            continue;
+        }
+
+        double readCurrent = raw[4] / divisor * currentGain - currentOffset;
+        current = first ? readCurrent : (1 - averageGain) * current + averageGain * readCurrent; //same moving average as addCurrentSample()
+        first = false;
+        double above = raw[5] / divisor * voltsPerCount - zeroVolts;
+        item.isNote = false;
+        item.values[LOG_TIME] = raw[0] / 1e6;
+        item.values[LOG_THRUST] = rawLoad(constants, "thrust", raw[1], &missing);
+        item.values[LOG_TORQUE] = rawLoad(constants, "torque", raw[2], &missing);
+        item.values[LOG_VOLTAGE] = raw[3] / divisor * voltageGain - voltageOffset;
+        item.values[LOG_CURRENT] = current;
+        item.values[LOG_AIRSPEED] = airspeedOverride != 0 ? airspeedOverride : above > 0 ? sqrt(2 * above * pascalsPerVolt / airDensity) : 0;
+        item.values[LOG_THRUST] -= dragTare.at(item.values[LOG_AIRSPEED]);
+        item.values[LOG_RPM] = raw[7] > 0 ? raw[6] * 60e6 / (raw[7] * edgesPerRev) : 0;
+        item.values[LOG_THROTTLE] = raw[8] / 10;
+        items.push_back(item);
+    }
+    return !missing;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SELF TEST
+
+static void syntheticRow(int i, float* values) { //a stepped run, 10 rows a second
+    float throttle = 12.5f * (1 + (i / 40) % 8);
+    float rpm = throttle * 115 + 30 * sinf(i * 1.3f);
+    values[LOG_TIME] = i * 0.0987f;
+    values[LOG_CURRENT] = throttle * throttle * 0.003f + 0.05f * sinf(i * 0.7f);
+    values[LOG_VOLTAGE] = 16.8f - throttle * 0.006f;
+    values[LOG_TORQUE] = throttle * 3.02f + 0.2f * cosf(i * 2.1f);
+    values[LOG_THRUST] = throttle * throttle * 1.95f + 12 * sinf(i * 0.9f);
+    values[LOG_RPM] = rpm;
+    values[LOG_AIRSPEED] = 0;
+    values[LOG_THROTTLE] = throttle;
+}
+
+static std::vector<uint8_t> encodeRows(int rows, size_t* csvBytes) {
+    std::vector<uint8_t> file(LOG_HEADER_SIZE);
+    LogEncoder encoder;
+    encoder.header(file.data());
+    uint8_t buffer[LOG_MAX_NOTE + 4 > LOG_MAX_RECORD ? LOG_MAX_NOTE + 4 : LOG_MAX_RECORD];
+    *csvBytes = 0;
+    for (int i = 0; i < rows; i++) {
+        float values[LOG_CHANNELS];
+        syntheticRow(i, values);
+        uint8_t n = encoder.encode(values, buffer);
+        file.insert(file.end(), buffer, buffer + n);
+        *csvBytes += 140; //typical CSV row with the derived columns
+        if (i == 150) {
+            n = encoder.note("SAFETY TRIP,Over current,20.281,20.000,15.030", buffer);
+            file.insert(file.end(), buffer, buffer + n);
+        }
+    }
+    uint8_t n = encoder.finish(buffer);
+    file.insert(file.end(), buffer, buffer + n);
+    return file;
+}
+
+static int checkRows(const std::vector<LogItem>& items, int firstRow, int count) { //returns mismatches against syntheticRow
+    int bad = 0;
+    int i = firstRow;
+    for (const LogItem& item : items) {
+        if (item.isNote) continue;
+        if (count-- <= 0) break;
+        float want[LOG_CHANNELS];
+        syntheticRow(i++, want);
+        for (uint8_t c = 0; c < LOG_CHANNELS; c++) {
+            if (fabs(item.values[c] - want[c]) > 0.5 / logChannelResolution[c] + fabs(want[c]) * 1e-6) bad++; //float rounding on top of the quantization
+        }
+    }
+    return bad;
+}
+
+static int runSelfTest() {
+    const int ROWS = 320;
+    int failures = 0;
+    size_t csvBytes;
+    std::vector<uint8_t> file = encodeRows(ROWS, &csvBytes);
+
+    //clean round trip
+    std::vector<LogItem> items;
+    DecodeStats stats;
+    LogDecoder(file).decode(items, stats);
+    int mismatches = checkRows(items, 0, ROWS);
+    bool notes = items.size() == ROWS + 1 && items[151].isNote;
+    printf("round trip: %zu rows, %d mismatches, note %s, %zu bytes vs ~%zu as CSV (%.1fx)\n", stats.rows, mismatches,
+        notes ? "ok" : "missing", file.size(), csvBytes, (double)csvBytes / file.size());
+    failures += stats.rows != ROWS || mismatches || !notes || stats.badBlocks;
+
+    //one flipped bit in the third block, only that block's rows go
+    std::vector<uint8_t> damaged = file;
+    damaged[file.size() * 3 / 10] ^= 0x04;
+    items.clear();
+    stats = DecodeStats();
+    LogDecoder(damaged).decode(items, stats);
+    printf("bit flip: %zu rows, %zu bad blocks\n", stats.rows, stats.badBlocks);
+    failures += stats.rows < ROWS - LOG_KEYFRAME_INTERVAL || stats.rows >= ROWS || stats.badBlocks == 0;
+    failures += checkRows(items, 0, 1) != 0;
+
+    //power lost mid block, everything before the cut is still there
+    std::vector<uint8_t> cut(file.begin(), file.begin() + file.size() - 25);
+    items.clear();
+    stats = DecodeStats();
+    LogDecoder(cut).decode(items, stats);
+    printf("truncated: %zu rows, cut off %s\n", stats.rows, stats.truncated ? "yes" : "no");
+    failures += !stats.truncated || stats.rows < ROWS - 5 || checkRows(items, 0, stats.rows) != 0;
+
+    //indexed log, one step every 40 rows like syntheticRow, then the same file cut off before its last checkpoint
+    file.assign(LOG_HEADER_SIZE, 0);
+    LogEncoder encoder;
+    LogIndexer indexer;
+    encoder.header(file.data());
+    indexer.begin();
+    uint8_t buffer[LOG_MAX_NOTE + 4];
+    char text[LOG_INDEX_MAX_TEXT + 1];
+    size_t cutAt = 0;
+    for (int i = 0; i < ROWS; i++) {
+        uint8_t n;
+        if (i % 40 == 0) {
+            n = encoder.finish(buffer);
+            file.insert(file.end(), buffer, buffer + n);
+            LogIndexEntry entry = {1, (uint8_t)(i / 40), (uint32_t)(i * 98.7f), (uint32_t)file.size()};
+            if (indexer.add(entry)) {
+                cutAt = file.size() + 1;
+                indexer.checkpoint(file.size(), text);
+                n = encoder.note(text, buffer);
+                file.insert(file.end(), buffer, buffer + n);
+            }
+        }
+        float values[LOG_CHANNELS];
+        syntheticRow(i, values);
+        n = encoder.encode(values, buffer);
+        file.insert(file.end(), buffer, buffer + n);
+    }
+    file.insert(file.end(), buffer, buffer + encoder.finish(buffer));
+    if (indexer.pending()) {
+        indexer.checkpoint(file.size(), text);
+        file.insert(file.end(), buffer, buffer + encoder.note(text, buffer));
+    }
+    indexer.trailer(text);
+    file.insert(file.end(), buffer, buffer + encoder.note(text, buffer));
+
+    std::vector<LogIndexEntry> index;
+    bool fromTrailer = false;
+    bool indexed = readIndex(file, index, &fromTrailer) && index.size() == ROWS / 40;
+    size_t start = 0, end = 0;
+    indexed = indexed && stepRange(index, 1, 3, file.size(), &start, &end);
+    std::vector<uint8_t> slice(file.begin(), file.begin() + LOG_HEADER_SIZE);
+    slice.insert(slice.end(), file.begin() + start, file.begin() + end);
+    items.clear();
+    stats = DecodeStats();
+    LogDecoder(slice).decode(items, stats);
+    mismatches = checkRows(items, 120, 40);
+    printf("index: %zu entries%s, step 1:3 %zu rows, %d mismatches\n", index.size(), fromTrailer ? " from the trailer" : "", stats.rows, mismatches);
+    failures += !indexed || !fromTrailer || stats.rows != 40 || mismatches || stats.badBlocks;
+
+    cut.assign(file.begin(), file.begin() + cutAt + 20);
+    index.clear();
+    indexed = readIndex(cut, index, &fromTrailer);
+    printf("index cut off: %zu entries, %s\n", index.size(), fromTrailer ? "trailer" : "found from the tail");
+    failures += !indexed || fromTrailer || index.size() != 4;
+
+    //raw counts back to units, as logged and with a corrected thrust scale
+    const char* rawLog =
+        "# raw thrust_scale=42.000000 thrust_offset=81233 thrust_fit=0.000000:0.000000:0.000000:0.000:0:0 torque_scale=210.000000 torque_offset=-41887 torque_fit=0.000000:0.000000:0.000000:0.000:0:0\r\n"
+        "# raw analog_divisor=40 adc_max=1023 vcc=5.000 voltage_calibration=21.000 voltage_offset=0.000000 current_sensitivity=0.020000 current_offset=0.000000 average_gain=25\r\n"
+        "# raw zero_voltage=2.700000 airspeed_sensitivity=1.000 air_density=1.200 airspeed_override=0 pulses_per_rev=4\r\n"
+        "Time (us),Thrust (counts),Torque (counts),Voltage (ADC),Current (ADC),Airspeed (ADC),RPM Edges,RPM Window (us),Throttle (0.1%),Ripple RPM,RPM Mismatch\r\n"
+        "16617412,215122,-31536,6528,301,22091,162,260000,375,4411,0\r\n"
+        "#INDEX,0,1:3:15440:9798\r\n"
+        "16721812,215109,-31520,6534,308,22088,162,260000,375\r\n";
+    std::vector<uint8_t> raw(rawLog, rawLog + strlen(rawLog));
+    RawConstants overrides;
+    size_t badRows;
+    items.clear();
+    bool rawOk = decodeRaw(raw, overrides, items, &badRows) && items.size() == 2 && !items[0].isNote && !items[1].isNote;
+    rawOk = rawOk && fabs(items[0].values[LOG_THRUST] - (215122 - 81233) / 42.0) < 1e-6 && fabs(items[0].values[LOG_TORQUE] - (-31536 + 41887) / 210.0) < 1e-6;
+    rawOk = rawOk && fabs(items[0].values[LOG_VOLTAGE] - 6528 / 40.0 * 5 / 1023 * 21) < 1e-6 && fabs(items[0].values[LOG_RPM] - 162 * 60e6 / (260000 * 8.0)) < 1e-6;
+    rawOk = rawOk && fabs(items[1].values[LOG_CURRENT] - (0.75 * 301 + 0.25 * 308) / 40 * 5 / 1023 / 0.02) < 1e-6 && items[0].values[LOG_AIRSPEED] == 0;
+    rawKeyValue("thrust_scale=40", overrides);
+    std::vector<LogItem> corrected;
+    rawOk = rawOk && decodeRaw(raw, overrides, corrected, &badRows) && fabs(corrected[0].values[LOG_THRUST] - (215122 - 81233) / 40.0) < 1e-6;
+    rawKeyValue("airspeed_override=5", overrides);
+    rawKeyValue("drag_tare=2.000:0.0:-10.0:-30.0:-60.0", overrides); //5 m/s is halfway between -30 and -60
+    corrected.clear();
+    rawOk = rawOk && decodeRaw(raw, overrides, corrected, &badRows) && fabs(corrected[0].values[LOG_THRUST] - ((215122 - 81233) / 40.0 + 45)) < 1e-3;
+    printf("raw counts: %s, %zu bad rows\n", rawOk ? "ok" : "wrong", badRows);
+    failures += !rawOk || badRows;
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(in);
+    return true;
+}
+
+static int indexCommand(const char* path, const char* stepArg) { //--index, or --step when stepArg is given
+    unsigned segment = 0, step = 0;
+    if (stepArg && sscanf(stepArg, "%u:%u", &segment, &step) != 2) {
+        fprintf(stderr, "--step wants segment:step, e.g. 1:3\n");
+        return 2;
+    }
+    std::vector<uint8_t> data;
+    if (!readFile(path, data)) {
+        return 1;
+    }
+    std::vector<LogIndexEntry> index;
+    bool fromTrailer;
+    if (!readIndex(data, index, &fromTrailer)) {
+        fprintf(stderr, "%s has no index\n", path);
+        return 1;
+    }
+    if (!fromTrailer) {
+        fprintf(stderr, "no trailer, the log was cut short. Index up to its last checkpoint\n");
+    }
+    if (!stepArg) {
+        printIndex(index);
+        return 0;
+    }
+
+    size_t start, end;
+    if (!stepRange(index, segment, step, data.size(), &start, &end)) {
+        fprintf(stderr, "no segment %u step %u in the index\n", segment, step);
+        return 1;
+    }
+    bool compressed = isCompressed(data);
+    std::vector<uint8_t> slice(data.begin(), data.begin() + (compressed ? LOG_HEADER_SIZE : 0));
+    if (!compressed) { //the column names, then the rows as they are
+        size_t header = 0;
+        while (header < data.size() && data[header] != '\n') header++;
+        fwrite(data.data(), 1, header + 1 < data.size() ? header + 1 : data.size(), stdout);
+        fwrite(data.data() + start, 1, end - start, stdout);
+        return 0;
+    }
+    slice.insert(slice.end(), data.begin() + start, data.begin() + end);
+    std::vector<LogItem> items;
+    DecodeStats stats;
+    if (!LogDecoder(slice).decode(items, stats)) {
+        return 1;
+    }
+    writeCsv(stdout, items);
+    printStats(stats);
+    return stats.badBlocks ? 3 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "--selftest") == 0) {
+        return runSelfTest();
+    }
+    if (argc == 3 && strcmp(argv[1], "--index") == 0) {
+        return indexCommand(argv[2], nullptr);
+    }
+    if (argc == 4 && strcmp(argv[1], "--step") == 0) {
+        return indexCommand(argv[3], argv[2]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--raw") == 0) {
+        RawConstants overrides;
+        for (int i = 3; i < argc; i++) {
+            if (!rawKeyValue(argv[i], overrides)) {
+                fprintf(stderr, "%s isn't key=value\n", argv[i]);
+                return 2;
+            }
+        }
+        std::vector<uint8_t> data;
+        std::vector<LogItem> items;
+        size_t badRows;
+        if (!readFile(argv[2], data) || !decodeRaw(data, overrides, items, &badRows)) {
+            return 1;
+        }
+        writeCsv(stdout, items);
+        fprintf(stderr, "%zu bad rows\n", badRows);
+        return badRows ? 3 : 0;
+    }
+    if (argc != 2 || argv[1][0] == '-') {
+        fprintf(stderr, "usage: %s LOG.dlg > LOG.csv | --index LOG | --step SEGMENT:STEP LOG > STEP.csv | --raw LOG [key=value...] > LOG.csv | --selftest\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> data;
+    if (!readFile(argv[1], data)) {
+        return 1;
+    }
+
+    std::vector<LogItem> items;
+    DecodeStats stats;
+    if (!LogDecoder(data).decode(items, stats)) {
+        return 1;
+    }
+    writeCsv(stdout, items);
+    printStats(stats);
+    return stats.badBlocks ? 3 : 0;
+}
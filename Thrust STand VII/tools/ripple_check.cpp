@@ -0,0 +1,136 @@
+//Runs the current ripple RPM estimator (include/RippleRpm.h) on the host, against bursts recorded from the
+//stand or against made up waveforms. A recorded burst is what the "ripple" Serial command prints: an @burst
+//line with the readings and the @ok ripple line after it with the rate they came in at.
+//
+//    ripple_check serial.log               estimate for every burst in a captured Serial log
+//    ripple_check serial.log 12            the same with a different motor pole count
+//    ripple_check --selftest               synthetic ripple at known RPMs, harmonics, PWM noise and no ripple at all
+
+#include "RippleRpm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define RIPPLE_MIN_RPM 500 //same band the firmware searches
+#define RIPPLE_MAX_RPM 30000
+
+static VibrationSpectrum spectrum;
+
+static float lineValue(const std::string& line, const char* key) { //key=value out of an @ok ripple line, 0 if missing
+    size_t at = line.find(std::string(" ") + key + "=");
+    return at == std::string::npos ? 0 : atof(line.c_str() + at + strlen(key) + 2);
+}
+
+static RippleEstimate run(const std::vector<int32_t>& burst, float sampleHz, uint8_t poles) {
+    int32_t* samples = spectrum.samples();
+    for (int i = 0; i < VIB_FFT_SIZE; i++) {
+        samples[i] = i < (int)burst.size() ? burst[i] : 0;
+    }
+    return RippleRpm::estimate(spectrum, sampleHz, poles, RIPPLE_MIN_RPM, RIPPLE_MAX_RPM);
+}
+
+static int checkLog(const char* path, long poleOverride) {
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+    printf("burst,sample rate (Hz),poles,ripple RPM,stand's ripple RPM,optical RPM,prominence\n");
+    std::vector<int32_t> burst;
+    char buffer[8192];
+    int bursts = 0;
+    while (fgets(buffer, sizeof(buffer), in)) {
+        std::string line = buffer;
+        if (line.compare(0, 7, "@burst ") == 0) {
+            burst.clear();
+            for (const char* p = line.c_str() + 7; *p && *p != '\n' && *p != '\r';) {
+                char* stop;
+                burst.push_back(strtol(p, &stop, 10));
+                if (stop == p) break;
+                p = *stop == ',' ? stop + 1 : stop;
+            }
+        } else if (line.compare(0, 10, "@ok ripple") == 0 && !burst.empty()) {
+            float sampleHz = lineValue(line, "sample_hz");
+            uint8_t poles = poleOverride ? poleOverride : (uint8_t)lineValue(line, "poles");
+            if (burst.size() != VIB_FFT_SIZE) {
+                fprintf(stderr, "burst %d has %zu readings, not %d\n", bursts + 1, burst.size(), VIB_FFT_SIZE);
+            }
+            RippleEstimate estimate = run(burst, sampleHz, poles);
+            printf("%d,%.1f,%u,%.0f,%.0f,%.0f,%.1f\n", ++bursts, sampleHz, poles, estimate.rpm,
+                   lineValue(line, "rpm"), lineValue(line, "optical"), estimate.prominence);
+            burst.clear();
+        }
+    }
+    fclose(in);
+    if (!bursts) {
+        fprintf(stderr, "no @burst/@ok ripple pairs in %s\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+//bus current as a six step ESC draws it: a dip at each commutation (the fundamental and its second harmonic),
+//PWM switching that aliases down somewhere, noise and the ADC's 10 bits
+static std::vector<int32_t> synthetic(float rpm, uint8_t poles, float sampleHz, float ripple, float pwmHz, unsigned seed) {
+    srand(seed);
+    float f = RippleRpm::rippleHz(rpm, poles);
+    std::vector<int32_t> burst(VIB_FFT_SIZE);
+    for (int i = 0; i < VIB_FFT_SIZE; i++) {
+        float t = i / sampleHz;
+        float counts = 300 + ripple * cosf(2 * (float)M_PI * f * t) + 0.4f * ripple * cosf(4 * (float)M_PI * f * t + 0.7f);
+        counts += 0.5f * ripple * cosf(2 * (float)M_PI * pwmHz * t);
+        counts += ((rand() % 2001) - 1000) / 1000.0f * 2; //+-2 counts
+        burst[i] = lroundf(counts);
+    }
+    return burst;
+}
+
+static int selfTest() {
+    int failures = 0;
+    const float sampleHz = 23800;
+    const uint8_t poleCounts[] = {12, 14};
+    const float rpms[] = {1500, 3200, 5400, 7700, 9100};
+    float worst = 0;
+    for (uint8_t poles : poleCounts) {
+        for (float rpm : rpms) {
+            if (RippleRpm::rippleHz(rpm, poles) > sampleHz / 2) continue;
+            RippleEstimate estimate = run(synthetic(rpm, poles, sampleHz, 12, 16000, (unsigned)rpm), sampleHz, poles);
+            float error = RippleRpm::disagreement(estimate.rpm, rpm);
+            if (error > worst) worst = error;
+            if (error > 1) {
+                printf("%u poles at %.0f RPM read %.0f (%.2f%%)\n", poles, rpm, estimate.rpm, error);
+                failures++;
+            }
+        }
+    }
+    printf("ripple at known RPMs: worst %.2f%% off\n", worst);
+
+    //a few counts of ripple still reads, nothing but noise reads as nothing
+    RippleEstimate faint = run(synthetic(6000, 14, sampleHz, 3, 16000, 5), sampleHz, 14);
+    RippleEstimate flat = run(synthetic(6000, 14, sampleHz, 0, 0, 6), sampleHz, 14);
+    printf("faint ripple: %.0f RPM, prominence %.1f. no ripple: %.0f RPM, prominence %.1f\n", faint.rpm, faint.prominence, flat.rpm, flat.prominence);
+    failures += RippleRpm::disagreement(faint.rpm, 6000) > 1;
+    failures += flat.rpm != 0;
+
+    //the wrong pole count is off by their ratio, which is what the disagreement flag is there to catch
+    RippleEstimate wrongPoles = run(synthetic(6000, 14, sampleHz, 12, 16000, 7), sampleHz, 12);
+    printf("14 pole motor set up as 12: %.0f RPM\n", wrongPoles.rpm);
+    failures += RippleRpm::disagreement(wrongPoles.rpm, 6000 * 14 / 12.0f) > 1;
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--selftest") == 0) {
+        return selfTest();
+    }
+    if (argc == 2 || argc == 3) {
+        return checkLog(argv[1], argc == 3 ? atol(argv[2]) : 0);
+    }
+    fprintf(stderr, "usage: ripple_check <serial log> [poles] | --selftest\n");
+    return 2;
+}
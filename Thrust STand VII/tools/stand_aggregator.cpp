@@ -0,0 +1,603 @@
+//Records the sensor link (include/SensorLink.h) of several stands at once on one host. One thread watches
+//every port with epoll and decodes the frames, each stand's samples go through their own lock free queue to
+//a writer thread, and the writers save them in batches as Stand_N.csv: the raw counts and node timestamps
+//the frames carried plus the host time they were read at, the same numbers a raw log has. Every few seconds
+//it prints each stand's frame rate, the frames lost on the link (sequence gaps), CRC errors and samples
+//dropped because a writer fell behind.
+//
+//    stand_aggregator /dev/ttyUSB0 /dev/ttyUSB1 ...     until Ctrl-C, files in the current directory
+//    stand_aggregator --out runs --seconds 60 PATH...   somewhere else, for a fixed time
+//    stand_aggregator --standins 8                      8 synthetic stands on ptys instead of ports
+//    stand_aggregator --selftest                        24 stands at 10x the node's rate, checked frame by frame
+//
+//The port speed is left alone, a USB serial adapter needs its 250000 baud set first (stty -F PATH 250000 raw).
+//Ptys don't care.
+
+#include "SensorLink.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define QUEUE_SIZE 4096 //samples per stand, 40 s of a node at full rate
+#define WRITE_BATCH 65536 //bytes a writer gathers for one stand before it writes them
+#define WRITE_PERIOD 1000000 //us, a quiet stand still gets written this often
+#define WRITER_IDLE 2000 //us a writer sleeps when none of its queues had anything
+#define READ_CHUNK 4096
+#define STATS_PERIOD 5 //s between rate reports
+
+static uint64_t nowMicros() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static bool makeRaw(int fd) {
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        return false;
+    }
+    cfmakeraw(&tio);
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//QUEUE
+
+//RingBuffer.h for threads: one reader pushes, one writer pops, and the indices are atomics with acquire and
+//release so a sample is all there before the other side sees it. Indices run freely and get masked.
+template<typename T, size_t SIZE>
+class SpscQueue {
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SpscQueue SIZE must be a power of two");
+
+public:
+    bool push(const T& item) { //false (and the item is dropped) if the queue is full
+        size_t at = head.load(std::memory_order_relaxed);
+        if (at - tail.load(std::memory_order_acquire) == SIZE) {
+            return false;
+        }
+        buffer[at & (SIZE - 1)] = item;
+        head.store(at + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) { //false if there's nothing queued
+        size_t at = tail.load(std::memory_order_relaxed);
+        if (at == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buffer[at & (SIZE - 1)];
+        tail.store(at + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T buffer[SIZE];
+    alignas(64) std::atomic<size_t> head{0}; //written by the producer, own cache line so the two sides don't fight over it
+    alignas(64) std::atomic<size_t> tail{0}; //written by the consumer
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//STANDS
+
+struct StandSample {
+    uint64_t hostMicros; //when the read that finished the frame came back
+    SamplePacket packet;
+};
+
+struct Stand {
+    int number; //1 based, the file is Stand_<number>.csv
+    std::string source;
+    int fd = -1;
+    bool connected = false;
+
+    //reader thread only
+    SensorLinkParser parser;
+    bool sequenceValid = false;
+    uint16_t lastSequence = 0;
+    uint64_t linkDrops = 0;
+    uint64_t framesAtReport = 0;
+
+    //read by the writer or the report
+    std::atomic<uint64_t> frames{0}; //good frames decoded
+    std::atomic<uint64_t> queueDrops{0};
+    std::atomic<uint64_t> rowsWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<bool> writeFailed{false};
+
+    //writer thread only
+    FILE* out = NULL;
+    std::string pending;
+    uint64_t lastWrite = 0;
+
+    SpscQueue<StandSample, QUEUE_SIZE> queue;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onInterrupt(int) {
+    interrupted = 1;
+}
+
+static bool openStand(Stand& stand) {
+    stand.fd = open(stand.source.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    if (stand.fd < 0) {
+        perror(stand.source.c_str());
+        return false;
+    }
+    if (isatty(stand.fd) && !makeRaw(stand.fd)) {
+        perror(stand.source.c_str());
+        return false;
+    }
+    stand.connected = true;
+    return true;
+}
+
+static void closeStand(Stand& stand, int epollFd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, stand.fd, NULL);
+    close(stand.fd);
+    stand.connected = false;
+    fprintf(stderr, "stand %d (%s) disconnected\n", stand.number, stand.source.c_str());
+}
+
+static void receive(Stand& stand, const uint8_t* bytes, ssize_t count, uint64_t at) { //reader thread, frames into the queue
+    for (ssize_t i = 0; i < count; i++) {
+        if (!stand.parser.feed(bytes[i]) || stand.parser.type() != LINK_SAMPLE || stand.parser.length() != sizeof(SamplePacket)) {
+            continue;
+        }
+        StandSample sample;
+        sample.hostMicros = at;
+        memcpy(&sample.packet, stand.parser.payload(), sizeof(SamplePacket));
+        if (stand.sequenceValid) {
+            stand.linkDrops += (uint16_t)(sample.packet.sequence - stand.lastSequence - 1);
+        }
+        stand.lastSequence = sample.packet.sequence;
+        stand.sequenceValid = true;
+        stand.frames.fetch_add(1, std::memory_order_relaxed);
+        if (!stand.queue.push(sample)) {
+            stand.queueDrops.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//WRITERS
+
+static const char* CSV_HEADER = "Host (us),Sequence,Sent (us),Flags,Thrust (counts),Thrust At (us),Torque (counts),Torque At (us),"
+    "Voltage (counts x16),Current (counts x16),Airspeed (counts x16),Analog At (us),RPM Edges,RPM Window (us)";
+
+static bool openOutput(Stand& stand, const std::string& directory) {
+    std::string path = directory + "/Stand_" + std::to_string(stand.number) + ".csv";
+    stand.out = fopen(path.c_str(), "w");
+    if (!stand.out) {
+        perror(path.c_str());
+        return false;
+    }
+    setvbuf(stand.out, NULL, _IONBF, 0); //the batches are the buffering
+    fprintf(stand.out, "# stand %d source=%s link_period_us=%d\n%s\n", stand.number, stand.source.c_str(), SENSOR_LINK_SAMPLE_PERIOD, CSV_HEADER);
+    return true;
+}
+
+static void appendRow(std::string& out, const StandSample& sample) {
+    const SamplePacket& p = sample.packet;
+    char row[192];
+    int n = snprintf(row, sizeof(row), "%llu,%u,%lu,%u,%ld,%lu,%ld,%lu,%u,%u,%u,%lu,%u,%lu\n",
+        (unsigned long long)sample.hostMicros, p.sequence, (unsigned long)p.sentAt, p.flags, (long)p.thrustCounts,
+        (unsigned long)p.thrustAt, (long)p.torqueCounts, (unsigned long)p.torqueAt, p.voltageCounts, p.currentCounts,
+        p.airspeedCounts, (unsigned long)p.analogAt, p.rpmEdges, (unsigned long)p.rpmWindow);
+    out.append(row, n);
+}
+
+static void writePending(Stand& stand) {
+    if (!stand.pending.empty() && !stand.writeFailed.load(std::memory_order_relaxed)) {
+        if (fwrite(stand.pending.data(), 1, stand.pending.size(), stand.out) != stand.pending.size()) {
+            fprintf(stderr, "stand %d: write failed: %s\n", stand.number, strerror(errno));
+            stand.writeFailed.store(true);
+        } else {
+            stand.bytesWritten.fetch_add(stand.pending.size(), std::memory_order_relaxed);
+        }
+    }
+    stand.pending.clear();
+    stand.lastWrite = nowMicros();
+}
+
+static void runWriter(std::vector<Stand*> stands, const std::atomic<bool>* done) {
+    for (Stand* stand : stands) {
+        stand->pending.reserve(WRITE_BATCH + 256);
+        stand->lastWrite = nowMicros();
+    }
+    for (;;) {
+        bool finishing = done->load(std::memory_order_acquire); //read before the queues, so nothing pushed before it is missed
+        bool busy = false;
+        for (Stand* stand : stands) {
+            StandSample sample;
+            uint64_t rows = 0;
+            while (stand->pending.size() < WRITE_BATCH && stand->queue.pop(sample)) {
+                appendRow(stand->pending, sample);
+                rows++;
+            }
+            stand->rowsWritten.fetch_add(rows, std::memory_order_relaxed);
+            busy |= rows > 0;
+            if (stand->pending.size() >= WRITE_BATCH || nowMicros() - stand->lastWrite >= WRITE_PERIOD) {
+                writePending(*stand);
+            }
+        }
+        if (finishing && !busy) {
+            break;
+        }
+        if (!busy) {
+            usleep(WRITER_IDLE);
+        }
+    }
+    for (Stand* stand : stands) {
+        writePending(*stand);
+        fclose(stand->out);
+        stand->out = NULL;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//AGGREGATOR
+
+struct AggregatorOptions {
+    std::string directory = ".";
+    int writers = 2;
+    double seconds = 0; //0 runs until Ctrl-C or every stand has gone
+    int statsPeriod = STATS_PERIOD; //s, 0 for only the summary at the end
+    const std::atomic<bool>* stop = NULL; //the self test ends the run through this
+};
+
+static void report(std::vector<Stand>& stands, double interval) {
+    for (Stand& stand : stands) {
+        uint64_t frames = stand.frames.load(std::memory_order_relaxed);
+        printf("stand %d: %.1f frames/s, link drops %llu, crc %lu, queue drops %llu, rows %llu, %llu B%s\n",
+            stand.number, interval > 0 ? (frames - stand.framesAtReport) / interval : 0.0,
+            (unsigned long long)stand.linkDrops, (unsigned long)stand.parser.crcErrors,
+            (unsigned long long)stand.queueDrops.load(), (unsigned long long)stand.rowsWritten.load(),
+            (unsigned long long)stand.bytesWritten.load(), stand.connected ? "" : " (gone)");
+        stand.framesAtReport = frames;
+    }
+    fflush(stdout);
+}
+
+static double cpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static int aggregate(std::vector<Stand>& stands, const AggregatorOptions& options) {
+    int epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+    for (size_t i = 0; i < stands.size(); i++) {
+        if (!openStand(stands[i]) || !openOutput(stands[i], options.directory)) {
+            return 1;
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, stands[i].fd, &event) != 0) {
+            perror("epoll_ctl");
+            return 1;
+        }
+    }
+
+    //stands dealt out round robin, each one belongs to a single writer so its queue has one consumer
+    int writerCount = options.writers < 1 ? 1 : options.writers;
+    if (writerCount > (int)stands.size()) writerCount = stands.size();
+    std::vector<std::vector<Stand*>> owned(writerCount);
+    for (size_t i = 0; i < stands.size(); i++) {
+        owned[i % writerCount].push_back(&stands[i]);
+    }
+    std::atomic<bool> done{false};
+    std::vector<std::thread> writers;
+    for (int i = 0; i < writerCount; i++) {
+        writers.emplace_back(runWriter, owned[i], &done);
+    }
+
+    uint64_t start = nowMicros();
+    uint64_t lastReport = start;
+    double cpuAtStart = cpuSeconds();
+    size_t connected = stands.size();
+    epoll_event events[64];
+    uint8_t bytes[READ_CHUNK];
+    while (!interrupted && connected && !(options.stop && options.stop->load())) {
+        int ready = epoll_wait(epollFd, events, 64, 100);
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        uint64_t now = nowMicros();
+        for (int i = 0; i < ready; i++) {
+            Stand& stand = stands[events[i].data.u32];
+            ssize_t n = read(stand.fd, bytes, sizeof(bytes)); //level triggered, whatever is left comes round again
+            if (n > 0) {
+                receive(stand, bytes, n, now);
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) { //a pty whose other end closed reads EIO
+                closeStand(stand, epollFd);
+                connected--;
+            }
+        }
+        if (options.seconds > 0 && now - start >= options.seconds * 1e6) {
+            break;
+        }
+        if (options.statsPeriod > 0 && now - lastReport >= options.statsPeriod * 1000000ULL) {
+            report(stands, (now - lastReport) / 1e6);
+            lastReport = now;
+        }
+    }
+
+    done.store(true, std::memory_order_release);
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    for (Stand& stand : stands) {
+        if (stand.connected) {
+            close(stand.fd);
+        }
+    }
+    close(epollFd);
+
+    uint64_t end = nowMicros();
+    report(stands, (end - lastReport) / 1e6);
+    uint64_t frames = 0;
+    for (Stand& stand : stands) {
+        frames += stand.frames.load();
+    }
+    double elapsed = (end - start) / 1e6;
+    printf("%zu stands, %llu frames in %.1f s (%.0f/s), %d writers, cpu %.2f s\n", stands.size(), (unsigned long long)frames,
+        elapsed, elapsed > 0 ? frames / elapsed : 0.0, writerCount, cpuSeconds() - cpuAtStart);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//STAND-INS
+
+//a node's worth of frames per stand on a pty, the aggregator opens the other end like a real port.
+//Same synthetic motor as sim/link, offset per stand so the files can be told apart
+struct StandIns {
+    std::vector<int> masters;
+    std::vector<std::string> paths;
+    std::vector<uint64_t> sent;
+    std::vector<uint64_t> corrupted;
+    std::vector<uint64_t> overruns; //frames the pty had no room for, the aggregator wasn't keeping up
+    std::atomic<bool> stop{false};
+    std::thread thread;
+
+    bool open(int count) {
+        for (int i = 0; i < count; i++) {
+            int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+            if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+                perror("posix_openpt");
+                return false;
+            }
+            makeRaw(fd);
+            masters.push_back(fd);
+            paths.push_back(ptsname(fd));
+        }
+        sent.assign(count, 0);
+        corrupted.assign(count, 0);
+        overruns.assign(count, 0);
+        return true;
+    }
+
+    static SamplePacket sample(int stand, uint16_t sequence, uint32_t now) {
+        float load = 0.5f - 0.5f * cosf(sequence * 0.01f + stand);
+        SamplePacket packet;
+        packet.sequence = sequence;
+        packet.sentAt = now;
+        packet.flags = SAMPLE_THRUST | ((sequence & 1) ? SAMPLE_TORQUE : 0);
+        packet.thrustCounts = 8400 + stand * 1000 + (int32_t)(load * 2000000);
+        packet.thrustAt = now - 3000;
+        packet.torqueCounts = -12000 + (int32_t)(load * 400000);
+        packet.torqueAt = now - 7000;
+        packet.voltageCounts = (uint16_t)((760 - load * 40) * 16);
+        packet.currentCounts = (uint16_t)((512 + load * 300) * 16);
+        packet.airspeedCounts = (uint16_t)(205 * 16);
+        packet.analogAt = now - SENSOR_LINK_SAMPLE_PERIOD / 2;
+        packet.rpmEdges = (uint16_t)(load * 60);
+        packet.rpmWindow = SENSOR_LINK_SAMPLE_PERIOD;
+        return packet;
+    }
+
+    //every stand sends a frame each period until frames have gone (0 for no end), every corruptEvery'th frame of
+    //stand corruptStand gets a flipped bit
+    void run(uint32_t periodMicros, uint64_t frames, int corruptStand, int corruptEvery) {
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+        uint8_t frame[sizeof(SamplePacket) + SENSOR_LINK_OVERHEAD];
+        for (uint64_t sequence = 0; (!frames || sequence < frames) && !stop.load(); sequence++) {
+            for (size_t i = 0; i < masters.size(); i++) {
+                SamplePacket packet = sample(i, sequence, (uint32_t)nowMicros());
+                uint8_t length = encodeSensorFrame(LINK_SAMPLE, &packet, sizeof(packet), frame);
+                if ((int)i == corruptStand && corruptEvery > 0 && sequence % corruptEvery == (uint64_t)corruptEvery / 2) {
+                    frame[4 + sequence % sizeof(SamplePacket)] ^= 0x01;
+                    corrupted[i]++;
+                }
+                if (write(masters[i], frame, length) == length) {
+                    sent[i]++;
+                } else {
+                    overruns[i]++;
+                }
+            }
+            next += std::chrono::microseconds(periodMicros);
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void start(uint32_t periodMicros, uint64_t frames, int corruptStand, int corruptEvery) {
+        thread = std::thread(&StandIns::run, this, periodMicros, frames, corruptStand, corruptEvery);
+    }
+
+    void finish() {
+        stop.store(true);
+        if (thread.joinable()) thread.join();
+        for (int fd : masters) close(fd);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//SELF TEST
+
+static bool checkFile(const std::string& path, uint64_t expectedRows, uint64_t& gaps) { //rows present and in order
+    FILE* in = fopen(path.c_str(), "r");
+    if (!in) {
+        perror(path.c_str());
+        return false;
+    }
+    char line[256];
+    uint64_t rows = 0;
+    long last = -1;
+    gaps = 0;
+    while (fgets(line, sizeof(line), in)) {
+        if (line[0] == '#' || line[0] == 'H') continue; //note and column headings
+        const char* comma = strchr(line, ',');
+        long sequence = comma ? atol(comma + 1) : -1;
+        if (last >= 0 && sequence != last + 1) gaps++;
+        last = sequence;
+        rows++;
+    }
+    fclose(in);
+    if (rows != expectedRows) {
+        printf("%s: %llu rows, expected %llu\n", path.c_str(), (unsigned long long)rows, (unsigned long long)expectedRows);
+        return false;
+    }
+    return true;
+}
+
+static int selfTest() {
+    const int STANDS = 24;
+    const uint32_t PERIOD = SENSOR_LINK_SAMPLE_PERIOD / 10; //10x what a node sends
+    const uint64_t FRAMES = 3000; //3 s
+    const int CORRUPT_STAND = 2;
+    const int CORRUPT_EVERY = 50;
+
+    char directory[] = "/tmp/stand_aggregatorXXXXXX";
+    if (!mkdtemp(directory)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    StandIns standIns;
+    if (!standIns.open(STANDS)) {
+        return 1;
+    }
+    std::vector<Stand> stands(STANDS);
+    for (int i = 0; i < STANDS; i++) {
+        stands[i].number = i + 1;
+        stands[i].source = standIns.paths[i];
+    }
+
+    std::atomic<bool> stop{false};
+    AggregatorOptions options;
+    options.directory = directory;
+    options.statsPeriod = 0; //the summary at the end is enough
+    options.stop = &stop;
+    std::thread feeder([&]() {
+        standIns.start(PERIOD, FRAMES, CORRUPT_STAND, CORRUPT_EVERY);
+        standIns.thread.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300)); //the last frames still coming through
+        stop.store(true);
+    });
+    int result = aggregate(stands, options);
+    feeder.join();
+    standIns.finish();
+    if (result != 0) {
+        return result;
+    }
+
+    int failures = 0;
+    for (int i = 0; i < STANDS; i++) {
+        Stand& stand = stands[i];
+        uint64_t expected = standIns.sent[i] - standIns.corrupted[i];
+        uint64_t gaps = 0;
+        std::string path = std::string(directory) + "/Stand_" + std::to_string(stand.number) + ".csv";
+        bool ok = standIns.overruns[i] == 0 && standIns.sent[i] == FRAMES && stand.frames.load() == expected
+            && stand.queueDrops.load() == 0 && stand.linkDrops == standIns.corrupted[i] && stand.parser.crcErrors == standIns.corrupted[i]
+            && checkFile(path, expected, gaps) && gaps == standIns.corrupted[i];
+        if (!ok) {
+            printf("stand %d: sent %llu (%llu overruns, %llu corrupted), decoded %llu, link drops %llu, crc %lu, queue drops %llu, gaps %llu\n",
+                stand.number, (unsigned long long)standIns.sent[i], (unsigned long long)standIns.overruns[i],
+                (unsigned long long)standIns.corrupted[i], (unsigned long long)stand.frames.load(), (unsigned long long)stand.linkDrops,
+                (unsigned long)stand.parser.crcErrors, (unsigned long long)stand.queueDrops.load(), (unsigned long long)gaps);
+            failures++;
+        }
+        unlink(path.c_str());
+    }
+    rmdir(directory);
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "--selftest") == 0) {
+        return selfTest();
+    }
+
+    AggregatorOptions options;
+    std::vector<Stand> stands;
+    std::vector<std::string> sources;
+    int standInCount = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--out") == 0 && hasValue) {
+            options.directory = argv[++i];
+        } else if (strcmp(argv[i], "--writers") == 0 && hasValue) {
+            options.writers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && hasValue) {
+            options.seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0 && hasValue) {
+            options.statsPeriod = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--standins") == 0 && hasValue) {
+            standInCount = atoi(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            sources.push_back(argv[i]);
+        } else {
+            sources.clear();
+            standInCount = 0;
+            break;
+        }
+    }
+    if (sources.empty() && standInCount <= 0) {
+        fprintf(stderr, "usage: stand_aggregator [--out DIR] [--writers N] [--seconds S] [--stats S] PATH... | --standins N | --selftest\n");
+        return 2;
+    }
+
+    StandIns standIns;
+    if (standInCount > 0) {
+        if (!standIns.open(standInCount)) {
+            return 1;
+        }
+        sources.insert(sources.end(), standIns.paths.begin(), standIns.paths.end());
+    }
+    mkdir(options.directory.c_str(), 0755); //fine if it's already there
+    stands = std::vector<Stand>(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        stands[i].number = i + 1;
+        stands[i].source = sources[i];
+    }
+
+    signal(SIGINT, onInterrupt);
+    signal(SIGTERM, onInterrupt);
+    if (standInCount > 0) {
+        standIns.start(SENSOR_LINK_SAMPLE_PERIOD, 0, -1, 0);
+    }
+    int result = aggregate(stands, options);
+    standIns.finish();
+    return result;
+}